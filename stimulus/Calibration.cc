@@ -41,6 +41,12 @@ const int kMarkOffset = 777;
 const int kMarkStartStop = 999;
 const int kMarkRest = 888;
 
+const MarkEventId kEventTaskStartStop = InternMarkEvent("TaskStartStop");
+const MarkEventId kEventStimulusOffset = InternMarkEvent("StimulusOffset");
+const MarkEventId kEventStimulusRare = InternMarkEvent("StimulusRare");
+const MarkEventId kEventStimulusStandard = InternMarkEvent("StimulusStandard");
+const MarkEventId kEventTaskRest = InternMarkEvent("TaskRest");
+
 // Timing
 const int kStimuliDisplayTimeMs = 100;
 const int kMinFixationTimeMs = 700;
@@ -50,38 +56,47 @@ const int kRestFixationTimeMs = 2000;
 // Dimensions
 const float kStimuliHeightCm = 1.0;
 
-class CalibrationResultScreen : public Screen {
+struct CalibrationState {
+  TaskSchedule schedule;
+  size_t trial_count = 0;
+};
+
+class CalibrationFixationScreen : public FixationDotScreen {
  public:
-  CalibrationResultScreen(std::shared_ptr<SDL_Texture> rare,
-                          std::shared_ptr<SDL_Texture> standard)
-      : rare_(rare), standard_(standard) {
-    dest_rect_ = ComputeRectForPhysicalHeight(rare_.get(), kStimuliHeightCm);
+  // The delay comes from the schedule.
+  CalibrationFixationScreen(std::shared_ptr<CalibrationState> state)
+      : FixationDotScreen(0), state_(state) {}
 
-    // use Shuffler class to ensure we generate exactlythe number of
-    // required rare and standard stimuli, and that no rare stimuli is
-    // presented twice in a row.
-    std::vector<int> r(kNumRareStimuli);
-    std::fill(r.begin(), r.end(), kMarkRare);
-    shuffler_.AddCategoryElements(r, kMaxRunRare);
+ protected:
+  int GetDelayMs() override {
+    return state_->schedule.trials[state_->trial_count].fixation_ms;
+  }
 
-    std::vector<int> s(kNumStandardStimuli);
-    std::fill(s.begin(), s.end(), kMarkStandard);
-    shuffler_.AddCategoryElements(s, kMaxRunStandard);
+ private:
+  std::shared_ptr<CalibrationState> state_;
+};
 
-    shuffler_.ShuffleElements();
+class CalibrationResultScreen : public Screen {
+ public:
+  CalibrationResultScreen(std::shared_ptr<CalibrationState> state,
+                          std::shared_ptr<SDL_Texture> rare,
+                          std::shared_ptr<SDL_Texture> standard)
+      : state_(state), rare_(rare), standard_(standard) {
+    dest_rect_ = ComputeRectForPhysicalHeight(rare_.get(), kStimuliHeightCm);
   }
 
   void IsActive() override {
-    assert(!shuffler_.IsDone());
-    next_is_rare_ = shuffler_.GetNextItem() == kMarkRare;
-    if (trial_count_ == 0) {
-      SendMark(kMarkStartStop, "TaskStartStop");
+    const std::vector<ScheduledTrial> &trials = state_->schedule.trials;
+    assert(state_->trial_count < trials.size());
+    next_is_rare_ = trials[state_->trial_count].condition == kMarkRare;
+    if (state_->trial_count == 0) {
+      SendMark(kMarkStartStop, kEventTaskStartStop);
     }
 
-    trial_count_ += 1;
-    if (trial_count_ == kTotalTrials) {
+    state_->trial_count += 1;
+    if (state_->trial_count == trials.size()) {
       SwitchToScreen(1, kStimuliDisplayTimeMs);
-    } else if (trial_count_ % kNumTrialsBeforeRest == 0) {
+    } else if (state_->trial_count % kNumTrialsBeforeRest == 0) {
       SwitchToScreen(2, kStimuliDisplayTimeMs);
     } else {
       SwitchToScreen(0, kStimuliDisplayTimeMs);
@@ -89,17 +104,16 @@ class CalibrationResultScreen : public Screen {
   }
 
   void IsInvisible() override {
-    SendMark(kMarkOffset, "StimulusOffset");
+    SendMark(kMarkOffset, kEventStimulusOffset);
 
-    if (trial_count_ == kTotalTrials) {
-      SendMark(kMarkStartStop, "TaskStartStop");
+    if (state_->trial_count == state_->schedule.trials.size()) {
+      SendMark(kMarkStartStop, kEventTaskStartStop);
       assert(standard_count_ == kNumStandardStimuli);
       assert(rare_count_ == kNumRareStimuli);
-      trial_count_ = 0;
+      // Running the task again repeats the schedule.
+      state_->trial_count = 0;
       standard_count_ = 0;
       rare_count_ = 0;
-      // reshuffle elements for next time
-      shuffler_.ShuffleElements();
     }
   }
 
@@ -109,22 +123,21 @@ class CalibrationResultScreen : public Screen {
 
   void IsVisible() override {
     if (next_is_rare_) {
-      SendMark(kMarkRare, "StimulusRare");
+      SendMark(kMarkRare, kEventStimulusRare);
       rare_count_ += 1;
     } else {
-      SendMark(kMarkStandard, "StimulusStandard");
+      SendMark(kMarkStandard, kEventStimulusStandard);
       standard_count_ += 1;
     }
   }
 
  private:
+  std::shared_ptr<CalibrationState> state_;
   std::shared_ptr<SDL_Texture> rare_;
   std::shared_ptr<SDL_Texture> standard_;
   SDL_Rect dest_rect_;
-  int trial_count_ = 0;
   int standard_count_ = 0;
   int rare_count_ = 0;
-  Shuffler<int> shuffler_;
   bool next_is_rare_;
 };
 
@@ -133,13 +146,61 @@ public:
   RestScreen(std::string instructions) : InstructionScreen(instructions) {}
 
   void IsVisible() override {
-    SendMark(kMarkRest, "TaskRest");
+    SendMark(kMarkRest, kEventTaskRest);
   }
 };
 
 }  // namespace
 
-Screen *InitCalibration(Screen *main_screen) {
+TaskSchedule CompileOddballSchedule(RandomStream *random) {
+  RandomStream fixation_random = random->Split();
+
+  // use Shuffler class to ensure we generate exactly the number of
+  // required rare and standard stimuli, and that no rare stimuli is
+  // presented twice in a row.
+  Shuffler<int> shuffler;
+  std::vector<int> r(kNumRareStimuli);
+  std::fill(r.begin(), r.end(), kMarkRare);
+  shuffler.AddCategoryElements(r, kMaxRunRare);
+
+  std::vector<int> s(kNumStandardStimuli);
+  std::fill(s.begin(), s.end(), kMarkStandard);
+  shuffler.AddCategoryElements(s, kMaxRunStandard);
+
+  shuffler.ShuffleElements(random);
+
+  TaskSchedule schedule;
+  for (int trial_count = 0; trial_count < kTotalTrials; trial_count++) {
+    ScheduledTrial trial;
+    bool after_rest = trial_count > 0 &&
+                      trial_count % kNumTrialsBeforeRest == 0;
+    trial.fixation_ms =
+        after_rest ? kRestFixationTimeMs
+                   : fixation_random.NextInt(kMinFixationTimeMs,
+                                             kMaxFixationTimeMs);
+    trial.condition = shuffler.GetNextItem();
+    if (trial_count == 0) {
+      trial.marks.push_back(kMarkStartStop);
+    }
+
+    trial.marks.push_back(trial.condition);
+    trial.marks.push_back(kMarkOffset);
+    if (trial_count == kTotalTrials - 1) {
+      trial.marks.push_back(kMarkStartStop);
+    } else if ((trial_count + 1) % kNumTrialsBeforeRest == 0) {
+      trial.marks.push_back(kMarkRest);
+    }
+
+    schedule.trials.push_back(trial);
+  }
+
+  return schedule;
+}
+
+Screen *InitCalibration(Screen *main_screen, const TaskSchedule &schedule) {
+  Screen::WarnIfNotFrameMultiple("Oddball stimulus time",
+                                 kStimuliDisplayTimeMs);
+
   std::shared_ptr<SDL_Texture> rare(LoadImage(GetResourceDir() + "square.svg"),
                                     SDL_TextureDeleter());
   std::shared_ptr<SDL_Texture> standard(LoadImage(GetResourceDir() + "o.svg"),
@@ -149,13 +210,15 @@ Screen *InitCalibration(Screen *main_screen) {
   Screen *instructions = new InstructionExamplesScreen(
       "Silently count the number of squares that appear.", rare, standard,
       kStimuliHeightCm);
-  Screen *fixation =
-      new FixationDotScreen(kMinFixationTimeMs, kMaxFixationTimeMs);
+  std::shared_ptr<CalibrationState> state(new CalibrationState());
+  state->schedule = schedule;
+
+  Screen *fixation = new CalibrationFixationScreen(state);
   Screen *rest =
       new RestScreen("Take a break... click when ready to proceed");
-  Screen *restFixation =
-      new FixationDotScreen(kRestFixationTimeMs, kRestFixationTimeMs);
-  Screen *calibrationResult = new CalibrationResultScreen(rare, standard);
+  Screen *restFixation = new CalibrationFixationScreen(state);
+  Screen *calibrationResult =
+      new CalibrationResultScreen(state, rare, standard);
 
   version->AddSuccessor(instructions);
   instructions->AddSuccessor(fixation);
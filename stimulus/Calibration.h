@@ -17,11 +17,16 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CALIBRATION_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CALIBRATION_H_
 
+#include "Random.h"
+#include "Schedule.h"
 #include "Screen.h"
 
 namespace stimulus {
 
-Screen *InitCalibration(Screen *main_screen);
+// Draws every trial's stimulus and fixation time.
+TaskSchedule CompileOddballSchedule(RandomStream *random);
+
+Screen *InitCalibration(Screen *main_screen, const TaskSchedule &schedule);
 
 }  // namespace stimulus
 
@@ -58,6 +58,7 @@ const SDL_Scancode kScancodeYes = SDL_SCANCODE_S;
 const SDL_Scancode kScancodeNo = SDL_SCANCODE_L;
 
 struct CatPredState {
+  RandomStream random;
   Shuffler<int> typicality_shuffler;
   Shuffler<const CatPredItem *> cue_shuffler;
   int trial_count;
@@ -99,8 +100,8 @@ class CatPredInstructionScreen : public InstructionExamplesScreen {
 
   void IsActive() override {
     // Shuffle elements before task start
-    state_->typicality_shuffler.ShuffleElements();
-    state_->cue_shuffler.ShuffleElements();
+    state_->typicality_shuffler.ShuffleElements(&state_->random);
+    state_->cue_shuffler.ShuffleElements(&state_->random);
     state_->trial_count = 0;
   }
 
@@ -248,7 +249,7 @@ class ResponseScreen : public Screen {
 class ResponseFixationScreen : public FixationDotScreen {
  public:
   ResponseFixationScreen(std::shared_ptr<CatPredState> state, int timeout)
-      : FixationDotScreen(timeout, timeout), state_(state) {}
+      : FixationDotScreen(timeout), state_(state) {}
 
   void IsActive() override {
     if (state_->trial_count == kTotalTrials) {
@@ -275,18 +276,19 @@ class ResponseFixationScreen : public FixationDotScreen {
 
 }  // namespace
 
-Screen *InitCatPred(Screen *main_screen, const Settings &settings) {
+Screen *InitCatPred(Screen *main_screen, const Settings &settings,
+                    RandomStream random) {
   std::shared_ptr<CatPredState> state(
-      new CatPredState{Shuffler<int>(), Shuffler<const CatPredItem *>(), 0,
-                       nullptr, nullptr, 0});
+      new CatPredState{random.Split(), Shuffler<int>(),
+                       Shuffler<const CatPredItem *>(), 0, nullptr, nullptr,
+                       0});
 
   Screen *instructions = new CatPredInstructionScreen(state);
   Screen *cue = new CueScreen(state);
-  Screen *fixation1 = new FixationDotScreen(kMinPrimingFixationTimeMs,
-                                            kMaxPrimingFixationTimeMs);
+  Screen *fixation1 = new FixationDotScreen(
+      random.Split(), kMinPrimingFixationTimeMs, kMaxPrimingFixationTimeMs);
   Screen *target = new TargetScreen(state);
-  Screen *fixation2 =
-      new FixationDotScreen(kTargetFixationTimeMs, kTargetFixationTimeMs);
+  Screen *fixation2 = new FixationDotScreen(kTargetFixationTimeMs);
   Screen *response = new ResponseScreen();
   Screen *fixation3 =
       new ResponseFixationScreen(state, kResponseFixationTimeMs);
@@ -17,12 +17,14 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CATPRED_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CATPRED_H_
 
+#include "Random.h"
 #include "Screen.h"
 #include "Settings.h"
 
 namespace stimulus {
 
-Screen *InitCatPred(Screen *main_screen, const Settings &settings);
+Screen *InitCatPred(Screen *main_screen, const Settings &settings,
+                    RandomStream random);
 
 }  // namespace stimulus
 
@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Clock.h"
+
+#include <SDL.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace stimulus {
+namespace {
+
+// Read from the mark thread as well as the main loop.
+std::atomic<bool> virtual_clock(false);
+std::atomic<int64_t> virtual_time_us(0);
+
+}  // namespace
+
+// SDL_GetPerformanceCounter uses CLOCK_MONOTONIC_RAW on Linux (when
+// available), mach_absolute_time on OSX, and QueryPerformanceCounter on
+// Windows.
+int64_t GetTimeMicros() {
+  if (virtual_clock.load(std::memory_order_relaxed)) {
+    return virtual_time_us.load(std::memory_order_relaxed);
+  }
+
+  static const Uint64 frequency = SDL_GetPerformanceFrequency();
+  static const Uint64 base = SDL_GetPerformanceCounter();
+
+  Uint64 elapsed = SDL_GetPerformanceCounter() - base;
+
+  // Split the conversion to avoid overflowing when the counter frequency
+  // is high.
+  return static_cast<int64_t>((elapsed / frequency) * kMicrosPerSecond +
+                              (elapsed % frequency) * kMicrosPerSecond /
+                                  frequency);
+}
+
+void UseVirtualClock() {
+  virtual_clock.store(true);
+}
+
+bool IsVirtualClock() {
+  return virtual_clock.load(std::memory_order_relaxed);
+}
+
+void SetVirtualTime(int64_t time_us) {
+  virtual_time_us.store(time_us, std::memory_order_relaxed);
+}
+
+int64_t GetWallTimeMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace stimulus
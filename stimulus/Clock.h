@@ -0,0 +1,48 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CLOCK_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CLOCK_H_
+
+#include <cstdint>
+
+namespace stimulus {
+
+const int64_t kMicrosPerMs = 1000;
+const int64_t kMicrosPerSecond = 1000000;
+
+// Time base for all stimulus scheduling and mark timestamps. This is
+// monotonic, has microsecond resolution, and (unlike SDL_GetTicks) will
+// not wrap. The origin is the first call to this function.
+int64_t GetTimeMicros();
+
+// Headless runs use a virtual clock, which starts at zero and only moves
+// when it is set. This must be called before the clock is first read.
+void UseVirtualClock();
+bool IsVirtualClock();
+void SetVirtualTime(int64_t time_us);
+
+// Real elapsed time, even on the virtual clock, for measuring how long
+// work takes (loading images, for example) rather than scheduling it.
+int64_t GetWallTimeMicros();
+
+inline int64_t MsToMicros(int64_t ms) {
+  return ms * kMicrosPerMs;
+}
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_CLOCK_H_
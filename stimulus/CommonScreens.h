@@ -85,21 +85,31 @@ const float kDefaultCrossWidthCm = 0.7;
 
 class FixationScreen : public Screen {
  public:
-  FixationScreen(int min_delay, int max_delay, float cross_width_cm = kDefaultCrossWidthCm)
-      : min_delay_(min_delay), max_delay_(max_delay) {
+  // Shown for a time drawn from random, min_delay <= time < max_delay.
+  FixationScreen(RandomStream random, int min_delay, int max_delay,
+                 float cross_width_cm = kDefaultCrossWidthCm)
+      : random_(random), min_delay_(min_delay), max_delay_(max_delay) {
     cross_ = LoadImage(GetResourceDir() + "cross.bmp");
     dest_rect_ = ComputeRectForPhysicalWidth(cross_, cross_width_cm);
   }
 
+  // Shown for a fixed time.
+  explicit FixationScreen(int delay,
+                          float cross_width_cm = kDefaultCrossWidthCm)
+      : FixationScreen(RandomStream(0), delay, delay, cross_width_cm) {}
+
   void Render() override { Blit(cross_, dest_rect_); }
 
-  void IsVisible() override {
-    SwitchToScreen(0, GenerateRandomInt(min_delay_, max_delay_));
-  }
+  void IsVisible() override { SwitchToScreen(0, GetDelayMs()); }
+
+ protected:
+  // Tasks that follow a schedule return the trial's fixation time instead.
+  virtual int GetDelayMs() { return random_.NextInt(min_delay_, max_delay_); }
 
  private:
   SDL_Texture *cross_;
   SDL_Rect dest_rect_;
+  RandomStream random_;
   int min_delay_;
   int max_delay_;
 };
@@ -108,24 +118,34 @@ const float kFixationDotWidthCm = 0.15;
 
 class FixationDotScreen : public Screen {
  public:
-  FixationDotScreen(int min_delay, int max_delay)
-      : next_screen_(0), min_delay_(min_delay), max_delay_(max_delay) {
+  // Shown for a time drawn from random, min_delay <= time < max_delay.
+  FixationDotScreen(RandomStream random, int min_delay, int max_delay)
+      : next_screen_(0),
+        random_(random),
+        min_delay_(min_delay),
+        max_delay_(max_delay) {
     dot_ = LoadImage(GetResourceDir() + "dot.bmp");
     dest_rect_ = ComputeRectForPhysicalWidth(dot_, kFixationDotWidthCm);
   }
 
+  // Shown for a fixed time.
+  explicit FixationDotScreen(int delay)
+      : FixationDotScreen(RandomStream(0), delay, delay) {}
+
   void Render() override { Blit(dot_, dest_rect_); }
 
-  void IsVisible() override {
-    SwitchToScreen(next_screen_, GenerateRandomInt(min_delay_, max_delay_));
-  }
+  void IsVisible() override { SwitchToScreen(next_screen_, GetDelayMs()); }
 
  protected:
+  // Tasks that follow a schedule return the trial's fixation time instead.
+  virtual int GetDelayMs() { return random_.NextInt(min_delay_, max_delay_); }
+
   int next_screen_;
 
  private:
   SDL_Texture *dot_;
   SDL_Rect dest_rect_;
+  RandomStream random_;
   int min_delay_;
   int max_delay_;
 };
@@ -133,6 +153,7 @@ class FixationDotScreen : public Screen {
 class InstructionScreen : public Screen {
  public:
   InstructionScreen(std::string instructions) : instructions_(instructions) {
+    SetStatic(true);
     instruction_location_.x =
         (GetDisplayWidthPx() - GetStringWidth(instructions_)) / 2;
     instruction_location_.y = (GetDisplayHeightPx() - GetFontHeight()) / 2;
@@ -166,6 +187,7 @@ class InstructionExamplesScreen : public Screen {
         right_instructions_(right_instructions),
         left_texture_(left_texture),
         right_texture_(right_texture) {
+    SetStatic(true);
     int display_width_px = GetDisplayWidthPx();
     int display_height_px = GetDisplayHeightPx();
 
@@ -258,6 +280,7 @@ class MultiLineScreen : public Screen {
   MultiLineScreen(const std::vector<std::string> &lines, int mark = 0,
                   bool use_mouse = true, bool use_keyboard = false)
       : mark_(mark), use_mouse_(use_mouse), use_keyboard_(use_keyboard) {
+    SetStatic(true);
     Layout(lines);
   }
 
@@ -278,7 +301,9 @@ class MultiLineScreen : public Screen {
   void MouseClicked(int, int, int) override { if (use_mouse_) { SwitchToScreen(0); } }
 
  protected:
-  MultiLineScreen() {}
+  MultiLineScreen() {
+    SetStatic(true);
+  }
 
   void Layout(const std::vector<std::string> &lines) {
     lines_.clear();
@@ -30,16 +30,23 @@ const int kTotalTrials = 60;
 const int kMaxRunLength = 3;
 const char *kWinLossWidthSetting = "win_loss_width_cm";
 
+// Mark events
+const MarkEventId kEventStimulus = InternMarkEvent("Stimulus");
+const MarkEventId kEventResponse = InternMarkEvent("Response");
+const MarkEventId kEventPositiveFeedback = InternMarkEvent("PositiveFeedback");
+const MarkEventId kEventNegativeFeedback = InternMarkEvent("NegativeFeedback");
+
 // This screen doesn't have any interaction, it just serves as a point to
 // compute the next result and check if the task is over.
 class LoopScreen : public Screen {
  public:
-  LoopScreen(Shuffler<bool> *shuffler) : shuffler_(shuffler) {
+  LoopScreen(Shuffler<bool> *shuffler, RandomStream random)
+      : shuffler_(shuffler), random_(random) {
   }
 
   void IsVisible() override {
     if (shuffler_->IsDone()) {
-      shuffler_->ShuffleElements();
+      shuffler_->ShuffleElements(&random_);
       SwitchToScreen(1);  // Back to selection screen
     } else {
       SwitchToScreen(0);
@@ -48,6 +55,7 @@ class LoopScreen : public Screen {
 
  private:
   Shuffler<bool> *shuffler_;
+  RandomStream random_;
 };
 
 class ChooseDoorScreen : public Screen {
@@ -83,15 +91,15 @@ class ChooseDoorScreen : public Screen {
   }
 
   void IsVisible() override {
-    SendMark(10, "Stimulus");
+    SendMark(10, kEventStimulus);
   }
 
   void MouseClicked(int button, int x, int y) override {
     if (button == SDL_BUTTON_LEFT) {
-      SendMark(1, "Response");
+      SendMark(1, kEventResponse);
       SwitchToScreen(0);
     } else if (button == SDL_BUTTON_RIGHT) {
-      SendMark(3, "Response");
+      SendMark(3, kEventResponse);
       SwitchToScreen(0);
     }
   }
@@ -126,9 +134,9 @@ class DoorsResultScreen : public Screen {
 
   void IsVisible() override {
     if (is_win_) {
-      SendMark(7, "PositiveFeedback");
+      SendMark(7, kEventPositiveFeedback);
     } else {
-      SendMark(9, "NegativeFeedback");
+      SendMark(9, kEventNegativeFeedback);
     }
 
     SwitchToScreen(0, 2000);
@@ -145,7 +153,8 @@ class DoorsResultScreen : public Screen {
 
 }  // namespace
 
-Screen *InitDoors(Screen *main_screen, const Settings &settings) {
+Screen *InitDoors(Screen *main_screen, const Settings &settings,
+                  RandomStream random) {
   Shuffler<bool> *shuffler = new Shuffler<bool>();
   std::vector<bool> win_array;
   for (int i = 0; i < kTotalTrials / 2; i++) {
@@ -160,14 +169,14 @@ Screen *InitDoors(Screen *main_screen, const Settings &settings) {
   }
 
   shuffler->AddCategoryElements(lose_array, kMaxRunLength);
-  shuffler->ShuffleElements();
+  shuffler->ShuffleElements(&random);
 
-  Screen *loop = new LoopScreen(shuffler);
+  Screen *loop = new LoopScreen(shuffler, random);
   Screen *instructions = new InstructionScreen(
       "Click to start next round.");
-  Screen *fixation1 = new FixationScreen(1000, 1000);
+  Screen *fixation1 = new FixationScreen(1000);
   Screen *choose_door = new ChooseDoorScreen();
-  Screen *fixation2 = new FixationScreen(1000, 1000);
+  Screen *fixation2 = new FixationScreen(1000);
 
   int win_loss_width_cm = kDefaultWinLossWidthCm;
   if (settings.HasKey(kWinLossWidthSetting)) {
@@ -175,7 +184,7 @@ Screen *InitDoors(Screen *main_screen, const Settings &settings) {
   }
 
   Screen *doors_result = new DoorsResultScreen(shuffler, win_loss_width_cm);
-  Screen *fixation3 = new FixationScreen(1500, 1500);
+  Screen *fixation3 = new FixationScreen(1500);
 
   loop->AddSuccessor(instructions);
   loop->AddSuccessor(main_screen);
@@ -17,12 +17,13 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_DOORS_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_DOORS_H_
 
+#include "Random.h"
 #include "Screen.h"
 #include "Settings.h"
 
 namespace stimulus {
 
-Screen *InitDoors(Screen *main_screen, const Settings&);
+Screen *InitDoors(Screen *main_screen, const Settings&, RandomStream random);
 
 }  // namespace stimulus
 
@@ -12,7 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <future>
+#include <map>
 #include "CommonScreens.h"
 #include "EmotionalImages.h"
 #include "Image.h"
@@ -35,76 +39,98 @@ const int kRatingDelayMs = 150;
 const char *kImageDisplayTimeSetting = "image_display_time_ms";
 const int kMaxRunLength = 3;
 
+// Conditions (in the schedule only, they aren't marked)
+const int kConditionPleasant = 1;
+const int kConditionNeutral = 2;
+const int kConditionUnpleasant = 3;
+
 // marks
 const int kMarkTaskStartStop = 999;
 const int kMarkStimulusOffset = 777;
 
+const MarkEventId kEventResponse = InternMarkEvent("Response");
+
 struct EmotionalImage {
   std::string path;
   int mark;
+  MarkEventId event;
 };
 
 struct EmotionalImagesState {
-  std::string current_path;
+  TaskSchedule schedule;
+  std::map<int, EmotionalImage> images;
+  size_t trial_count = 0;
+  MarkEventId current_event;
   std::string image_folder;
   SDL_Texture *current_image = nullptr;
   SDL_Rect dest_rect;
   int current_mark;
-  Shuffler<EmotionalImage> *shuffler = nullptr;
+
+  // The image for the next trial. ImageScreen::Prefetch decodes it in the
+  // background and uploads it while the fixation cross is showing.
+  EmotionalImage next_image;
+  std::future<DecodedImage> next_decode;
+  SDL_Texture *next_texture = nullptr;
 };
 
-void BuildImageList(Shuffler<EmotionalImage>*);
+class PreimageFixationScreen : public FixationScreen {
+ public:
+  // The delay comes from the schedule.
+  explicit PreimageFixationScreen(EmotionalImagesState *state)
+      : FixationScreen(0), state_(state) {}
+
+ protected:
+  int GetDelayMs() override {
+    assert(state_->trial_count < state_->schedule.trials.size());
+    return state_->schedule.trials[state_->trial_count].fixation_ms;
+  }
 
-// This is just a blank screen. It loads the image, then switches
-// to the fixation screen. This ensures there is no delay when
-// the image is displayed.
-class PreloaderScreen : public Screen {
+ private:
+  EmotionalImagesState *state_;
+};
+
+class ImageScreen : public Screen {
  public:
-  PreloaderScreen(EmotionalImagesState *state) : state_(state) {
+  ImageScreen(EmotionalImagesState *state, int image_display_time_ms)
+    : state_(state), image_display_time_ms_(image_display_time_ms) {
   }
 
-  void IsVisible() override {
-    if (state_->shuffler == nullptr) {
-      state_->shuffler = new Shuffler<EmotionalImage>();
-      BuildImageList(state_->shuffler);
+  void Prefetch() override {
+    if (state_->next_decode.valid()) {
+      if (state_->next_decode.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+        state_->next_texture = UploadImage(state_->next_decode.get());
+      }
+    } else if (state_->next_texture == nullptr &&
+               next_trial_ < state_->schedule.trials.size()) {
+      const ScheduledTrial &trial = state_->schedule.trials[next_trial_++];
+      state_->next_image = state_->images[trial.stimuli.front()];
+      state_->next_decode = DecodeImageAsync(
+          state_->image_folder + state_->next_image.path,
+          HorzSizeToPixels(kImageWidthCm));
     }
+  }
 
-    if (state_->shuffler->IsDone()) {
-      state_->current_image = nullptr;
-      delete state_->shuffler;
-      state_->shuffler = nullptr;
-      SwitchToScreen(1);  // Back to selection screen
-      return;
+  void IsActive() override {
+    // This only waits if the fixation was too short to finish loading.
+    Prefetch();
+    if (state_->next_decode.valid()) {
+      state_->next_texture = UploadImage(state_->next_decode.get());
     }
 
-    EmotionalImage image = state_->shuffler->GetNextItem();
-
     if (state_->current_image != nullptr) {
       SDL_DestroyTexture(state_->current_image);
     }
 
-    state_->current_image = LoadImage(state_->image_folder + image.path);
-    if (state_->current_image == nullptr) {
-      // Exit
-      SwitchToScreen(1);
-      return;
+    state_->current_image = state_->next_texture;
+    state_->next_texture = nullptr;
+    state_->trial_count += 1;
+    state_->current_event = state_->next_image.event;
+    state_->current_mark = state_->next_image.mark;
+    if (state_->current_image != nullptr) {
+      state_->dest_rect = ComputeRectForPhysicalWidth(state_->current_image,
+          kImageWidthCm);
     }
-
-    state_->current_path = image.path;
-    state_->current_mark = image.mark;
-    state_->dest_rect = ComputeRectForPhysicalWidth(state_->current_image,
-        kImageWidthCm);
-    SwitchToScreen(0);
-  }
-
- private:
-  EmotionalImagesState *state_;
-};
-
-class ImageScreen : public Screen {
- public:
-  ImageScreen(EmotionalImagesState *state, int image_display_time_ms)
-    : state_(state), image_display_time_ms_(image_display_time_ms) {
   }
 
   void IsInvisible() override { SendMark(kMarkStimulusOffset); }
@@ -118,13 +144,30 @@ class ImageScreen : public Screen {
   }
 
   void IsVisible() override {
-    SendMark(state_->current_mark, state_->current_path);
-    SwitchToScreen(0, image_display_time_ms_);
+    if (state_->current_image == nullptr) {
+      // Exit
+      state_->trial_count = 0;
+      next_trial_ = 0;
+      SwitchToScreen(1);
+      return;
+    }
+
+    SendMark(state_->current_mark, state_->current_event);
+    if (state_->trial_count == state_->schedule.trials.size()) {
+      // Running the task again repeats the schedule.
+      state_->trial_count = 0;
+      next_trial_ = 0;
+      SwitchToScreen(1, image_display_time_ms_);  // Back to selection screen
+    } else {
+      SwitchToScreen(0, image_display_time_ms_);
+    }
   }
 
  private:
   EmotionalImagesState *state_;
   int image_display_time_ms_;
+  // The trial whose image is prefetched next.
+  size_t next_trial_ = 0;
 };
 
 class RatingScreen : public Screen {
@@ -209,7 +252,7 @@ class RatingScreen : public Screen {
       float distance2 = pow(x - dot_x, 2) + pow(y - dot_y, 2);
       if (distance2 <= circle_r2_px) {
         checked_item_ = i;
-        SendMark(mark_base_id_ + i, "Response");
+        SendMark(mark_base_id_ + i, kEventResponse);
         SwitchToScreen(0, kRatingDelayMs);
         break;
       }
@@ -242,44 +285,96 @@ void BuildImageList(std::vector<EmotionalImage> *out_vec,
   for (int i = 0; i < count; i++) {
     std::string path = folder_name + "/" + std::to_string(i + 1) + "_" + suffix
         + ".jpg";
-    EmotionalImage image = { path,  mark_start_id + i };
+    EmotionalImage image = { path,  mark_start_id + i, InternMarkEvent(path) };
     out_vec->push_back(image);
   }
 }
 
-void BuildImageList(Shuffler<EmotionalImage> *shuffler) {
-  std::vector<EmotionalImage> pleasantImages;
-  BuildImageList(&pleasantImages, "pleasant_families_groups", "posgrp", 20, 1);
-  BuildImageList(&pleasantImages, "pleasant_babies", "posbaby", 20, 21);
-  BuildImageList(&pleasantImages, "pleasant_animals", "posaml", 20, 41);
-  shuffler->AddCategoryElements(pleasantImages, kMaxRunLength);
-
-  std::vector<EmotionalImage> neutralImages;
-  BuildImageList(&neutralImages, "neutral_people", "neutppl", 40, 61);
-  BuildImageList(&neutralImages, "neutral_animals", "neutaml", 20, 101);
-  shuffler->AddCategoryElements(neutralImages, kMaxRunLength);
-
-  std::vector<EmotionalImage> unpleasantImages;
-  BuildImageList(&unpleasantImages, "unpleasant_sadness", "negsad", 20, 121);
-  BuildImageList(&unpleasantImages, "unpleasant_disgust", "negdis", 20, 141);
-  BuildImageList(&unpleasantImages, "unpleasant_animals", "negaml", 20, 161);
-  shuffler->AddCategoryElements(unpleasantImages, kMaxRunLength);
-  shuffler->ShuffleElements();
+// Images are identified by their marks.
+std::vector<EmotionalImage> BuildImageList(int condition) {
+  std::vector<EmotionalImage> images;
+  switch (condition) {
+    case kConditionPleasant:
+      BuildImageList(&images, "pleasant_families_groups", "posgrp", 20, 1);
+      BuildImageList(&images, "pleasant_babies", "posbaby", 20, 21);
+      BuildImageList(&images, "pleasant_animals", "posaml", 20, 41);
+      break;
+    case kConditionNeutral:
+      BuildImageList(&images, "neutral_people", "neutppl", 40, 61);
+      BuildImageList(&images, "neutral_animals", "neutaml", 20, 101);
+      break;
+    case kConditionUnpleasant:
+      BuildImageList(&images, "unpleasant_sadness", "negsad", 20, 121);
+      BuildImageList(&images, "unpleasant_disgust", "negdis", 20, 141);
+      BuildImageList(&images, "unpleasant_animals", "negaml", 20, 161);
+      break;
+  }
+
+  return images;
 }
 
+const int kConditions[] = {kConditionPleasant, kConditionNeutral,
+                           kConditionUnpleasant};
+
 }  // namespace
 
-Screen *InitEmotionalImages(Screen *main_screen, const Settings &settings) {
+TaskSchedule CompileEmotionalImagesSchedule(RandomStream *random) {
+  // The image stream is split off first, as it was when the task shuffled
+  // while it ran, so a seed gives the same trials it did then.
+  RandomStream image_random = random->Split();
+  RandomStream fixation_random = random->Split();
+
+  Shuffler<ScheduledTrial> images;
+  for (int condition : kConditions) {
+    std::vector<ScheduledTrial> trials;
+    for (const EmotionalImage &image : BuildImageList(condition)) {
+      ScheduledTrial trial;
+      trial.condition = condition;
+      trial.stimuli.push_back(image.mark);
+      trial.marks.push_back(image.mark);
+      trial.marks.push_back(kMarkStimulusOffset);
+      trials.push_back(trial);
+    }
+
+    images.AddCategoryElements(trials, kMaxRunLength);
+  }
+  images.ShuffleElements(&image_random);
+
+  TaskSchedule schedule;
+  while (!images.IsDone()) {
+    ScheduledTrial trial = images.GetNextItem();
+    trial.fixation_ms = fixation_random.NextInt(kMinPreimageFixationTimeMs,
+                                                kMaxPreimageFixationTimeMs);
+    if (schedule.trials.empty()) {
+      trial.marks.insert(trial.marks.begin(), kMarkTaskStartStop);
+    }
+
+    if (images.IsDone()) {
+      trial.marks.push_back(kMarkTaskStartStop);
+    }
+
+    schedule.trials.push_back(trial);
+  }
+
+  return schedule;
+}
+
+Screen *InitEmotionalImages(Screen *main_screen, const Settings &settings,
+                            const TaskSchedule &schedule) {
   EmotionalImagesState *state = new EmotionalImagesState();
+  state->schedule = schedule;
+  for (int condition : kConditions) {
+    for (const EmotionalImage &image : BuildImageList(condition)) {
+      state->images[image.mark] = image;
+    }
+  }
   state->image_folder = stimulus::GetResourceDir() + "/emotional_images/";
 
   Screen *version = new VersionScreen();
   Screen *start_screen = new InstructionScreen(
       "Click to begin.");
   Screen *start_mark_screen = new MarkScreen(kMarkTaskStartStop);
-  Screen *preloader = new PreloaderScreen(state);
-  Screen *fixation1 = new FixationScreen(kMinPreimageFixationTimeMs,
-      kMaxPreimageFixationTimeMs);
+  Screen *fixation1 = new PreimageFixationScreen(state);
   Screen *finish = new MarkScreen(kMarkTaskStartStop);
 
   int image_display_time_ms = kDefaultImageDisplayTimeMs;
@@ -287,6 +382,9 @@ Screen *InitEmotionalImages(Screen *main_screen, const Settings &settings) {
     image_display_time_ms = settings.GetIntValue(kImageDisplayTimeSetting);
   }
 
+  Screen::WarnIfNotFrameMultiple("Emotional images display time",
+                                 image_display_time_ms);
+
   Screen *image = new ImageScreen(state, image_display_time_ms);
 
 #if ENABLE_RATINGS_SCREEN
@@ -296,16 +394,16 @@ Screen *InitEmotionalImages(Screen *main_screen, const Settings &settings) {
         "What was your emotion when you saw this image", "Unhappy", "Happy",191);
     image->AddSuccessor(rating1);
     rating1->AddSuccessor(rating2);
-    rating2->AddSuccessor(preloader);
+    rating2->AddSuccessor(fixation1);
+#else
+    image->AddSuccessor(fixation1);
 #endif
 
-    image->AddSuccessor(preloader);
+    image->AddSuccessor(finish);
 
     version->AddSuccessor(start_screen);
     start_screen->AddSuccessor(start_mark_screen);
-    start_mark_screen->AddSuccessor(preloader);
-    preloader->AddSuccessor(fixation1);
-    preloader->AddSuccessor(finish);
+    start_mark_screen->AddSuccessor(fixation1);
     fixation1->AddSuccessor(image);
     finish->AddSuccessor(main_screen);
 
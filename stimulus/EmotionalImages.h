@@ -17,12 +17,18 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_EMOTIONALIMAGES_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_EMOTIONALIMAGES_H_
 
+#include "Random.h"
+#include "Schedule.h"
 #include "Screen.h"
 #include "Settings.h"
 
 namespace stimulus {
 
-Screen *InitEmotionalImages(Screen*, const Settings &settings);
+// Draws every trial's image and fixation time.
+TaskSchedule CompileEmotionalImagesSchedule(RandomStream *random);
+
+Screen *InitEmotionalImages(Screen*, const Settings &settings,
+                            const TaskSchedule &schedule);
 
 }  // namespace stimulus
 
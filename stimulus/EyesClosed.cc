@@ -12,11 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+
+#include "Clock.h"
 #include "CommonScreens.h"
 #include "Image.h"
 #include "Mark.h"
 #include "Screen.h"
-#include "Util.h"
 
 namespace stimulus {
 namespace {
@@ -26,30 +28,34 @@ const int kTaskDuration = 2 * 60 * 1000;
 
 const int kMarkTaskStartStop = 999;
 
+const MarkEventId kEventMarker = InternMarkEvent("Marker");
+
 class EyesClosedScreen : public Screen {
  public:
   EyesClosedScreen() {
   }
 
   void IsActive() override {
-    Uint32 now = SDL_GetTicks();
-    next_mark_ = now + kMarkInterval;
-    task_end_ = now + kTaskDuration;
+    int64_t now = GetTimeMicros();
+    next_mark_ = now + MsToMicros(kMarkInterval);
+    task_end_ = now + MsToMicros(kTaskDuration);
   }
 
   void Render() override {
-    Uint32 now = SDL_GetTicks();
-    if (WrappedGreaterEqual(now, task_end_)) {
+    int64_t now = GetTimeMicros();
+    if (now >= task_end_) {
       SwitchToScreen(0);  // Back to selection screen
-    } else if (WrappedGreaterEqual(now, next_mark_)) {
-      SendMark(10, "Marker");
-      next_mark_ += kMarkInterval;
+    } else if (now >= next_mark_) {
+      SendMark(10, kEventMarker);
+      next_mark_ += MsToMicros(kMarkInterval);
     }
+
+    ScheduleRender(std::min(next_mark_, task_end_));
   }
 
  private:
-  Uint32 next_mark_;
-  Uint32 task_end_;
+  int64_t next_mark_;
+  int64_t task_end_;
 };
 
 }  // namespace
@@ -50,6 +50,9 @@ const int kMarkFeedbackGood = 2;
 const int kMarkFeedbackErrorLow = 3;
 const int kMarkTaskStartStop = 999;
 
+const MarkEventId kEventResponseLeft = InternMarkEvent("ResponseLeft");
+const MarkEventId kEventResponseRight = InternMarkEvent("ResponseRight");
+
 // Fixation duration
 const int kMinFixationTimeMs = 1200;
 const int kMaxFixationTimeMs = 1400;
@@ -75,6 +78,7 @@ FlankersStimulus StimuliList[] = {
         /*.texture = */nullptr,
         /*.resource_name = */"left_congruent.svg",
         /*.event = */"StimulusLeftCongruent",
+        /*.event_id = */kUndefinedMarkEvent,
     },
     {
         /*.mark = */kMarkLeftIncongruent,
@@ -82,6 +86,7 @@ FlankersStimulus StimuliList[] = {
         /*.texture = */nullptr,
         /*.resource_name = */"left_incongruent.svg",
         /*.event = */"StimulusLeftIncongruent",
+        /*.event_id = */kUndefinedMarkEvent,
     },
     {
         /*.mark = */kMarkRightCongruent,
@@ -89,6 +94,7 @@ FlankersStimulus StimuliList[] = {
         /*.texture = */nullptr,
         /*.resource_name = */"right_congruent.svg",
         /*.event = */"StimulusRightCongruent",
+        /*.event_id = */kUndefinedMarkEvent,
     },
     {
         /*.mark = */kMarkRightIncongruent,
@@ -96,6 +102,7 @@ FlankersStimulus StimuliList[] = {
         /*.texture = */nullptr,
         /*.resource_name = */"right_incongruent.svg",
         /*.event = */"StimulusRightIncongruent",
+        /*.event_id = */kUndefinedMarkEvent,
     },
 };
 
@@ -131,9 +138,9 @@ class FlankersInstructionScreen : public InstructionExamplesScreen {
 class FlankersFixationScreen : public FixationDotScreen {
  public:
   FlankersFixationScreen(FlankersEngine *engine, const int num_total_trials,
-                         const int num_trials_before_feedback, int min_delay,
-                         int max_delay)
-      : FixationDotScreen(min_delay, max_delay),
+                         const int num_trials_before_feedback,
+                         RandomStream random, int min_delay, int max_delay)
+      : FixationDotScreen(random, min_delay, max_delay),
         engine_(engine),
         num_total_trials_(num_total_trials),
         num_trials_before_feedback_(num_trials_before_feedback) {}
@@ -166,9 +173,9 @@ class FlankersFixationScreen : public FixationDotScreen {
       keypressed_ = true;
       char c = ScodeToChar(scode);
       if (c == kCharLeft) {
-        SendMark(kMarkLeftResponse, "ResponseLeft");
+        SendMark(kMarkLeftResponse, kEventResponseLeft);
       } else if (c == kCharRight) {
-        SendMark(kMarkRightResponse, "ResponseRight");
+        SendMark(kMarkRightResponse, kEventResponseRight);
       }
       engine_->RecordKeyPress(c);
     }
@@ -268,7 +275,7 @@ class FlankersTrialScreen : public Screen {
   void Render() override { Blit(next_stimulus_->texture.get(), dest_rect_); }
 
   void IsVisible() override {
-    SendMark(next_stimulus_->mark, next_stimulus_->event);
+    SendMark(next_stimulus_->mark, next_stimulus_->event_id);
   }
 
   void IsInvisible() override { SendMark(kMarkOffset); }
@@ -281,10 +288,15 @@ class FlankersTrialScreen : public Screen {
 
 }  // namespace
 
-Screen *InitFlankers(Screen *main_screen, const Settings &settings) {
+Screen *InitFlankers(Screen *main_screen, const Settings &settings,
+                     RandomStream random) {
+  Screen::WarnIfNotFrameMultiple("Flankers stimulus time",
+                                 kStimuliDisplayTimeMs);
+
   // Load textures for stimuli
   int num_stimuli = 0;
   for (auto &s : StimuliList) {
+    s.event_id = InternMarkEvent(s.event);
     if (s.texture == nullptr) {
       s.texture = std::shared_ptr<SDL_Texture>(
           LoadImage(GetResourceDir() + s.resource_name), SDL_TextureDeleter());
@@ -312,17 +324,18 @@ Screen *InitFlankers(Screen *main_screen, const Settings &settings) {
         settings.GetIntValue(kNumTrialsBeforeFeedbackSetting);
   }
 
-  FlankersEngine *engine = new FlankersEngine(StimuliList, num_stimuli,
-                                              num_trials_per_stimuli, kMaxRun);
+  FlankersEngine *engine =
+      new FlankersEngine(StimuliList, num_stimuli, num_trials_per_stimuli,
+                         kMaxRun, random.Split());
 
   Screen *version = new VersionScreen();
   Screen *instructions = new FlankersInstructionScreen(
       engine, StimuliList[0].texture, StimuliList[3].texture);
-  Screen *initial_fixation =
-      new FixationDotScreen(kMinFixationTimeMs, kMaxFixationTimeMs);
+  Screen *initial_fixation = new FixationDotScreen(
+      random.Split(), kMinFixationTimeMs, kMaxFixationTimeMs);
   Screen *fixation = new FlankersFixationScreen(
-      engine, num_total_trials, num_trials_before_feedback, kMinFixationTimeMs,
-      kMaxFixationTimeMs);
+      engine, num_total_trials, num_trials_before_feedback, random.Split(),
+      kMinFixationTimeMs, kMaxFixationTimeMs);
   Screen *feedback = new FlankersFeedbackScreen(engine, num_total_trials,
                                                 num_trials_before_feedback);
   Screen *trial = new FlankersTrialScreen(engine);
@@ -20,7 +20,8 @@ namespace stimulus {
 
 FlankersEngine::FlankersEngine(const FlankersStimulus stimuli_list[],
                                int num_stimuli, int trials_per_stimuli,
-                               int max_run) {
+                               int max_run, RandomStream random)
+    : random_(random) {
   // Use Shuffler class to ensure we generate exactly the number of required
   // stimuli, and that no rare stimuli is presented more than three times in a
   // row.
@@ -29,7 +30,7 @@ FlankersEngine::FlankersEngine(const FlankersStimulus stimuli_list[],
     std::fill(stimuli.begin(), stimuli.end(), &stimuli_list[i]);
     shuffler_.AddCategoryElements(stimuli, max_run);
   }
-  shuffler_.ShuffleElements();
+  shuffler_.ShuffleElements(&random_);
 }
 
 FlankersEngine::~FlankersEngine() {}
@@ -38,7 +39,7 @@ void FlankersEngine::Reset() {
   trial_count_ = 0;
   trials_.clear();
   keys_.clear();
-  shuffler_.ShuffleElements();
+  shuffler_.ShuffleElements(&random_);
 }
 
 const FlankersStimulus *FlankersEngine::GetNextTrial() {
@@ -21,6 +21,8 @@
 #include <vector>
 #include "SDL.h"
 
+#include "Mark.h"
+#include "Random.h"
 #include "Shuffler.h"
 
 namespace stimulus {
@@ -31,6 +33,7 @@ struct FlankersStimulus {
   std::shared_ptr<SDL_Texture> texture;
   std::string resource_name;
   std::string event;
+  MarkEventId event_id;
 };
 
 const char kCharLeft = 's';
@@ -40,7 +43,7 @@ const char kCharNone = '\0';
 class FlankersEngine {
  public:
   FlankersEngine(const FlankersStimulus stimuli_list[], int num_stimuli,
-                 int trials_per_stimuli, int max_run);
+                 int trials_per_stimuli, int max_run, RandomStream random);
   virtual ~FlankersEngine();
 
   void Reset();
@@ -57,6 +60,7 @@ class FlankersEngine {
   std::vector<const FlankersStimulus *> trials_;
   std::vector<char> keys_;
   Shuffler<const FlankersStimulus *> shuffler_;
+  RandomStream random_;
 };
 
 }  // namespace stimulus
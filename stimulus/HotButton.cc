@@ -17,6 +17,7 @@
 #include <cassert>
 #include <memory>
 
+#include "Clock.h"
 #include "CommonScreens.h"
 #include "HotButtonEngine.h"
 #include "Image.h"
@@ -130,6 +131,7 @@ class HotButtonInstructionScreen : public Screen {
  public:
   HotButtonInstructionScreen(const std::string instructions[],
                              int num_instructions) {
+    SetStatic(true);
     Layout(instructions, num_instructions);
   }
 
@@ -142,7 +144,9 @@ class HotButtonInstructionScreen : public Screen {
   void KeyPressed(SDL_Scancode) override { SwitchToScreen(0); }
 
  protected:
-  HotButtonInstructionScreen() {}
+  HotButtonInstructionScreen() {
+    SetStatic(true);
+  }
 
   void Layout(const std::string instructions[], int num_instructions) {
     instructions_.clear();
@@ -396,10 +400,11 @@ class PretaskScreen : public Screen {
   void Render() override {
     int countdown = 0;
     if (start_time_ == 0) {
-      start_time_ = SDL_GetTicks();
+      start_time_ = GetTimeMicros();
       countdown = kPretaskTimeS;
     } else {
-      countdown = kPretaskTimeS - ((SDL_GetTicks() - start_time_) / 1000);
+      countdown = kPretaskTimeS -
+                  ((GetTimeMicros() - start_time_) / kMicrosPerSecond);
     }
     if (countdown < 0) {
       countdown = 0;
@@ -407,6 +412,10 @@ class PretaskScreen : public Screen {
     if (countdown > kPretaskTimeS) {
       countdown = kPretaskTimeS;
     }
+    if (countdown > 0) {
+      ScheduleRender(start_time_ +
+                     (kPretaskTimeS - countdown + 1) * kMicrosPerSecond);
+    }
     if (countdown >= 10) {
       DrawString(countdown_location_2_.x, countdown_location_2_.y,
                  std::to_string(countdown), kFontScale);
@@ -435,7 +444,7 @@ class PretaskScreen : public Screen {
   SDL_Point countdown_location_1_;
   SDL_Point countdown_location_2_;
 
-  int start_time_;
+  int64_t start_time_;
 };
 
 // This is a blank screen. The purpose is to timestamp the beginning of the
@@ -446,7 +455,7 @@ class PreloadScreen : public Screen {
 
   void IsActive() override {
     engine_->Reset();
-    engine_->SetStartTime(SDL_GetTicks());
+    engine_->SetStartTime(GetTimeMicros());
     SwitchToScreen(0);
   }
 
@@ -680,10 +689,11 @@ class TaskScreen : public Screen {
   void Render() override {
     int countdown = 0;
     if (start_time_ == 0) {
-      start_time_ = SDL_GetTicks();
+      start_time_ = GetTimeMicros();
       countdown = timeout_s_;
     } else {
-      countdown = timeout_s_ - ((SDL_GetTicks() - start_time_) / 1000);
+      countdown =
+          timeout_s_ - ((GetTimeMicros() - start_time_) / kMicrosPerSecond);
     }
     if (countdown < 0) {
       countdown = 0;
@@ -691,6 +701,10 @@ class TaskScreen : public Screen {
     if (countdown > timeout_s_) {
       countdown = timeout_s_;
     }
+    if (countdown > 0) {
+      ScheduleRender(start_time_ +
+                     (timeout_s_ - countdown + 1) * kMicrosPerSecond);
+    }
     if (countdown >= 10) {
       DrawString(countdown_location_2_.x, countdown_location_2_.y,
                  std::to_string(countdown), kFontScale);
@@ -736,7 +750,7 @@ class TaskScreen : public Screen {
   SDL_Rect progress_rect_;
   SDL_Rect progress_filled_rect_;
 
-  int start_time_;
+  int64_t start_time_;
   int timeout_s_;
   int num_keypresses_;
   SDL_Scancode next_scode_;
@@ -939,8 +953,8 @@ class SummaryScreen : public Screen {
   void IsVisible() override { SendMark(kMarkSummary); }
 
   void KeyPressed(SDL_Scancode scode) override {
-    int current_time = SDL_GetTicks();
-    if (current_time - engine_->GetStartTime() > kTotalTimeMs) {
+    int64_t current_time = GetTimeMicros();
+    if (current_time - engine_->GetStartTime() > MsToMicros(kTotalTimeMs)) {
       SwitchToScreen(1);
     } else {
       SwitchToScreen(0);
@@ -962,10 +976,13 @@ class SummaryScreen : public Screen {
 
 }  // namespace
 
-Screen *InitHotButton(Screen *main_screen, const Settings &settings) {
+Screen *InitHotButton(Screen *main_screen, const Settings &settings,
+                      RandomStream random) {
   std::shared_ptr<TextureManager> texture_manager(new TextureManager());
-  std::shared_ptr<HotButtonEngine> engine(new HotButtonEngine());
-  std::shared_ptr<HotButtonEngine> demo_engine(new HotButtonDemoEngine());
+  std::shared_ptr<HotButtonEngine> engine(
+      new HotButtonEngine(random.Split()));
+  std::shared_ptr<HotButtonEngine> demo_engine(
+      new HotButtonDemoEngine(random.Split()));
 
   // Version
   Screen *version = new VersionScreen();
@@ -1001,8 +1018,8 @@ Screen *InitHotButton(Screen *main_screen, const Settings &settings) {
   Screen *ready = new TimeoutScreen(kReady, kReadyTimeMs);
   Screen *task = new TaskScreen(texture_manager, engine);
   Screen *task_finish = new MarkScreen(kMarkTimerStop);
-  Screen *fixation =
-      new FixationDotScreen(kMinFixationTimeMs, kMaxFixationTimeMs);
+  Screen *fixation = new FixationDotScreen(
+      random.Split(), kMinFixationTimeMs, kMaxFixationTimeMs);
   Screen *result = new ResultScreen(engine, kResultTimeMs);
   Screen *dice = new DiceScreen(kDiceTimeMs);
   Screen *feedback = new FeedbackScreen(engine, kFeedbackTimeMs);
@@ -28,14 +28,14 @@ const int kTrialTimeoutHard = 15000;
 
 HotButtonTrial HotButtonEngine::GetNextTrial() {
   next_trial_.easy_points = kHotButtonPoints100;
-  double r = GenerateRandomDouble();
+  double r = random_.NextDouble();
   if (r < 0.5) {
     next_trial_.hard_points = kHotButtonPoints300;
   } else {
     next_trial_.hard_points = kHotButtonPoints500;
   }
 
-  r = GenerateRandomDouble();
+  r = random_.NextDouble();
   if (r < 0.33) {
     next_trial_.win_probability_pct = kHotButtonWinPercent12;
   } else if (r < 0.66) {
@@ -79,7 +79,7 @@ int HotButtonEngine::GetTrialTimeout() {
 
 void HotButtonEngine::SucceedTrial() {
   last_trial_success_ = true;
-  double r = GenerateRandomDouble();
+  double r = random_.NextDouble();
   if (r * 100 < next_trial_.win_probability_pct) {
     last_won_points_ =
         next_trial_easy_ ? next_trial_.easy_points : next_trial_.hard_points;
@@ -17,6 +17,10 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_HOTBUTTON_HOTBUTTONENGINE_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_HOTBUTTON_HOTBUTTONENGINE_H_
 
+#include <cstdint>
+
+#include "Random.h"
+
 namespace stimulus {
 
 const int kHotButtonWinPercent12 = 12;
@@ -36,10 +40,11 @@ struct HotButtonTrial {
 
 class HotButtonEngine {
  public:
+  explicit HotButtonEngine(RandomStream random) : random_(random) {}
   virtual ~HotButtonEngine() {}
 
   void SetLeftHandedness(bool left_handed) { left_handed_ = left_handed; }
-  void SetStartTime(int start_time) { start_time_ = start_time; }
+  void SetStartTime(int64_t start_time) { start_time_ = start_time; }
   void SetEasyTrial(bool easy) { next_trial_easy_ = easy; }
 
   bool GetLeftHandedness() { return left_handed_; }
@@ -48,7 +53,7 @@ class HotButtonEngine {
   int GetLastTrialPoints() { return last_won_points_; }
   int GetPotentialTotalPoints() { return potential_total_points_; }
   int GetTotalPoints() { return total_points_; }
-  int GetStartTime() { return start_time_; }
+  int64_t GetStartTime() { return start_time_; }
   int GetTrialNumKeypresses();
   int GetTrialTimeout();
 
@@ -65,7 +70,7 @@ class HotButtonEngine {
  private:
   // task properties
   bool left_handed_;
-  int start_time_;
+  int64_t start_time_;
   int total_points_ = 0;
   int potential_total_points_;
   // trial properties
@@ -73,10 +78,13 @@ class HotButtonEngine {
   int last_won_points_;
   bool next_trial_easy_;
   HotButtonTrial next_trial_;
+  RandomStream random_;
 };
 
 class HotButtonDemoEngine : public HotButtonEngine {
  public:
+  explicit HotButtonDemoEngine(RandomStream random)
+      : HotButtonEngine(random) {}
   virtual ~HotButtonDemoEngine() {}
   virtual HotButtonTrial GetNextTrial() override;
 
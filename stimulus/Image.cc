@@ -14,27 +14,608 @@
 
 #include "Image.h"
 #include <SDL_image.h>
+#include <algorithm>
 #include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+#include "Clock.h"
 #include "Platform.h"
+#include "Resample.h"
+#include "ResourcePack.h"
 #include "Screen.h"
+#include "StartupProfile.h"
+#include "SvgCache.h"
+#include "WorkerPool.h"
 
 namespace stimulus {
+namespace {
 
-SDL_Texture *LoadImage(const std::string &path) {
-  SDL_Surface *surface = IMG_Load(path.c_str());
+const int kMaxDecodeThreads = 4;
+const double kBytesPerMb = 1024 * 1024;
 
+struct LoadStats {
+  int count = 0;
+  int64_t total_decode_us = 0;
+  int64_t max_decode_us = 0;
+  int64_t total_upload_us = 0;
+  int64_t max_upload_us = 0;
+  int64_t upload_bytes = 0;
+  int svg_count = 0;
+  int svg_cached = 0;
+};
+
+// Decoding happens on the worker threads.
+std::mutex load_stats_mutex;
+LoadStats load_stats;
+
+// Set up before any images load, and read only after that.
+ResourcePack resource_pack;
+
+// Returns false if path isn't in the resource pack (or there isn't one).
+bool FindPackedResource(const std::string &path, const uint8_t **data,
+                        size_t *size) {
+  const std::string &resource_dir = GetResourceDir();
+  if (resource_pack.GetNumResources() == 0 ||
+      path.compare(0, resource_dir.size(), resource_dir) != 0) {
+    return false;
+  }
+
+  return resource_pack.Find(path.substr(resource_dir.size()), data, size);
+}
+
+// Leave a core for the main thread.
+WorkerPool &GetDecodePool() {
+  static WorkerPool pool(std::max(1, std::min(
+      kMaxDecodeThreads,
+      static_cast<int>(std::thread::hardware_concurrency()) - 1)));
+  return pool;
+}
+
+// Lower case, without the dot.
+std::string GetExtension(const std::string &path) {
+  std::string::size_type dot = path.rfind('.');
+  if (dot == std::string::npos) {
+    return "";
+  }
+
+  std::string extension = path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 ::tolower);
+  return extension;
+}
+
+// Returns an empty vector if the file couldn't be read.
+std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::vector<uint8_t> contents;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return contents;
+  }
+
+  uint8_t buffer[65536];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.insert(contents.end(), buffer, buffer + count);
+  }
+
+  fclose(file);
+  return contents;
+}
+
+#ifdef HAVE_LIBJPEG
+const int kMaxJpegScaleDenominator = 8;
+
+struct FileCloser {
+  void operator()(FILE *file) const { fclose(file); }
+};
+
+bool HasJpegExtension(const std::string &path) {
+  std::string extension = GetExtension(path);
+  return extension == "jpg" || extension == "jpeg";
+}
+
+struct JpegErrorManager {
+  jpeg_error_mgr manager;
+  jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+void JpegErrorExit(j_common_ptr info) {
+  JpegErrorManager *errors = reinterpret_cast<JpegErrorManager *>(info->err);
+  info->err->format_message(info, errors->message);
+  longjmp(errors->jump, 1);
+}
+
+// Returns the largest 1/n scale at which libjpeg's output is still at
+// least width x height, so the resampler only has to shrink it a little.
+int GetJpegScaleDenominator(const jpeg_decompress_struct &info, int width,
+                            int height) {
+  for (int denominator = kMaxJpegScaleDenominator; denominator > 1;
+       denominator /= 2) {
+    int scaled_width = (info.image_width + denominator - 1) / denominator;
+    int scaled_height = (info.image_height + denominator - 1) / denominator;
+    if (scaled_width >= width && scaled_height >= height) {
+      return denominator;
+    }
+  }
+
+  return 1;
+}
+
+// libjpeg 8 added reading from memory, and libjpeg-turbo has it whichever
+// version it emulates. Without it, packed JPEGs are read from their files.
+#if JPEG_LIB_VERSION >= 80 || defined(MEM_SRCDST_SUPPORTED)
+#define HAVE_JPEG_MEM_SRC
+#endif
+
+// libjpeg 7 added separate horizontal and vertical IDCT scaling.
+#if JPEG_LIB_VERSION >= 70
+int GetScaledBlockWidth(const jpeg_component_info &component) {
+  return component.DCT_h_scaled_size;
+}
+
+int GetScaledBlockHeight(const jpeg_component_info &component) {
+  return component.DCT_v_scaled_size;
+}
+#else
+int GetScaledBlockWidth(const jpeg_component_info &component) {
+  return component.DCT_scaled_size;
+}
+
+int GetScaledBlockHeight(const jpeg_component_info &component) {
+  return component.DCT_scaled_size;
+}
+#endif
+
+// Most JPEGs store YCbCr, which libjpeg can hand back without converting.
+bool CanDecodeToYuv(const jpeg_decompress_struct &info) {
+  return (info.jpeg_color_space == JCS_YCbCr && info.num_components == 3) ||
+         (info.jpeg_color_space == JCS_GRAYSCALE && info.num_components == 1);
+}
+
+// The components of a JPEG, each at its own sampling resolution. The data
+// is padded out to whole blocks.
+struct JpegPlanes {
+  int num_components;
+  std::vector<uint8_t> data[3];
+  int pitches[3];
+  int widths[3];
+  int heights[3];
+};
+
+void ResizePlane(const uint8_t *src, int src_width, int src_height,
+                 int src_pitch, uint8_t *dest, int dest_width,
+                 int dest_height, int dest_pitch) {
+  if (src_width != dest_width || src_height != dest_height) {
+    ResampleImage(src, src_width, src_height, src_pitch, dest, dest_width,
+                  dest_height, dest_pitch, 1);
+    return;
+  }
+
+  for (int y = 0; y < dest_height; y++) {
+    memcpy(dest + y * dest_pitch, src + y * src_pitch, dest_width);
+  }
+}
+
+// Resamples each component to the size it has in an IYUV texture. This
+// also handles JPEGs that aren't 4:2:0 (and grayscale ones).
+std::unique_ptr<YuvImage> ConvertToYuvImage(const JpegPlanes &planes,
+                                            int width, int height) {
+  std::unique_ptr<YuvImage> image(new YuvImage);
+  image->width = width;
+  image->height = height;
+  for (int c = 0; c < 3; c++) {
+    int plane_width = c == 0 ? width : (width + 1) / 2;
+    int plane_height = c == 0 ? height : (height + 1) / 2;
+    image->pitches[c] = plane_width;
+    if (c >= planes.num_components) {
+      // Grayscale
+      image->planes[c].assign(plane_width * plane_height, 128);
+      continue;
+    }
+
+    image->planes[c].resize(plane_width * plane_height);
+    ResizePlane(planes.data[c].data(), planes.widths[c], planes.heights[c],
+                planes.pitches[c],
+                image->planes[c].data(), plane_width, plane_height,
+                plane_width);
+  }
+
+  return image;
+}
+
+// Decodes into image->yuv if yuv is set and the JPEG is stored as YCbCr.
+// Otherwise decodes straight into an RGB24 surface, which the texture
+// upload can use without SDL_image converting it first. If width_px is
+// smaller than the image, it is shrunk to that width while decoding. data is
+// the file's contents if it's in the resource pack, otherwise null.
+void DecodeJpeg(const std::string &path, const uint8_t *data, size_t size,
+                int width_px, bool yuv, DecodedImage *image) {
+#ifndef HAVE_JPEG_MEM_SRC
+  data = nullptr;
+#endif
+
+  std::unique_ptr<FILE, FileCloser> file;
+  if (data == nullptr) {
+    file.reset(fopen(path.c_str(), "rb"));
+    if (file == nullptr) {
+      image->error = "couldn't open file";
+      return;
+    }
+  }
+
+  jpeg_decompress_struct info;
+  JpegErrorManager errors;
+  SDL_Surface *volatile decoded = nullptr;
+  std::unique_ptr<JpegPlanes> planes(new JpegPlanes);
+  info.err = jpeg_std_error(&errors.manager);
+  errors.manager.error_exit = JpegErrorExit;
+  if (setjmp(errors.jump)) {
+    image->error = errors.message;
+    jpeg_destroy_decompress(&info);
+    SDL_FreeSurface(decoded);
+    return;
+  }
+
+  jpeg_create_decompress(&info);
+#ifdef HAVE_JPEG_MEM_SRC
+  if (file == nullptr) {
+    jpeg_mem_src(&info, const_cast<uint8_t *>(data), size);
+  } else {
+    jpeg_stdio_src(&info, file.get());
+  }
+#else
+  jpeg_stdio_src(&info, file.get());
+#endif
+
+  jpeg_read_header(&info, TRUE);
+  if (yuv && CanDecodeToYuv(info)) {
+    info.raw_data_out = TRUE;
+    info.out_color_space = info.jpeg_color_space;
+  } else {
+    info.out_color_space = JCS_RGB;
+  }
+
+  int width = info.image_width;
+  int height = info.image_height;
+  if (width_px > 0 && width_px < width) {
+    // This rounds the same way as Screen::ComputeRectForPhysicalWidth, so
+    // the texture is drawn unscaled.
+    float scale = static_cast<float>(width_px) / width;
+    height = std::max(1, static_cast<int>(scale * height));
+    width = width_px;
+    info.scale_num = 1;
+    info.scale_denom = GetJpegScaleDenominator(info, width, height);
+  }
+
+  jpeg_start_decompress(&info);
+  if (info.raw_data_out) {
+    // Each call to jpeg_read_raw_data returns one row of MCUs, which is a
+    // different number of rows for each component.
+    JSAMPROW rows[3][MAX_SAMP_FACTOR * DCTSIZE];
+    JSAMPARRAY components[3];
+    int rows_per_call[3];
+    planes->num_components = info.num_components;
+    for (int c = 0; c < info.num_components; c++) {
+      const jpeg_component_info &component = info.comp_info[c];
+      rows_per_call[c] = component.v_samp_factor *
+                         GetScaledBlockHeight(component);
+      if (rows_per_call[c] > MAX_SAMP_FACTOR * DCTSIZE) {
+        image->error = "unsupported sampling factors";
+        jpeg_destroy_decompress(&info);
+        return;
+      }
+
+      planes->pitches[c] = component.width_in_blocks *
+                           GetScaledBlockWidth(component);
+      planes->widths[c] = component.downsampled_width;
+      planes->heights[c] = component.downsampled_height;
+      planes->data[c].resize(static_cast<size_t>(planes->pitches[c]) *
+                             info.total_iMCU_rows * rows_per_call[c]);
+      components[c] = rows[c];
+    }
+
+    for (int mcu_row = 0; info.output_scanline < info.output_height;
+         mcu_row++) {
+      for (int c = 0; c < info.num_components; c++) {
+        for (int i = 0; i < rows_per_call[c]; i++) {
+          rows[c][i] = &planes->data[c][
+              (static_cast<size_t>(mcu_row) * rows_per_call[c] + i) *
+              planes->pitches[c]];
+        }
+      }
+
+      jpeg_read_raw_data(&info, components,
+                         info.max_v_samp_factor * DCTSIZE);
+    }
+
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    image->yuv = ConvertToYuvImage(*planes, width, height);
+    return;
+  }
+
+  decoded = SDL_CreateRGBSurfaceWithFormat(0, info.output_width,
+                                           info.output_height, 24,
+                                           SDL_PIXELFORMAT_RGB24);
+  if (decoded == nullptr) {
+    image->error = SDL_GetError();
+    jpeg_destroy_decompress(&info);
+    return;
+  }
+
+  while (info.output_scanline < info.output_height) {
+    JSAMPROW row = static_cast<Uint8 *>(decoded->pixels) +
+                   info.output_scanline * decoded->pitch;
+    jpeg_read_scanlines(&info, &row, 1);
+  }
+
+  jpeg_finish_decompress(&info);
+  jpeg_destroy_decompress(&info);
+  if (decoded->w == width && decoded->h == height) {
+    image->surface.reset(decoded);
+    return;
+  }
+
+  SDL_Surface *resized = SDL_CreateRGBSurfaceWithFormat(
+      0, width, height, 24, SDL_PIXELFORMAT_RGB24);
+  if (resized == nullptr) {
+    image->error = SDL_GetError();
+    SDL_FreeSurface(decoded);
+    return;
+  }
+
+  ResampleImage(static_cast<const uint8_t *>(decoded->pixels), decoded->w,
+                decoded->h, decoded->pitch,
+                static_cast<uint8_t *>(resized->pixels), width, height,
+                resized->pitch, 3);
+  SDL_FreeSurface(decoded);
+  image->surface.reset(resized);
+}
+#endif
+
+// JPEGs are stored as YCbCr, which the renderer can convert to RGB itself
+// if it supports YUV textures natively. Otherwise SDL would convert them in
+// software on every upload, and RGB surfaces are faster. Called on the main
+// thread, since it queries the renderer.
+bool CanUploadYuv() {
+#if SDL_VERSION_ATLEAST(2, 0, 8)
+  static bool supported = [] {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(Screen::GetRenderer(), &info) != 0) {
+      return false;
+    }
+
+    for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+      if (info.texture_formats[i] == SDL_PIXELFORMAT_IYUV) {
+        // JPEG uses the full 0-255 range, rather than video levels.
+        SDL_SetYUVConversionMode(SDL_YUV_CONVERSION_JPEG);
+        return true;
+      }
+    }
+
+    return false;
+  }();
+
+  return supported;
+#else
+  // Older versions always convert YUV assuming video levels, which would
+  // wash out JPEG colours.
+  return false;
+#endif
+}
+
+void AddUploadStats(const std::string &path, int64_t elapsed,
+                    int64_t bytes) {
+  AddProfiledUpload(path, elapsed, bytes);
+  std::lock_guard<std::mutex> lock(load_stats_mutex);
+  load_stats.count++;
+  load_stats.total_upload_us += elapsed;
+  load_stats.max_upload_us = std::max(load_stats.max_upload_us, elapsed);
+  load_stats.upload_bytes += bytes;
+}
+
+SDL_Texture *UploadYuvImage(const std::string &path, const YuvImage &image) {
+  int64_t start = GetWallTimeMicros();
+  SDL_Texture *texture = SDL_CreateTexture(
+      Screen::GetRenderer(), SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STATIC,
+      image.width, image.height);
+  if (texture == nullptr) {
+    Screen::FatalError("Couldn't load image " + path +
+                       ": SDL_CreateTexture: " + SDL_GetError());
+    return nullptr;
+  }
+
+  if (SDL_UpdateYUVTexture(texture, nullptr, image.planes[0].data(),
+                           image.pitches[0], image.planes[1].data(),
+                           image.pitches[1], image.planes[2].data(),
+                           image.pitches[2]) != 0) {
+    Screen::FatalError("Couldn't load image " + path +
+                       ": SDL_UpdateYUVTexture: " + SDL_GetError());
+    SDL_DestroyTexture(texture);
+    return nullptr;
+  }
+
+  int64_t bytes = 0;
+  for (const std::vector<uint8_t> &plane : image.planes) {
+    bytes += plane.size();
+  }
+
+  AddUploadStats(path, GetWallTimeMicros() - start, bytes);
+  return texture;
+}
+
+}  // namespace
+
+DecodedImage DecodeImage(const std::string &path, int width_px, bool yuv) {
+  int64_t start = GetWallTimeMicros();
+  DecodedImage image;
+  image.path = path;
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  FindPackedResource(path, &data, &size);
+#ifdef HAVE_LIBJPEG
+  if (HasJpegExtension(path)) {
+    DecodeJpeg(path, data, size, width_px, yuv, &image);
+  }
+#endif
+
+  bool svg = GetExtension(path) == "svg";
+  bool svg_cached = false;
+  if (svg) {
+    std::vector<uint8_t> contents;
+    if (data == nullptr) {
+      contents = ReadFile(path);
+      data = contents.data();
+      size = contents.size();
+    }
+
+    if (size == 0) {
+      image.error = "Couldn't read " + path;
+    } else {
+      image.surface.reset(LoadSvg(data, size, width_px, &svg_cached,
+                                  &image.error));
+    }
+  } else if (image.surface == nullptr && image.yuv == nullptr) {
+    if (data != nullptr) {
+      // SDL_image uses the extension as a hint, like IMG_Load does.
+      image.surface.reset(IMG_LoadTyped_RW(
+          SDL_RWFromConstMem(data, static_cast<int>(size)), 1,
+          GetExtension(path).c_str()));
+    } else {
+      image.surface.reset(IMG_Load(path.c_str()));
+    }
+
+    if (image.surface == nullptr) {
+      image.error = IMG_GetError();
+    }
+  }
+
+  int64_t elapsed = GetWallTimeMicros() - start;
+  int64_t bytes = 0;
+  if (image.yuv != nullptr) {
+    for (const std::vector<uint8_t> &plane : image.yuv->planes) {
+      bytes += plane.size();
+    }
+  } else if (image.surface != nullptr) {
+    bytes = static_cast<int64_t>(image.surface->pitch) * image.surface->h;
+  }
+
+  AddProfiledDecode(path, elapsed, bytes);
+  std::lock_guard<std::mutex> lock(load_stats_mutex);
+  load_stats.total_decode_us += elapsed;
+  load_stats.max_decode_us = std::max(load_stats.max_decode_us, elapsed);
+  if (svg) {
+    load_stats.svg_count++;
+    load_stats.svg_cached += svg_cached;
+  }
+
+  return image;
+}
+
+bool UseResourcePack(const std::string &path) {
+  size_t size;
+  const void *data = MapFile(path, &size);
+  if (data == nullptr) {
+    return false;
+  }
+
+  if (!resource_pack.Parse(data, size)) {
+    SDL_Log("%s is not a valid resource pack\n", path.c_str());
+    return false;
+  }
+
+  // The build writes the pack after copying the resources, so a copy that
+  // is newer (or a different size) has been edited since, and is loaded
+  // instead of the packed version.
+  int64_t pack_size;
+  int64_t pack_time;
+  if (!GetFileInfo(path, &pack_size, &pack_time)) {
+    return true;
+  }
+
+  const std::string &resource_dir = GetResourceDir();
+  for (const std::string &name : resource_pack.GetNames()) {
+    const uint8_t *packed_data;
+    size_t packed_size;
+    int64_t file_size;
+    int64_t file_time;
+    resource_pack.Find(name, &packed_data, &packed_size);
+    if (GetFileInfo(resource_dir + name, &file_size, &file_time) &&
+        (file_time > pack_time ||
+         file_size != static_cast<int64_t>(packed_size))) {
+      SDL_Log("%s has changed since %s was built, so it is loaded from the "
+              "resources directory\n", name.c_str(), path.c_str());
+      resource_pack.Remove(name);
+    }
+  }
+
+  return true;
+}
+
+SDL_Texture *LoadImage(const std::string &path, int width_px) {
+  return UploadImage(DecodeImage(path, width_px, CanUploadYuv()));
+}
+
+std::future<DecodedImage> DecodeImageAsync(const std::string &path,
+                                           int width_px) {
+  bool yuv = CanUploadYuv();
+  return GetDecodePool().Submit([path, width_px, yuv] {
+    return DecodeImage(path, width_px, yuv);
+  });
+}
+
+SDL_Texture *UploadImage(DecodedImage image) {
+  if (image.yuv != nullptr) {
+    return UploadYuvImage(image.path, *image.yuv);
+  }
+
+  if (image.surface == nullptr) {
+    Screen::FatalError("Couldn't load image " + image.path + ": " +
+                       image.error);
+    return nullptr;
+  }
+
+  int64_t start = GetWallTimeMicros();
   SDL_Texture *texture = SDL_CreateTextureFromSurface(Screen::GetRenderer(),
-      surface);
+      image.surface.get());
   if (texture == nullptr) {
-    SDL_FreeSurface(surface);
     Screen::FatalError(
         std::string("Image::Image: SDL_CreateTextureFromSurface: ")
         + SDL_GetError());
     return nullptr;
   }
 
-  SDL_FreeSurface(surface);
+  AddUploadStats(image.path, GetWallTimeMicros() - start,
+                 static_cast<int64_t>(image.surface->pitch) *
+                     image.surface->h);
   return texture;
 }
 
+void LogImageLoadStats(const char *label) {
+  std::lock_guard<std::mutex> lock(load_stats_mutex);
+  if (load_stats.count > 0) {
+    SDL_Log("%s: loaded %d images, decode %.1f ms total (max %.1f ms), "
+            "upload %.1f ms total (max %.1f ms) for %.1f MB\n", label,
+            load_stats.count,
+            static_cast<double>(load_stats.total_decode_us) / kMicrosPerMs,
+            static_cast<double>(load_stats.max_decode_us) / kMicrosPerMs,
+            static_cast<double>(load_stats.total_upload_us) / kMicrosPerMs,
+            static_cast<double>(load_stats.max_upload_us) / kMicrosPerMs,
+            load_stats.upload_bytes / kBytesPerMb);
+  }
+
+  if (load_stats.svg_count > 0) {
+    SDL_Log("%s: %d of %d SVGs were already rasterized\n", label,
+            load_stats.svg_cached, load_stats.svg_count);
+  }
+
+  load_stats = LoadStats();
+}
+
 }  // namespace stimulus
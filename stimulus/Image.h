@@ -18,11 +18,72 @@
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_IMAGE_H_
 
 #include <SDL.h>
+#include <cstdint>
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include "Util.h"
 
 namespace stimulus {
 
-SDL_Texture *LoadImage(const std::string &filename);
+// Maps a pack built by pack_resources, so images under GetResourceDir() are
+// read from memory instead of opening each file. Images that aren't in the
+// pack, or whose file has changed since it was built, are still loaded from
+// disk. Returns false if there was no valid pack at path.
+bool UseResourcePack(const std::string &path);
+
+// Decodes and uploads on the calling thread, which must be the main thread.
+// If width_px is smaller than a JPEG's width, it is shrunk to that width
+// (keeping its aspect ratio) while decoding. Images that will be drawn at
+// a fixed size should pass it, so that they are decoded faster, take less
+// memory, and are drawn without the renderer scaling them. SVGs are
+// rasterized at width_px, if set, and the rasters are cached on disk (see
+// SvgCache.h).
+SDL_Texture *LoadImage(const std::string &filename, int width_px = 0);
+
+// Planar YCbCr with chroma at half resolution in both directions, the
+// layout of SDL_PIXELFORMAT_IYUV.
+struct YuvImage {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> planes[3];  // Y, U (Cb), V (Cr)
+  int pitches[3] = {};
+};
+
+// An image decoded into memory, ready to upload to a texture. JPEGs are
+// decoded to YUV when the renderer can convert it to RGB itself, which
+// saves the conversion on the CPU and halves the bytes to upload. Otherwise
+// (and for other formats) they are decoded to a surface.
+struct DecodedImage {
+  std::string path;
+
+  // One of these is set, unless there was an error.
+  std::unique_ptr<SDL_Surface, SDL_SurfaceDeleter> surface;
+  std::unique_ptr<YuvImage> yuv;
+
+  std::string error;
+};
+
+// Decodes on the calling thread. If yuv is set, JPEGs stored as YCbCr (or
+// grayscale) are decoded to YUV; LoadImage and DecodeImageAsync set it when
+// the renderer can upload YUV textures.
+DecodedImage DecodeImage(const std::string &path, int width_px, bool yuv);
+
+// Decoding a full size JPEG takes tens of milliseconds, so it can be started
+// on a worker thread ahead of time. Only the upload, which needs the
+// renderer, has to happen on the main thread.
+std::future<DecodedImage> DecodeImageAsync(const std::string &filename,
+                                           int width_px = 0);
+
+// Creates a texture from a decoded image. Returns null (after reporting a
+// fatal error) if it couldn't be decoded or uploaded.
+SDL_Texture *UploadImage(DecodedImage image);
+
+// Logs how long decoding and uploading took since the last call, e.g. for
+// task initialization.
+void LogImageLoadStats(const char *label);
 
 }  // namespace stimulus
 
@@ -0,0 +1,218 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "Image.h"
+
+#include <jpeglib.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+// Odd sizes, so the chroma planes round up.
+const int kWidth = 37;
+const int kHeight = 23;
+const int kShrunkWidth = 19;
+
+// Both decodes round, so they can differ by a level or two.
+const int kRgbTolerance = 3;
+
+// A shrunk image's planes are resampled separately, so chroma can be
+// shifted by up to half a row from the RGB decode, which on these
+// gradients is about one row's change in value.
+const int kShrunkRgbTolerance = 255 / (kShrunkWidth * kHeight / kWidth - 1);
+
+// A JPEG of smooth gradients, written to a temporary directory with
+// libjpeg's default sampling (4:2:0 for color).
+class TestJpeg {
+ public:
+  explicit TestJpeg(bool grayscale) {
+    char dir[] = "/tmp/image_testXXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+    path_ = dir_ + "/test.jpg";
+
+    FILE *file = fopen(path_.c_str(), "wb");
+    BOOST_REQUIRE(file != nullptr);
+    jpeg_compress_struct info;
+    jpeg_error_mgr errors;
+    info.err = jpeg_std_error(&errors);
+    jpeg_create_compress(&info);
+    jpeg_stdio_dest(&info, file);
+    info.image_width = kWidth;
+    info.image_height = kHeight;
+    info.input_components = grayscale ? 1 : 3;
+    info.in_color_space = grayscale ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, 95, TRUE);
+    jpeg_start_compress(&info, TRUE);
+
+    std::vector<JSAMPLE> row(kWidth * info.input_components);
+    while (info.next_scanline < info.image_height) {
+      int y = info.next_scanline;
+      for (int x = 0; x < kWidth; x++) {
+        JSAMPLE *pixel = &row[x * info.input_components];
+        pixel[0] = static_cast<JSAMPLE>(x * 255 / (kWidth - 1));
+        if (!grayscale) {
+          pixel[1] = static_cast<JSAMPLE>(y * 255 / (kHeight - 1));
+          pixel[2] = 96;
+        }
+      }
+
+      JSAMPROW rows[] = {row.data()};
+      jpeg_write_scanlines(&info, rows, 1);
+    }
+
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+    fclose(file);
+  }
+
+  ~TestJpeg() {
+    unlink(path_.c_str());
+    rmdir(dir_.c_str());
+  }
+
+  const std::string &GetPath() const { return path_; }
+
+ private:
+  std::string dir_;
+  std::string path_;
+};
+
+int Clamp(double value) {
+  return std::max(0, std::min(255, static_cast<int>(value + 0.5)));
+}
+
+void CheckPlaneSizes(const stimulus::YuvImage &image, int width, int height) {
+  BOOST_CHECK_EQUAL(image.width, width);
+  BOOST_CHECK_EQUAL(image.height, height);
+  for (int c = 0; c < 3; c++) {
+    int plane_width = c == 0 ? width : (width + 1) / 2;
+    int plane_height = c == 0 ? height : (height + 1) / 2;
+    BOOST_CHECK_EQUAL(image.pitches[c], plane_width);
+    BOOST_CHECK_EQUAL(image.planes[c].size(),
+                      static_cast<size_t>(plane_width * plane_height));
+  }
+}
+
+// Interpolates a chroma plane at a luma pixel. Chroma samples are centered
+// between pairs of luma samples, as in JPEG.
+double SampleChroma(const stimulus::YuvImage &image, int plane, int x,
+                    int y) {
+  int width = (image.width + 1) / 2;
+  int height = (image.height + 1) / 2;
+  double sample_x = std::max(0.0,
+                             std::min(width - 1.0, (x + 0.5) / 2 - 0.5));
+  double sample_y = std::max(0.0,
+                             std::min(height - 1.0, (y + 0.5) / 2 - 0.5));
+  int x0 = static_cast<int>(sample_x);
+  int y0 = static_cast<int>(sample_y);
+  int x1 = std::min(x0 + 1, width - 1);
+  int y1 = std::min(y0 + 1, height - 1);
+  double fx = sample_x - x0;
+  double fy = sample_y - y0;
+  const std::vector<uint8_t> &data = image.planes[plane];
+  int pitch = image.pitches[plane];
+  double top = data[y0 * pitch + x0] * (1 - fx) + data[y0 * pitch + x1] * fx;
+  double bottom = data[y1 * pitch + x0] * (1 - fx) +
+                  data[y1 * pitch + x1] * fx;
+  return top * (1 - fy) + bottom * fy;
+}
+
+// Converts each pixel back with the JFIF equations, which is what the
+// renderer does with SDL_YUV_CONVERSION_JPEG, and compares it to libjpeg's
+// own RGB decode. Returns the largest difference in any channel.
+int CompareToRgb(const stimulus::YuvImage &image, const SDL_Surface &rgb) {
+  int max_error = 0;
+  for (int y = 0; y < image.height; y++) {
+    for (int x = 0; x < image.width; x++) {
+      double luma = image.planes[0][y * image.pitches[0] + x];
+      double cb = SampleChroma(image, 1, x, y) - 128.0;
+      double cr = SampleChroma(image, 2, x, y) - 128.0;
+      int converted[] = {Clamp(luma + 1.402 * cr),
+                         Clamp(luma - 0.344136 * cb - 0.714136 * cr),
+                         Clamp(luma + 1.772 * cb)};
+      const uint8_t *pixel = static_cast<const uint8_t *>(rgb.pixels) +
+                             y * rgb.pitch + x * 3;
+      for (int c = 0; c < 3; c++) {
+        max_error = std::max(max_error, std::abs(converted[c] - pixel[c]));
+      }
+    }
+  }
+
+  return max_error;
+}
+
+BOOST_AUTO_TEST_CASE(DecodesColorJpegToYuv) {
+  TestJpeg jpeg(false);
+  stimulus::DecodedImage yuv = stimulus::DecodeImage(jpeg.GetPath(), 0, true);
+  BOOST_REQUIRE_MESSAGE(yuv.yuv != nullptr, yuv.error);
+  BOOST_CHECK(yuv.surface == nullptr);
+  CheckPlaneSizes(*yuv.yuv, kWidth, kHeight);
+
+  stimulus::DecodedImage rgb = stimulus::DecodeImage(jpeg.GetPath(), 0,
+                                                     false);
+  BOOST_REQUIRE_MESSAGE(rgb.surface != nullptr, rgb.error);
+  BOOST_CHECK(rgb.yuv == nullptr);
+  BOOST_REQUIRE_EQUAL(rgb.surface->w, kWidth);
+  BOOST_REQUIRE_EQUAL(rgb.surface->h, kHeight);
+  BOOST_CHECK_LE(CompareToRgb(*yuv.yuv, *rgb.surface), kRgbTolerance);
+}
+
+// Grayscale has no chroma to decode, so U and V are filled with the
+// neutral value, and Y is the image itself.
+BOOST_AUTO_TEST_CASE(DecodesGrayscaleJpegToYuv) {
+  TestJpeg jpeg(true);
+  stimulus::DecodedImage yuv = stimulus::DecodeImage(jpeg.GetPath(), 0, true);
+  BOOST_REQUIRE_MESSAGE(yuv.yuv != nullptr, yuv.error);
+  CheckPlaneSizes(*yuv.yuv, kWidth, kHeight);
+  for (int c = 1; c < 3; c++) {
+    const std::vector<uint8_t> &plane = yuv.yuv->planes[c];
+    BOOST_CHECK(std::all_of(plane.begin(), plane.end(),
+                            [](uint8_t value) { return value == 128; }));
+  }
+
+  stimulus::DecodedImage rgb = stimulus::DecodeImage(jpeg.GetPath(), 0,
+                                                     false);
+  BOOST_REQUIRE_MESSAGE(rgb.surface != nullptr, rgb.error);
+  BOOST_CHECK_LE(CompareToRgb(*yuv.yuv, *rgb.surface), 1);
+}
+
+// Shrinking while decoding resamples each plane to the size it has at the
+// display size, which is odd again.
+BOOST_AUTO_TEST_CASE(ShrinksYuvToDisplayWidth) {
+  TestJpeg jpeg(false);
+  int width = kShrunkWidth;
+  int height = static_cast<int>(static_cast<float>(width) / kWidth * kHeight);
+  stimulus::DecodedImage yuv = stimulus::DecodeImage(jpeg.GetPath(), width,
+                                                     true);
+  BOOST_REQUIRE_MESSAGE(yuv.yuv != nullptr, yuv.error);
+  CheckPlaneSizes(*yuv.yuv, width, height);
+
+  stimulus::DecodedImage rgb = stimulus::DecodeImage(jpeg.GetPath(), width,
+                                                     false);
+  BOOST_REQUIRE_MESSAGE(rgb.surface != nullptr, rgb.error);
+  BOOST_REQUIRE_EQUAL(rgb.surface->w, width);
+  BOOST_REQUIRE_EQUAL(rgb.surface->h, height);
+  BOOST_CHECK_LE(CompareToRgb(*yuv.yuv, *rgb.surface), kShrunkRgbTolerance);
+}
+
+}  // namespace
@@ -0,0 +1,122 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "InputScript.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "Clock.h"
+
+namespace stimulus {
+
+InputScript::InputScript(const std::string &filename) {
+  FILE *file = fopen(filename.c_str(), "r");
+  if (file == nullptr) {
+    errors_ += "Could not open input script " + filename;
+    return;
+  }
+
+  int64_t time_us = 0;
+  for (int line_num = 1; ; line_num++) {
+    char line_value[128];
+    if (fgets(line_value, sizeof(line_value), file) == nullptr) {
+      break;
+    }
+
+    char *comment = strchr(line_value, '#');
+    if (comment != nullptr) {
+      *comment = '\0';
+    }
+
+    int delay_ms;
+    char type[16];
+    int consumed;
+    int fields = sscanf(line_value, " %d %15s %n", &delay_ms, type,
+                        &consumed);
+    if (fields == EOF) {
+      // Blank line
+      continue;
+    }
+
+    Event event;
+    time_us += MsToMicros(delay_ms);
+    event.time_us = time_us;
+    if (fields == 2 && strcmp(type, "key") == 0) {
+      // Key names can contain spaces ("Left Shift"), so take the rest of
+      // the line.
+      std::string name(line_value + consumed);
+      name.erase(name.find_last_not_of(" \t\r\n") + 1);
+      event.is_click = false;
+      event.scancode = SDL_GetScancodeFromName(name.c_str());
+      if (event.scancode == SDL_SCANCODE_UNKNOWN) {
+        errors_ += "line " + std::to_string(line_num) + ": unknown key '" +
+                   name + "'\n";
+        continue;
+      }
+    } else if (fields == 2 && strcmp(type, "click") == 0 &&
+               sscanf(line_value + consumed, "%d %d", &event.x,
+                      &event.y) == 2) {
+      event.is_click = true;
+    } else {
+      errors_ += "line " + std::to_string(line_num) +
+                 ": expected '<delay_ms> key <name>' or "
+                 "'<delay_ms> click <x> <y>'\n";
+      continue;
+    }
+
+    events_.push_back(event);
+  }
+
+  fclose(file);
+}
+
+int64_t InputScript::GetNextEventTime() const {
+  if (next_event_ == events_.size()) {
+    return -1;
+  }
+
+  return events_[next_event_].time_us;
+}
+
+void InputScript::PushDueEvents(int64_t time_us) {
+  while (next_event_ < events_.size() &&
+         events_[next_event_].time_us <= time_us) {
+    const Event &scripted = events_[next_event_++];
+    SDL_Event event;
+    SDL_zero(event);
+    if (scripted.is_click) {
+      event.type = SDL_MOUSEBUTTONDOWN;
+      event.button.button = SDL_BUTTON_LEFT;
+      event.button.state = SDL_PRESSED;
+      event.button.x = scripted.x;
+      event.button.y = scripted.y;
+      SDL_PushEvent(&event);
+      event.type = SDL_MOUSEBUTTONUP;
+      event.button.state = SDL_RELEASED;
+      SDL_PushEvent(&event);
+    } else {
+      event.type = SDL_KEYDOWN;
+      event.key.state = SDL_PRESSED;
+      event.key.keysym.scancode = scripted.scancode;
+      event.key.keysym.sym = SDL_GetKeyFromScancode(scripted.scancode);
+      SDL_PushEvent(&event);
+      event.type = SDL_KEYUP;
+      event.key.state = SDL_RELEASED;
+      SDL_PushEvent(&event);
+    }
+  }
+}
+
+}  // namespace stimulus
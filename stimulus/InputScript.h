@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_INPUTSCRIPT_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_INPUTSCRIPT_H_
+
+#include <SDL.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stimulus {
+
+// Keyboard and mouse input for a headless run. Each line of the script is
+// one event, with a delay in milliseconds after the previous event (or the
+// start of the run):
+//
+//   # Select the first task, then press space twice.
+//   500 key 1
+//   2000 key Space
+//   1000 key Space
+//   250 click 640 400
+//
+// Key names are the ones SDL_GetScancodeFromName accepts. Click coordinates
+// are in window coordinates, the same as mouse events.
+class InputScript {
+ public:
+  InputScript(const std::string &filename);
+
+  std::string GetErrors() const {
+    return errors_;
+  }
+
+  // Returns the time of the next event, or -1 once they've all been pushed.
+  int64_t GetNextEventTime() const;
+
+  // Push every event due at or before time_us onto the SDL event queue.
+  void PushDueEvents(int64_t time_us);
+
+ private:
+  struct Event {
+    int64_t time_us;
+    bool is_click;
+    SDL_Scancode scancode;
+    int x;
+    int y;
+  };
+
+  std::vector<Event> events_;
+  size_t next_event_ = 0;
+  std::string errors_;
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_INPUTSCRIPT_H_
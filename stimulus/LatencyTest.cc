@@ -23,6 +23,8 @@ namespace {
 const int kFlashInterval = 500;
 const int kTotalFlashes = 30;
 
+const MarkEventId kEventWhiteScreen = InternMarkEvent("WhiteScreen");
+
 class BlackScreen : public Screen {
   SDL_Color GetBackgroundColor() override {
     return SDL_Color{ 0, 0, 0, 0xff };
@@ -37,7 +39,7 @@ class BlackScreen : public Screen {
 class WhiteScreen : public Screen {
  public:
   void IsActive() override {
-    SendMark(10, "WhiteScreen");
+    SendMark(10, kEventWhiteScreen);
   }
 
   SDL_Color GetBackgroundColor() override {
@@ -12,69 +12,660 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <fstream>
+#include <cinttypes>
 #include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Clock.h"
+#include "MarkDispatcher.h"
 #include "Platform.h"
 #include "Screen.h"
+#include "Trace.h"
+#include "Util.h"
 #include "Mark.h"
 #include "Version.h"
 
 namespace stimulus {
 namespace {
 
-bool serial_port_open;
 MarkFormat mark_format = kBrainometer;
+MarkTimeUnits mark_time_units = kMicroseconds;
+int mark_pulse_width_us = 2000;
+int mark_latency_warning_us = 2000;
 std::string mark_directory;
 std::string mark_task;
-std::vector<std::string> mark_tracking_vector;
+std::vector<std::pair<std::string, std::string>> mark_header_fields;
 
-}  // namespace
+const char *kMarkJournalName = "marks.journal";
+const char *kMarkJournalMagic = "stimulus mark journal 1";
 
-void SetMarkFormat(MarkFormat format) {
-  mark_format = format;
+// The journal is synced to disk after this many marks, or this long after
+// the first unsynced mark, whichever comes first.
+const int kJournalSyncMarks = 32;
+const int64_t kJournalSyncIntervalUs = 200 * kMicrosPerMs;
+
+// Records are stored in fixed size chunks so appending never moves or
+// copies what is already there. The first chunk holds more marks than any
+// current task sends.
+class MarkRecordArena {
+ public:
+  MarkRecordArena() {
+    chunks_.reserve(kMaxInitialChunks);
+    AddChunk();
+  }
+
+  void Append(const MarkRecord &record) {
+    if (count_ == chunks_.size() * kRecordsPerChunk) {
+      AddChunk();
+    }
+
+    chunks_[count_ / kRecordsPerChunk][count_ % kRecordsPerChunk] = record;
+    count_++;
+  }
+
+  const MarkRecord &Get(size_t index) const {
+    return chunks_[index / kRecordsPerChunk][index % kRecordsPerChunk];
+  }
+
+  size_t GetSize() const { return count_; }
+
+  // Keeps the chunks allocated for the next task.
+  void Clear() { count_ = 0; }
+
+ private:
+  static const size_t kRecordsPerChunk = 8192;
+  static const size_t kMaxInitialChunks = 16;
+
+  void AddChunk() {
+    chunks_.emplace_back(new MarkRecord[kRecordsPerChunk]);
+  }
+
+  std::vector<std::unique_ptr<MarkRecord[]>> chunks_;
+  size_t count_ = 0;
+};
+
+// Only written by the dispatcher thread. Readers must Flush first.
+MarkRecordArena mark_records;
+
+// The journal writer looks up names from the dispatcher thread while tasks
+// may still be interning new ones, so access is locked.
+struct MarkEventTable {
+  MarkEventTable() {
+    names.push_back("undefined");
+    ids[names.back()] = kUndefinedMarkEvent;
+  }
+
+  std::mutex mutex;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, MarkEventId> ids;
+};
+
+// This is used by other modules' static initializers, so it can't be a
+// global.
+MarkEventTable &GetMarkEventTable() {
+  static MarkEventTable table;
+  return table;
+}
+
+std::string GetMarkEventName(MarkEventId event) {
+  MarkEventTable &table = GetMarkEventTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.names[event];
 }
 
-void SendMark(int num, const std::string &event) {
-  Uint32 now = SDL_GetTicks();
+const char *GetTimeUnitsName(MarkTimeUnits units) {
+  return units == kMilliseconds ? "ms" : "us";
+}
 
-  if (serial_port_open) {
-    switch (mark_format) {
-      case kBrainometer: {
-        char tmp[32];
-        int len = snprintf(tmp, sizeof(tmp), "mark %d\r\n", num);
-        WriteSerial(tmp, len);
-        break;
-      }
+int64_t ConvertTime(int64_t time_us, MarkTimeUnits units) {
+  return units == kMilliseconds ? time_us / kMicrosPerMs : time_us;
+}
+
+void WriteMarkFileHeader(
+    std::ostream &mark_file, const std::string &date_string,
+    const std::string &task, MarkTimeUnits units,
+    const std::vector<std::pair<std::string, std::string>> &fields) {
+  mark_file << "{\r\n";
+  mark_file << "  \"gentask\": \"River2\",\r\n"; // this allows read-in functions to change format if necessary
+  mark_file << "  \"file_type\": \"mark\",\r\n";
+  mark_file << "  \"date\": \"" << date_string << "\",\r\n";
+  mark_file << "  \"task\": \"" << task << "\",\r\n";
+  mark_file << "  \"time_units\": \"" << GetTimeUnitsName(units) << "\",\r\n";
+  mark_file << "  \"version\": \"" << kFullVersionString << "\"";
+  for (const auto &field : fields) {
+    mark_file << ",\r\n  \"" << field.first << "\": " << field.second;
+  }
+
+  mark_file << "\r\n}\r\n----\r\n";
+
+  // log trigger, onset, stimulus, then how long the stimulus was actually
+  // on screen (for marks sent when a screen became visible)
+  mark_file << "Type,Time,Event,DurationFrames,Duration,NominalDuration\r\n";
+}
+
+// presentation may be null if the mark wasn't a stimulus onset.
+void WriteMarkFileRow(std::ostream &mark_file, int num, int64_t time_us,
+                      const std::string &event, MarkTimeUnits units,
+                      const PresentationAudit::Presentation *presentation) {
+  mark_file << num << ',' << ConvertTime(time_us, units) << ',' << event;
+  if (presentation != nullptr && presentation->IsComplete()) {
+    mark_file << ',' << presentation->GetDurationFrames() << ','
+              << ConvertTime(presentation->GetDurationMicros(), units) << ',';
+    if (presentation->nominal_ms > 0) {
+      mark_file << ConvertTime(MsToMicros(presentation->nominal_ms), units);
+    }
+  } else {
+    mark_file << ",,,";
+  }
+
+  mark_file << "\r\n";
+}
+
+// Appends each mark to a text journal in the mark directory as it is
+// written, so a crash loses at most the marks that were not yet synced.
+// Once the CSV has been written at the end of the task, the journal is
+// deleted. RecoverMarkJournal converts one left behind.
+//
+// Format (one record per line):
+//   stimulus mark journal 1
+//   task <task name>
+//   date <date string>
+//   time_units <us|ms>
+//   E <event id> <event name>       (before the first mark that uses it)
+//   M <mark> <time us> <event id>
+// A sync can take tens of milliseconds, so syncs run on their own thread.
+// The dispatcher only hands the data to the OS.
+class JournalMarkSink : public MarkSink {
+ public:
+  JournalMarkSink() : sync_thread_(&JournalMarkSink::SyncThreadMain, this) {}
+
+  ~JournalMarkSink() override {
+    {
+      std::lock_guard<std::mutex> lock(sync_mutex_);
+      stopping_ = true;
+    }
+
+    sync_condition_.notify_all();
+    sync_thread_.join();
+  }
+
+  const char *GetName() const override { return "journal"; }
+
+  void Open(const std::string &path, const std::string &task,
+            const std::string &date_string) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CloseLocked();
+    file_ = fopen(path.c_str(), "w");
+    if (file_ == nullptr) {
+      SDL_Log("Couldn't open mark journal %s\n", path.c_str());
+      return;
+    }
+
+    path_ = path;
+    event_written_.clear();
+    fprintf(file_, "%s\ntask %s\ndate %s\ntime_units %s\n", kMarkJournalMagic,
+            task.c_str(), date_string.c_str(),
+            GetTimeUnitsName(mark_time_units));
+    SyncLocked();
+  }
+
+  // The CSV has been written, so the journal is no longer needed.
+  void CloseAndRemove() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (CloseLocked()) {
+      remove(path_.c_str());
+    }
+  }
 
-      case kByte: {
-        char val = num & 0xff;
-        WriteSerial(&val, 1);
-        break;
+  void WriteMark(const MarkRecord &mark) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == nullptr) {
+      return;
+    }
+
+    if (static_cast<size_t>(mark.event) >= event_written_.size()) {
+      event_written_.resize(mark.event + 1);
+    }
+
+    if (!event_written_[mark.event]) {
+      fprintf(file_, "E %d %s\n", mark.event,
+              GetMarkEventName(mark.event).c_str());
+      event_written_[mark.event] = true;
+    }
+
+    fprintf(file_, "M %d %" PRId64 " %d\n", mark.num, mark.time_us,
+            mark.event);
+    if (unsynced_count_++ == 0) {
+      first_unsynced_time_us_ = GetTimeMicros();
+    }
+
+    unflushed_ = true;
+    if (unsynced_count_ >= kJournalSyncMarks) {
+      RequestSyncLocked();
+    }
+  }
+
+  void Idle() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == nullptr) {
+      return;
+    }
+
+    if (unsynced_count_ > 0 &&
+        GetTimeMicros() - first_unsynced_time_us_ >= kJournalSyncIntervalUs) {
+      RequestSyncLocked();
+    } else if (unflushed_) {
+      // Handing the data to the OS is cheap, and is enough to survive the
+      // application (but not the machine) crashing.
+      fflush(file_);
+      unflushed_ = false;
+    }
+  }
+
+ private:
+  void SyncLocked() {
+    if (!SyncFile(file_)) {
+      SDL_Log("Error syncing mark journal %s\n", path_.c_str());
+    }
+
+    unsynced_count_ = 0;
+    unflushed_ = false;
+  }
+
+  // Flushes the stream, and has the sync thread wait for it to reach the
+  // disk.
+  void RequestSyncLocked() {
+    fflush(file_);
+    unsynced_count_ = 0;
+    unflushed_ = false;
+    {
+      std::lock_guard<std::mutex> lock(sync_mutex_);
+      sync_fd_ = fileno(file_);
+      sync_requested_ = true;
+    }
+
+    sync_condition_.notify_all();
+  }
+
+  void SyncThreadMain() {
+    SetTraceThreadName("journal sync");
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    while (true) {
+      sync_condition_.wait(lock,
+                           [this] { return stopping_ || sync_requested_; });
+      if (!sync_requested_) {
+        return;
       }
 
-      case kParallel: {
-        WriteParallel(num); //send code to data port pin
-        break;
+      sync_requested_ = false;
+      syncing_ = true;
+      int fd = sync_fd_;
+      lock.unlock();
+      bool synced = SyncFileDescriptor(fd);
+      lock.lock();
+      syncing_ = false;
+      sync_condition_.notify_all();
+      if (!synced) {
+        SDL_Log("Error syncing mark journal\n");
       }
     }
   }
 
-  SDL_Log("mark %d\n", num);
+  // Returns false if there was no journal open.
+  bool CloseLocked() {
+    if (file_ == nullptr) {
+      return false;
+    }
+
+    // The descriptor can't be closed while it is being synced.
+    {
+      std::unique_lock<std::mutex> lock(sync_mutex_);
+      sync_requested_ = false;
+      sync_condition_.wait(lock, [this] { return !syncing_; });
+    }
+
+    fclose(file_);
+    file_ = nullptr;
+    return true;
+  }
+
+  std::mutex mutex_;
+  FILE *file_ = nullptr;
+  std::string path_;
+  std::vector<bool> event_written_;
+  int unsynced_count_ = 0;
+  int64_t first_unsynced_time_us_ = 0;
+  bool unflushed_ = false;
+
+  // Protects the sync thread's state.
+  std::mutex sync_mutex_;
+  std::condition_variable sync_condition_;
+  int sync_fd_ = -1;
+  bool sync_requested_ = false;
+  bool syncing_ = false;
+  bool stopping_ = false;
+
+  // Declared last so everything above is constructed before it starts.
+  std::thread sync_thread_;
+};
+
+// Owned by the dispatcher.
+JournalMarkSink *mark_journal;
+
+// How long each mark took to reach the port, from the start of its write
+// until the lines were raised (parallel) or the bytes were sent (serial),
+// not counting the time it waited in the queue. Only used by the
+// dispatcher thread, or after a Flush.
+const size_t kExpectedPortWrites = 4096;
+std::vector<int64_t> port_write_latencies;
+int port_write_failures;
+
+// A negative latency means the mark wasn't written.
+void RecordPortWrite(int64_t latency_us) {
+  if (latency_us >= 0) {
+    port_write_latencies.push_back(latency_us);
+  } else {
+    port_write_failures++;
+  }
+}
+
+class SerialMarkSink : public MarkSink {
+ public:
+  const char *GetName() const override { return "serial"; }
+
+  // The write returns once the bytes are queued. Waiting for them to be
+  // sent would hold up the marks behind this one, so the port is drained in
+  // Idle, once the queue is empty, and each mark is timed until then.
+  void WriteMark(const MarkRecord &mark) override {
+    int64_t start_us = GetWallTimeMicros();
+    int result;
+    if (mark_format == kBrainometer) {
+      char tmp[32];
+      int len = snprintf(tmp, sizeof(tmp), "mark %d\r\n", mark.num);
+      result = WriteSerial(tmp, len);
+    } else {
+      char val = mark.num & 0xff;
+      result = WriteSerial(&val, 1);
+    }
+
+    if (result < 0) {
+      SDL_Log("Warning: couldn't write mark %d to the serial port\n",
+              mark.num);
+      RecordPortWrite(-1);
+      return;
+    }
+
+    unsent_write_starts_us_.push_back(start_us);
+  }
+
+  // Marks written in a burst are all timed until the last one was sent.
+  void Idle() override {
+    if (unsent_write_starts_us_.empty()) {
+      return;
+    }
+
+    bool sent = DrainSerial();
+    int64_t end_us = GetWallTimeMicros();
+    if (!sent) {
+      SDL_Log("Warning: the serial port didn't send %d marks in time\n",
+              static_cast<int>(unsent_write_starts_us_.size()));
+    }
+
+    for (int64_t start_us : unsent_write_starts_us_) {
+      RecordPortWrite(sent ? end_us - start_us : -1);
+    }
+
+    unsent_write_starts_us_.clear();
+  }
+
+ private:
+  std::vector<int64_t> unsent_write_starts_us_;
+};
+
+class ParallelMarkSink : public MarkSink {
+ public:
+  const char *GetName() const override { return "parallel"; }
+
+  void WriteMark(const MarkRecord &mark) override {
+    RecordPortWrite(WriteParallel(mark.num));
+  }
+};
+
+class FileMarkSink : public MarkSink {
+ public:
+  const char *GetName() const override { return "file"; }
+
+  void WriteMark(const MarkRecord &mark) override {
+    SDL_Log("mark %d\n", mark.num);
+    mark_records.Append(mark);
+  }
+};
+
+MarkDispatcher *CreateMarkDispatcher() {
+  MarkDispatcher *dispatcher = new MarkDispatcher();
+  dispatcher->AddSink(new FileMarkSink());
+  mark_journal = new JournalMarkSink();
+  dispatcher->AddSink(mark_journal);
+  return dispatcher;
+}
+
+// The output thread is started the first time this is used.
+MarkDispatcher &GetMarkDispatcher() {
+  static std::unique_ptr<MarkDispatcher> dispatcher(CreateMarkDispatcher());
+  return *dispatcher;
+}
+
+// Records how mark times relate to the display, and the refresh timing
+// measured at startup, so the file says how far its timestamps can be
+// trusted.
+void AddDisplayCalibration() {
+  const Screen::DisplayCalibration &calibration =
+      Screen::GetDisplayCalibration();
+  SetMarkHeaderField("mark_time_reference",
+                     Screen::IsPhotonTimingEnabled() ? "\"photon\""
+                                                     : "\"callback\"");
+  if (Screen::IsHeadless()) {
+    SetMarkHeaderField("headless", "true");
+  }
+
+  SetMarkHeaderField("display_calibrated",
+                     calibration.valid ? "true" : "false");
+  if (calibration.valid) {
+    char confidence[16];
+    snprintf(confidence, sizeof(confidence), "%.2f",
+             calibration.swap_depth_confidence);
+    SetMarkHeaderField("frame_period_us", std::to_string(calibration.period_us));
+    SetMarkHeaderField("frame_jitter_us", std::to_string(calibration.jitter_us));
+    SetMarkHeaderField("swap_depth", std::to_string(calibration.swap_depth));
+    SetMarkHeaderField("swap_depth_confidence", confidence);
+  }
+}
+
+// Summarizes how accurately stimuli were presented, in the header and log.
+void AddPresentationSummary() {
+  std::vector<int> onsets;
+  for (size_t i = 0; i < mark_records.GetSize(); i++) {
+    if (mark_records.Get(i).presentation >= 0) {
+      onsets.push_back(mark_records.Get(i).presentation);
+    }
+  }
+
+  PresentationAudit::Summary summary =
+      Screen::GetPresentationAudit().Summarize(onsets);
+  SDL_Log("%d of %d timed stimuli were off by a frame or more, "
+          "%lld frames missed\n", summary.off_by_frame, summary.timed_stimuli,
+          static_cast<long long>(summary.missed_frames));
+  SetMarkHeaderField("timed_stimuli", std::to_string(summary.timed_stimuli));
+  SetMarkHeaderField("stimuli_off_by_frame",
+                     std::to_string(summary.off_by_frame));
+  SetMarkHeaderField("missed_frames", std::to_string(summary.missed_frames));
+}
+
+// The distribution of port write times, so slow or uneven marks can be
+// seen in the file they affect.
+void AddPortWriteSummary() {
+  if (port_write_failures > 0) {
+    SDL_Log("Warning: %d marks couldn't be written to the port\n",
+            port_write_failures);
+    SetMarkHeaderField("port_write_failures",
+                       std::to_string(port_write_failures));
+  }
+
+  if (port_write_latencies.empty()) {
+    return;
+  }
+
+  std::vector<int64_t> sorted = port_write_latencies;
+  std::sort(sorted.begin(), sorted.end());
+  auto percentile = [&sorted](int percent) {
+    return sorted[(sorted.size() - 1) * percent / 100];
+  };
+
+  int64_t total_us = 0;
+  int over_threshold = 0;
+  for (int64_t latency_us : sorted) {
+    total_us += latency_us;
+    if (latency_us > mark_latency_warning_us) {
+      over_threshold++;
+    }
+  }
+
+  int64_t mean_us = total_us / static_cast<int64_t>(sorted.size());
+  SDL_Log("Mark port writes: %d, mean %lld us, median %lld us, "
+          "99th percentile %lld us, max %lld us\n",
+          static_cast<int>(sorted.size()), static_cast<long long>(mean_us),
+          static_cast<long long>(percentile(50)),
+          static_cast<long long>(percentile(99)),
+          static_cast<long long>(sorted.back()));
+  if (over_threshold > 0) {
+    SDL_Log("Warning: %d mark port writes took more than %d us\n",
+            over_threshold, mark_latency_warning_us);
+  }
+
+  SetMarkHeaderField("port_writes", std::to_string(sorted.size()));
+  SetMarkHeaderField("port_write_mean_us", std::to_string(mean_us));
+  SetMarkHeaderField("port_write_p50_us", std::to_string(percentile(50)));
+  SetMarkHeaderField("port_write_p90_us", std::to_string(percentile(90)));
+  SetMarkHeaderField("port_write_p99_us", std::to_string(percentile(99)));
+  SetMarkHeaderField("port_write_max_us", std::to_string(sorted.back()));
+  SetMarkHeaderField("port_writes_over_threshold",
+                     std::to_string(over_threshold));
+}
+
+// A USB serial adapter's latency timer delays every mark by up to that
+// long, which startup can check before any marks are sent.
+void CheckSerialLatencyTimer(const std::string &portName) {
+  int timer_ms = GetSerialLatencyTimerMs();
+  if (timer_ms < 0 || MsToMicros(timer_ms) <= mark_latency_warning_us) {
+    return;
+  }
+
+  std::string message = "The latency timer of " + portName + " is " +
+      std::to_string(timer_ms) + " ms, so marks may be delayed by up to " +
+      "that long. Set /sys/class/tty/" + portName +
+      "/device/latency_timer to 1 (which needs root or a udev rule), or "
+      "raise mark_latency_warning_us in the settings file.";
+  SDL_Log("Warning: %s\n", message.c_str());
+  SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_WARNING, "Warning",
+                           message.c_str(), nullptr);
+}
+
+void LogMarkStats() {
+  MarkDispatcher &dispatcher = GetMarkDispatcher();
+  SDL_Log("Mark queue: max depth %d, dropped %d\n",
+          dispatcher.GetMaxQueueDepth(), dispatcher.GetDroppedCount());
+
+  // Dropped marks never reach any sink, so the file only knows about them
+  // from this.
+  SetMarkHeaderField("dropped_marks",
+                     std::to_string(dispatcher.GetDroppedCount()));
+  for (const auto &stats : dispatcher.GetSinkStats()) {
+    if (stats.count > 0) {
+      SDL_Log("Mark sink %s: %lld marks, latency mean %lld us max %lld us, "
+              "write mean %lld us max %lld us\n",
+              stats.name.c_str(), static_cast<long long>(stats.count),
+              static_cast<long long>(stats.total_latency_us / stats.count),
+              static_cast<long long>(stats.max_latency_us),
+              static_cast<long long>(stats.total_write_us / stats.count),
+              static_cast<long long>(stats.max_write_us));
+    }
+  }
+}
+
+}  // namespace
+
+void SetMarkFormat(MarkFormat format) {
+  mark_format = format;
+}
+
+void SetMarkTimeUnits(MarkTimeUnits units) {
+  mark_time_units = units;
+}
+
+void SetMarkPulseWidth(int pulse_width_us) {
+  mark_pulse_width_us = pulse_width_us;
+}
+
+void SetMarkLatencyWarning(int latency_us) {
+  mark_latency_warning_us = latency_us;
+}
+
+MarkEventId InternMarkEvent(const std::string &name) {
+  MarkEventTable &table = GetMarkEventTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto it = table.ids.find(name);
+  if (it != table.ids.end()) {
+    return it->second;
+  }
+
+  MarkEventId id = static_cast<MarkEventId>(table.names.size());
+  table.names.push_back(name);
+  table.ids[name] = id;
+  return id;
+}
+
+void SendMark(int num, MarkEventId event) {
+  MarkRecord mark;
+  mark.num = num;
+  mark.event = event;
+  mark.presentation = Screen::GetOnsetPresentation();
+  mark.enqueue_time_us = GetTimeMicros();
 
-  // log trigger, onset, stimulus
-  mark_tracking_vector.push_back(std::to_string(num) + ',' + std::to_string(now) + ',' + event + "\r\n");
+  // Marks sent as a screen appears are stamped with when the flip was
+  // predicted to reach the display, rather than when the callback ran.
+  int64_t flip_time = Screen::GetFlipTime();
+  mark.time_us = flip_time >= 0 ? flip_time : mark.enqueue_time_us;
+
+  // A headless run can send marks faster than they are written, and its
+  // mark file must be complete.
+  if (IsVirtualClock()) {
+    GetMarkDispatcher().Flush();
+  }
+
+  if (!GetMarkDispatcher().Enqueue(mark)) {
+    SDL_Log("mark queue full, dropped mark %d\n", num);
+  }
 }
 
 void OpenMarkPort(const std::string &portName, int baudRate) {
   if ((mark_format == kBrainometer) || (mark_format == kByte)) {
     if (OpenSerial(portName, baudRate) >= 0) {
-      serial_port_open = true;
+      CheckSerialLatencyTimer(portName);
+      GetMarkDispatcher().AddSink(new SerialMarkSink(), true);
     } else {
       Screen::FatalError("Error opening serial port");
     }
   } else if (mark_format == kParallel) {
-    if (OpenParallel(portName) >= 0) {
-      serial_port_open = true;
+    if (OpenParallel(portName, mark_pulse_width_us) >= 0) {
+      GetMarkDispatcher().AddSink(new ParallelMarkSink(), true);
     } else {
       Screen::FatalError("Error opening parallel port");
     }
@@ -85,20 +676,48 @@ void SetMarkDirectory(const std::string &dir) {
   mark_directory = dir;
 }
 
+const std::string &GetMarkDirectory() {
+  return mark_directory;
+}
+
 void OpenMarkFile(const std::string &task) {
-  mark_tracking_vector.clear();
+  GetMarkDispatcher().Flush();
+  GetMarkDispatcher().ResetStats();
+  port_write_latencies.clear();
+  port_write_latencies.reserve(kExpectedPortWrites);
+  port_write_failures = 0;
+  mark_records.Clear();
   mark_task = task;
+  mark_header_fields.clear();
+  AddDisplayCalibration();
+  Screen::GetPresentationAudit().Reset(Screen::GetFramePeriodMicros());
+  if (!mark_directory.empty()) {
+    mark_journal->Open(mark_directory + kMarkJournalName, task,
+                       FormatDateString(GetDateTime()));
+  }
+}
+
+void SetMarkHeaderField(const std::string &key, const std::string &value) {
+  for (auto &field : mark_header_fields) {
+    if (field.first == key) {
+      field.second = value;
+      return;
+    }
+  }
+
+  mark_header_fields.emplace_back(key, value);
 }
 
 void CloseMarkFile() {
-  if (!mark_tracking_vector.empty() && !mark_directory.empty()) {
-    DateTime when = GetDateTime();
-
-    // Note: can't use colon in the date string because it isn't a valid
-    // filename character on Windows.
-    char date_string[256];
-    snprintf(date_string, sizeof(date_string), "%d-%d-%d_%02d-%02d-%02d",
-      when.month, when.day, when.year, when.hour, when.minute, when.second);
+  GetMarkDispatcher().Flush();
+  if (mark_records.GetSize() > 0) {
+    LogMarkStats();
+    AddPortWriteSummary();
+    AddPresentationSummary();
+  }
+
+  if (mark_records.GetSize() > 0 && !mark_directory.empty()) {
+    std::string date_string = FormatDateString(GetDateTime());
     std::string path = mark_directory + mark_task + "_" + date_string + ".csv";
     SDL_Log("Writing marks to %s\n", path.c_str());
     std::ofstream mark_file(path);
@@ -107,17 +726,16 @@ void CloseMarkFile() {
       return;
     }
 
-    mark_file << "{\r\n";
-    mark_file << "  \"gentask\": \"River2\",\r\n"; // this allows read-in functions to change format if necessary
-    mark_file << "  \"file_type\": \"mark\",\r\n";
-    mark_file << "  \"date\": \"" << date_string << "\",\r\n";
-    mark_file << "  \"task\": \"" << mark_task << "\",\r\n";
-    mark_file << "  \"version\": \"" << kFullVersionString << "\"\r\n";
-    mark_file << "}\r\n----\r\n";
-
-    mark_file << "Type,Time,Event\r\n";
-    for (const auto &mark_string : mark_tracking_vector) {
-      mark_file << mark_string;
+    WriteMarkFileHeader(mark_file, date_string, mark_task, mark_time_units,
+                        mark_header_fields);
+    const PresentationAudit &audit = Screen::GetPresentationAudit();
+    MarkEventTable &table = GetMarkEventTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    for (size_t i = 0; i < mark_records.GetSize(); i++) {
+      const MarkRecord &mark = mark_records.Get(i);
+      WriteMarkFileRow(mark_file, mark.num, mark.time_us,
+                       table.names[mark.event], mark_time_units,
+                       audit.GetPresentation(mark.presentation));
     }
 
     if (!mark_file) {
@@ -128,7 +746,83 @@ void CloseMarkFile() {
     mark_file.close();
   }
 
-  mark_tracking_vector.clear();
+  mark_journal->CloseAndRemove();
+  mark_records.Clear();
+}
+
+void RecoverMarkJournal() {
+  if (mark_directory.empty()) {
+    return;
+  }
+
+  std::string journal_path = mark_directory + kMarkJournalName;
+  std::ifstream journal(journal_path);
+  if (!journal) {
+    return;
+  }
+
+  std::string line;
+  std::getline(journal, line);
+  if (line != kMarkJournalMagic) {
+    SDL_Log("Ignoring unrecognized mark journal %s\n", journal_path.c_str());
+    return;
+  }
+
+  std::string task = "unknown";
+  std::string date_string = FormatDateString(GetDateTime());
+  MarkTimeUnits units = kMicroseconds;
+  std::unordered_map<int, std::string> event_names;
+  std::vector<std::string> rows;
+  while (std::getline(journal, line)) {
+    if (journal.eof()) {
+      // The last line was cut off by the crash.
+      break;
+    }
+
+    if (line.compare(0, 5, "task ") == 0) {
+      task = line.substr(5);
+    } else if (line.compare(0, 5, "date ") == 0) {
+      date_string = line.substr(5);
+    } else if (line == "time_units ms") {
+      units = kMilliseconds;
+    } else if (line.compare(0, 2, "E ") == 0) {
+      size_t name_start = line.find(' ', 2);
+      if (name_start != std::string::npos) {
+        event_names[atoi(line.c_str() + 2)] = line.substr(name_start + 1);
+      }
+    } else if (line.compare(0, 2, "M ") == 0) {
+      int num;
+      int64_t time_us;
+      int event;
+      if (sscanf(line.c_str(), "M %d %" SCNd64 " %d", &num, &time_us,
+                 &event) == 3) {
+        std::ostringstream row;
+        WriteMarkFileRow(row, num, time_us, event_names[event], units,
+                         nullptr);
+        rows.push_back(row.str());
+      }
+    }
+  }
+
+  journal.close();
+  if (!rows.empty()) {
+    std::string path =
+        mark_directory + task + "_" + date_string + "_recovered.csv";
+    SDL_Log("Recovering %d marks from %s to %s\n", static_cast<int>(rows.size()),
+            journal_path.c_str(), path.c_str());
+    std::ofstream mark_file(path);
+    WriteMarkFileHeader(mark_file, date_string, task, units, {});
+    for (const auto &row : rows) {
+      mark_file << row;
+    }
+
+    if (!mark_file) {
+      Screen::FatalError("Error writing recovered mark file.");
+      return;
+    }
+  }
+
+  remove(journal_path.c_str());
 }
 
 }  // namespace stimulus
@@ -27,13 +27,40 @@ enum MarkFormat {
   kParallel
 };
 
-void SendMark(int num, const std::string &event = "undefined");
+enum MarkTimeUnits {
+  kMicroseconds,
+  kMilliseconds  // Legacy mark file format
+};
+
+// Event names are interned once (typically at startup) so sending a mark
+// never allocates. The CSV text is only built when the mark file is written.
+typedef int MarkEventId;
+const MarkEventId kUndefinedMarkEvent = 0;
+MarkEventId InternMarkEvent(const std::string &name);
+
+void SendMark(int num, MarkEventId event = kUndefinedMarkEvent);
 void SetMarkFormat(MarkFormat format);
+void SetMarkTimeUnits(MarkTimeUnits units);
+
+// How long each parallel port mark is held before the lines are cleared.
+void SetMarkPulseWidth(int pulse_width_us);
+
+// Mark port writes that take longer than this are warned about, and a USB
+// serial adapter whose latency timer is longer is warned about at startup.
+void SetMarkLatencyWarning(int latency_us);
 void OpenMarkPort(const std::string &portName, int baudRate);
 void SetMarkDirectory(const std::string &dir);
+const std::string &GetMarkDirectory();
 void OpenMarkFile(const std::string &task_name);
 void CloseMarkFile();
 
+// Adds a field to the header of the current task's mark file. The value
+// must be valid JSON, e.g. a number or a quoted string.
+void SetMarkHeaderField(const std::string &key, const std::string &value);
+
+// Converts a mark journal left behind by a crash into a CSV file.
+void RecoverMarkJournal();
+
 }  // namespace stimulus
 
 #endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_MARK_H_
@@ -0,0 +1,189 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "MarkDispatcher.h"
+
+#include <chrono>
+
+#include "Clock.h"
+#include "Trace.h"
+
+namespace stimulus {
+namespace {
+
+// How often sinks get an Idle call while there are no marks.
+const int kIdleIntervalMs = 100;
+
+}  // namespace
+
+MarkDispatcher::MarkDispatcher()
+    : thread_(&MarkDispatcher::ThreadMain, this) {}
+
+MarkDispatcher::~MarkDispatcher() {
+  running_ = false;
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_condition_.notify_one();
+  }
+
+  if (thread_.joinable()) {
+    // If a sink hit a fatal error, exit() will run this destructor on the
+    // dispatcher thread itself.
+    if (thread_.get_id() == std::this_thread::get_id()) {
+      thread_.detach();
+    } else {
+      thread_.join();
+    }
+  }
+}
+
+void MarkDispatcher::AddSink(MarkSink *sink, bool write_first) {
+  std::lock_guard<std::mutex> lock(sinks_mutex_);
+  MarkSinkStats stats;
+  stats.name = sink->GetName();
+  if (write_first) {
+    sinks_.emplace(sinks_.begin(), sink);
+    stats_.insert(stats_.begin(), stats);
+  } else {
+    sinks_.emplace_back(sink);
+    stats_.push_back(stats);
+  }
+}
+
+bool MarkDispatcher::Enqueue(const MarkRecord &mark) {
+  if (!queue_.Push(mark)) {
+    dropped_count_++;
+    return false;
+  }
+
+  enqueued_count_++;
+  int depth = static_cast<int>(queue_.GetSize());
+  if (depth > max_queue_depth_) {
+    max_queue_depth_ = depth;
+  }
+
+  // The render thread only touches the mutex when the dispatcher is idle,
+  // in which case it is uncontended. The fences pair with the ones in
+  // ThreadMain so either we see the dispatcher going to sleep, or it sees
+  // the mark we just pushed.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_condition_.notify_one();
+  }
+
+  return true;
+}
+
+void MarkDispatcher::Flush() {
+  int64_t target = enqueued_count_;
+  std::unique_lock<std::mutex> lock(flush_mutex_);
+  flush_condition_.wait(lock, [this, target] {
+    return idle_count_ >= target;
+  });
+}
+
+int MarkDispatcher::GetQueueDepth() const {
+  return static_cast<int>(queue_.GetSize());
+}
+
+int MarkDispatcher::GetMaxQueueDepth() const {
+  return max_queue_depth_;
+}
+
+int MarkDispatcher::GetDroppedCount() const {
+  return dropped_count_;
+}
+
+std::vector<MarkSinkStats> MarkDispatcher::GetSinkStats() const {
+  std::lock_guard<std::mutex> lock(sinks_mutex_);
+  return stats_;
+}
+
+void MarkDispatcher::ResetStats() {
+  std::lock_guard<std::mutex> lock(sinks_mutex_);
+  for (auto &stats : stats_) {
+    stats.count = 0;
+    stats.total_latency_us = 0;
+    stats.max_latency_us = 0;
+    stats.total_write_us = 0;
+    stats.max_write_us = 0;
+  }
+
+  max_queue_depth_ = 0;
+  dropped_count_ = 0;
+}
+
+void MarkDispatcher::ThreadMain() {
+  SetTraceThreadName("marks");
+  MarkRecord mark;
+  while (true) {
+    while (queue_.Pop(&mark)) {
+      std::lock_guard<std::mutex> lock(sinks_mutex_);
+      for (size_t i = 0; i < sinks_.size(); i++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        {
+          TraceScope trace("WriteMark", &typeid(*sinks_[i]));
+          sinks_[i]->WriteMark(mark);
+        }
+
+        int64_t write_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        int64_t latency = GetTimeMicros() - mark.enqueue_time_us;
+        MarkSinkStats &stats = stats_[i];
+        stats.count++;
+        stats.total_write_us += write_us;
+        if (write_us > stats.max_write_us) {
+          stats.max_write_us = write_us;
+        }
+
+        stats.total_latency_us += latency;
+        if (latency > stats.max_latency_us) {
+          stats.max_latency_us = latency;
+        }
+      }
+
+      written_count_++;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(sinks_mutex_);
+      for (auto &sink : sinks_) {
+        sink->Idle();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(flush_mutex_);
+      idle_count_ = written_count_.load();
+      flush_condition_.notify_all();
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    if (!running_ && queue_.IsEmpty()) {
+      break;
+    }
+
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_condition_.wait_for(
+        lock, std::chrono::milliseconds(kIdleIntervalMs),
+        [this] { return !queue_.IsEmpty() || !running_; });
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace stimulus
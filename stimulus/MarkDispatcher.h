@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_MARKDISPATCHER_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_MARKDISPATCHER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mark.h"
+#include "SpscRing.h"
+
+namespace stimulus {
+
+struct MarkRecord {
+  int num;
+  MarkEventId event;
+  int presentation;         // Screen presentation this is the onset of, or -1
+  int64_t time_us;          // Timestamp recorded in the mark file
+  int64_t enqueue_time_us;  // When SendMark queued it, for latency stats
+};
+
+// A destination for marks (serial port, parallel port, log file...).
+// WriteMark is only ever called from the dispatcher thread.
+class MarkSink {
+ public:
+  virtual ~MarkSink() {}
+  virtual const char *GetName() const = 0;
+  virtual void WriteMark(const MarkRecord &mark) = 0;
+
+  // Called after the queue drains (before a Flush returns), and
+  // periodically while it is empty.
+  virtual void Idle() {}
+};
+
+// Latency is from SendMark until this sink finished writing, so it includes
+// the sinks before it. Write time is just this sink's WriteMark, measured
+// on the wall clock.
+struct MarkSinkStats {
+  std::string name;
+  int64_t count = 0;
+  int64_t total_latency_us = 0;
+  int64_t max_latency_us = 0;
+  int64_t total_write_us = 0;
+  int64_t max_write_us = 0;
+};
+
+// Moves mark output off the render thread. SendMark pushes events into a
+// fixed size ring, and a dedicated thread writes each one to every sink.
+// Enqueue must always be called from the same thread.
+class MarkDispatcher {
+ public:
+  MarkDispatcher();
+  ~MarkDispatcher();
+
+  // Takes ownership of the sink. Sinks are written in the order they were
+  // added, except that those added with write_first go ahead of the rest,
+  // so a port trigger doesn't wait behind logging and file writes.
+  void AddSink(MarkSink *sink, bool write_first = false);
+
+  // Never blocks. Returns false (and drops the mark) if the queue is full.
+  bool Enqueue(const MarkRecord &mark);
+
+  // Wait until every mark enqueued so far has been written to all sinks,
+  // and the sinks have been called Idle after them.
+  void Flush();
+
+  int GetQueueDepth() const;
+  int GetMaxQueueDepth() const;
+  int GetDroppedCount() const;
+  std::vector<MarkSinkStats> GetSinkStats() const;
+  void ResetStats();
+
+ private:
+  static const size_t kQueueSize = 1024;
+
+  void ThreadMain();
+
+  SpscRing<MarkRecord, kQueueSize> queue_;
+  std::atomic<bool> running_{true};
+  std::atomic<bool> sleeping_{false};
+  std::atomic<int64_t> enqueued_count_{0};
+  std::atomic<int64_t> written_count_{0};
+  // written_count_ when the sinks were last called Idle.
+  std::atomic<int64_t> idle_count_{0};
+  std::atomic<int> max_queue_depth_{0};
+  std::atomic<int> dropped_count_{0};
+
+  // Wakes the dispatcher thread when it is idle.
+  std::mutex wake_mutex_;
+  std::condition_variable wake_condition_;
+
+  // Signalled when the dispatcher thread catches up, for Flush.
+  std::mutex flush_mutex_;
+  std::condition_variable flush_condition_;
+
+  // Protects the sinks and their statistics.
+  mutable std::mutex sinks_mutex_;
+  std::vector<std::unique_ptr<MarkSink>> sinks_;
+  std::vector<MarkSinkStats> stats_;
+
+  // Declared last so everything above is constructed before it starts.
+  std::thread thread_;
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_MARKDISPATCHER_H_
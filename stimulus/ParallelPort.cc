@@ -0,0 +1,128 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ParallelPort.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/parport.h>
+#include <linux/ppdev.h>
+#endif
+
+namespace stimulus {
+
+ParallelPort::~ParallelPort() {
+  Close();
+}
+
+bool ParallelPort::Open(const std::string &path, int pulse_width_us,
+                        std::string *error) {
+  Close();
+  fd_ = open(path.c_str(), O_RDWR);
+  if (fd_ < 0) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd_, &info) < 0) {
+    *error = path + ": " + strerror(errno);
+    Close();
+    return false;
+  }
+
+  is_device_ = !S_ISREG(info.st_mode);
+  if (is_device_) {
+#ifdef __linux__
+    // The port has to be claimed before its lines can be written, and it
+    // is held until the port is closed.
+    if (ioctl(fd_, PPCLAIM) < 0) {
+      *error = path + ": PPCLAIM: " + strerror(errno);
+      close(fd_);
+      fd_ = -1;
+      return false;
+    }
+#else
+    *error = path + ": parallel ports need Linux's ppdev driver";
+    close(fd_);
+    fd_ = -1;
+    return false;
+#endif
+  }
+
+  pulse_width_us_ = pulse_width_us;
+  if (!SetData(0)) {
+    *error = path + ": " + strerror(errno);
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void ParallelPort::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+
+#ifdef __linux__
+  if (is_device_) {
+    ioctl(fd_, PPRELEASE);
+  }
+#endif
+
+  close(fd_);
+  fd_ = -1;
+}
+
+int64_t ParallelPort::Pulse(uint8_t value) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (!SetData(value)) {
+    return -1;
+  }
+
+  int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  std::this_thread::sleep_for(std::chrono::microseconds(pulse_width_us_));
+  if (!SetData(0)) {
+    return -1;
+  }
+
+  return latency_us;
+}
+
+bool ParallelPort::SetData(uint8_t value) {
+  if (fd_ < 0) {
+    return false;
+  }
+
+#ifdef __linux__
+  if (is_device_) {
+    return ioctl(fd_, PPWDATA, &value) == 0;
+  }
+#endif
+
+  return write(fd_, &value, 1) == 1;
+}
+
+}  // namespace stimulus
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PARALLELPORT_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PARALLELPORT_H_
+
+#include <cstdint>
+#include <string>
+
+namespace stimulus {
+
+// Sends trigger values on a parallel port's data lines through Linux's
+// ppdev driver (/dev/parportN), which unlike writing the port's I/O address
+// doesn't need root. Each value is held for the pulse width, then the lines
+// go back to zero, so consecutive marks with the same value are still seen
+// as separate triggers.
+//
+// If the path is a regular file, each value written to the lines is
+// appended to it instead, so this can be tested without a port.
+class ParallelPort {
+ public:
+  ParallelPort() {}
+  ~ParallelPort();
+
+  // Returns false and sets error if the port couldn't be opened and
+  // claimed.
+  bool Open(const std::string &path, int pulse_width_us, std::string *error);
+  void Close();
+
+  // Blocks for the pulse width. Returns how long it took to raise the
+  // lines, in microseconds, or -1 if a write failed.
+  int64_t Pulse(uint8_t value);
+
+ private:
+  bool SetData(uint8_t value);
+
+  int fd_ = -1;
+  bool is_device_ = false;
+  int pulse_width_us_ = 0;
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PARALLELPORT_H_
@@ -0,0 +1,95 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "ParallelPort.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int kPulseWidthUs = 2000;
+
+// A regular file that stands in for the port's device file.
+class StubDevice {
+ public:
+  StubDevice() {
+    char path[] = "/tmp/parallel_port_testXXXXXX";
+    int fd = mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+    path_ = path;
+  }
+
+  ~StubDevice() {
+    unlink(path_.c_str());
+  }
+
+  const std::string &GetPath() const {
+    return path_;
+  }
+
+  // Every value the data lines were set to.
+  std::string GetValues() const {
+    std::ifstream file(path_, std::ios::binary);
+    std::stringstream values;
+    values << file.rdbuf();
+    return values.str();
+  }
+
+ private:
+  std::string path_;
+};
+
+// Each pulse returns to zero, and opening the port clears the lines.
+BOOST_AUTO_TEST_CASE(ParallelPortPulses) {
+  StubDevice device;
+  stimulus::ParallelPort port;
+  std::string error;
+  BOOST_REQUIRE(port.Open(device.GetPath(), kPulseWidthUs, &error));
+  BOOST_CHECK_GE(port.Pulse(0x2a), 0);
+  BOOST_CHECK_GE(port.Pulse(0xff), 0);
+  port.Close();
+
+  BOOST_CHECK_EQUAL(device.GetValues(), std::string("\0\x2a\0\xff\0", 5));
+}
+
+BOOST_AUTO_TEST_CASE(ParallelPortPulseWidth) {
+  StubDevice device;
+  stimulus::ParallelPort port;
+  std::string error;
+  BOOST_REQUIRE(port.Open(device.GetPath(), kPulseWidthUs, &error));
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  int64_t latency_us = port.Pulse(1);
+  int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  BOOST_CHECK_GE(elapsed_us, kPulseWidthUs);
+  BOOST_CHECK_LE(latency_us, elapsed_us - kPulseWidthUs);
+}
+
+BOOST_AUTO_TEST_CASE(ParallelPortErrors) {
+  stimulus::ParallelPort port;
+  std::string error;
+  BOOST_CHECK(!port.Open("/nonexistent/parport0", kPulseWidthUs, &error));
+  BOOST_CHECK(error.find("/nonexistent/parport0") != std::string::npos);
+  BOOST_CHECK_EQUAL(port.Pulse(1), -1);
+}
+
+}  // namespace
@@ -17,17 +17,33 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PLATFORM_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PLATFORM_H_
 
+#include <cstdint>
+#include <cstdio>
 #include <vector>
 #include <string>
 
 namespace stimulus {
 
-int OpenParallel(const std::string &portName);
-void WriteParallel(int datum);
+// Each mark is held on the data lines for the pulse width, then cleared.
+// WriteParallel returns how long it took to raise the lines, in
+// microseconds, or -1 if it failed.
+int OpenParallel(const std::string &portName, int pulse_width_us);
+int64_t WriteParallel(int datum);
 int OpenSerial(const std::string &name, int baud_rate);
 void CloseSerial();
+
+// Neither waits long for a stalled port: WriteSerial returns -1 if the
+// bytes can't all be queued, and ReadSerial returns 0 if none arrive.
 int WriteSerial(const void *buf, int length);
 int ReadSerial(void *buf, int length);
+
+// Waits, for no longer than the above, until the bytes written to the
+// serial port have been sent. Returns false if they haven't.
+bool DrainSerial();
+
+// The latency timer of a USB serial adapter (how long it may hold bytes),
+// or -1 if the port isn't one or it couldn't be read.
+int GetSerialLatencyTimerMs();
 std::string GetResourceDir();
 uint32_t GetRandomSeed();
 std::vector<std::string> GetAvailableSerialPorts();
@@ -43,6 +59,23 @@ struct DateTime {
 
 DateTime GetDateTime();
 
+// Flush the stream and wait for the data to reach the disk.
+bool SyncFile(FILE *file);
+
+// Wait for what has already been written to the descriptor to reach the
+// disk. This doesn't touch a stream's buffer, so it can run on another
+// thread while the stream is being written.
+bool SyncFileDescriptor(int fd);
+
+// Maps a whole file read only, for the life of the program. Returns null if
+// it couldn't be opened or mapped.
+const void *MapFile(const std::string &path, size_t *size);
+
+// The size of a file, and when it was last modified in seconds since the
+// epoch. Returns false if it couldn't be found.
+bool GetFileInfo(const std::string &path, int64_t *size,
+                 int64_t *modified_time);
+
 }  // namespace stimulus
 
 #endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PLATFORM_H_
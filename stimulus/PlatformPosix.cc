@@ -15,6 +15,10 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 #include <sys/types.h>
@@ -24,14 +28,28 @@
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+#include "Clock.h"
+#include "ParallelPort.h"
 #include "Platform.h"
 #include "Screen.h"
 
 namespace stimulus {
 namespace {
 int serial_fd;
+// The longest a serial read, write, or drain waits for the port.
+const int kSerialTimeoutMs = 100;
+// How often a drain checks whether the bytes have been sent.
+const int kSerialDrainPollUs = 100;
+int serial_latency_timer_ms = -1;
+std::unique_ptr<ParallelPort> parallel_port;
 bool have_resource_dir;
 std::string resource_dir;
 
@@ -84,15 +102,85 @@ bool IsTty(const std::string &path) {
   return result;
 }
 
+#ifdef __linux__
+// USB serial adapters (FTDI in particular) hold bytes for up to their
+// latency timer, 16 ms by default, before passing them on. Ask for low
+// latency, and set the timer to 1 ms if we're allowed to (writing it
+// usually needs root or a udev rule). Neither is fatal, since the adapter
+// still works, but the timer that ends up in effect is remembered so
+// startup can warn about it.
+void TuneUsbSerial(const std::string &name) {
+  std::string sys_path = "/sys/class/tty/" + name + "/device";
+  char device_path[PATH_MAX];
+  if (realpath(sys_path.c_str(), device_path) == nullptr ||
+      strstr(device_path, "/usb") == nullptr) {
+    return;
+  }
+
+  SDL_Log("%s is a USB serial adapter\n", name.c_str());
+  struct serial_struct serial_info;
+  if (ioctl(serial_fd, TIOCGSERIAL, &serial_info) == 0) {
+    serial_info.flags |= ASYNC_LOW_LATENCY;
+    if (ioctl(serial_fd, TIOCSSERIAL, &serial_info) != 0) {
+      SDL_Log("Couldn't set low latency mode on %s: %s\n", name.c_str(),
+              strerror(errno));
+    }
+  }
+
+  // Only FTDI adapters have a latency timer.
+  std::string timer_path = sys_path + "/latency_timer";
+  if (access(timer_path.c_str(), F_OK) < 0) {
+    return;
+  }
+
+  FILE *timer = fopen(timer_path.c_str(), "r+");
+  if (timer == nullptr || fprintf(timer, "1\n") < 0 || fflush(timer) != 0) {
+    SDL_Log("Couldn't set %s: %s\n", timer_path.c_str(), strerror(errno));
+    if (timer == nullptr) {
+      timer = fopen(timer_path.c_str(), "r");
+    }
+  }
+
+  if (timer != nullptr) {
+    rewind(timer);
+    if (fscanf(timer, "%d", &serial_latency_timer_ms) != 1) {
+      serial_latency_timer_ms = -1;
+    }
+
+    fclose(timer);
+    SDL_Log("%s latency timer is %d ms\n", name.c_str(),
+            serial_latency_timer_ms);
+  }
+}
+#endif
+
 }  // namespace
 
-int OpenParallel(const std::string &portName) {
-  Screen::FatalError("Open parallel port not supported on Posix");
-  return -1;
+// Ports are named like serial ports (parport0), or by their full path.
+int OpenParallel(const std::string &portName, int pulse_width_us) {
+  std::string path = portName;
+  if (path.empty() || path[0] != '/') {
+    path = "/dev/" + path;
+  }
+
+  // Release a port that is already open before claiming the new one.
+  parallel_port.reset(new ParallelPort());
+  std::string error;
+  if (!parallel_port->Open(path, pulse_width_us, &error)) {
+    parallel_port.reset();
+    Screen::FatalError(std::string(__FUNCTION__) + ": " + error);
+    return -1;
+  }
+
+  return 0;
 }
 
-void WriteParallel(int datum) {
-  Screen::FatalError("Write parallel port not supported on Posix");
+int64_t WriteParallel(int datum) {
+  if (!parallel_port) {
+    return -1;
+  }
+
+  return parallel_port->Pulse(datum & 0xff);
 }
 
 int OpenSerial(const std::string &name, int baud_rate) {
@@ -100,7 +188,9 @@ int OpenSerial(const std::string &name, int baud_rate) {
 
   std::string path = "/dev/";
   path += name;
-  serial_fd = open(path.c_str(), O_RDWR | O_NOCTTY);
+  // Writes are non-blocking, so a stalled adapter can't hold up the mark
+  // thread forever.
+  serial_fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
   if (serial_fd < 0) {
     PrintSyscallError(__FUNCTION__, "open");
     return -1;
@@ -128,6 +218,10 @@ int OpenSerial(const std::string &name, int baud_rate) {
   }
 
   tcflush(serial_fd, TCIOFLUSH);
+#ifdef __linux__
+  TuneUsbSerial(name);
+#endif
+
   return 0;
 }
 
@@ -136,10 +230,55 @@ void CloseSerial() {
 }
 
 int WriteSerial(const void *buf, int length) {
-  return write(serial_fd, buf, length);
+  const char *data = static_cast<const char *>(buf);
+  int written = 0;
+  while (written < length) {
+    ssize_t result = write(serial_fd, data + written, length - written);
+    if (result >= 0) {
+      written += result;
+    } else if (errno == EAGAIN) {
+      // The output buffer is full. If it doesn't drain in time, the
+      // adapter has stalled, and the rest of the mark is dropped.
+      struct pollfd poll_fd = {serial_fd, POLLOUT, 0};
+      if (poll(&poll_fd, 1, kSerialTimeoutMs) == 0) {
+        return -1;
+      }
+    } else if (errno != EINTR) {
+      return -1;
+    }
+  }
+
+  return written;
+}
+
+// tcdrain would wait forever for a stalled adapter, so this polls the
+// number of bytes the driver (and a USB adapter) still holds instead.
+bool DrainSerial() {
+  int64_t deadline_us = GetWallTimeMicros() + kSerialTimeoutMs * 1000;
+  while (true) {
+    int unsent;
+    if (ioctl(serial_fd, TIOCOUTQ, &unsent) != 0) {
+      return false;
+    } else if (unsent == 0) {
+      return true;
+    } else if (GetWallTimeMicros() >= deadline_us) {
+      return false;
+    }
+
+    usleep(kSerialDrainPollUs);
+  }
+}
+
+int GetSerialLatencyTimerMs() {
+  return serial_latency_timer_ms;
 }
 
 int ReadSerial(void *buf, int length) {
+  struct pollfd poll_fd = {serial_fd, POLLIN, 0};
+  if (poll(&poll_fd, 1, kSerialTimeoutMs) == 0) {
+    return 0;
+  }
+
   return read(serial_fd, buf, length);
 }
 
@@ -265,4 +404,46 @@ DateTime GetDateTime() {
   return retval;
 }
 
+bool SyncFile(FILE *file) {
+  return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+bool SyncFileDescriptor(int fd) {
+  return fsync(fd) == 0;
+}
+
+const void *MapFile(const std::string &path, size_t *size) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat info;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  // The mapping keeps the file open.
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+
+  *size = info.st_size;
+  return data;
+}
+
+bool GetFileInfo(const std::string &path, int64_t *size,
+                 int64_t *modified_time) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    return false;
+  }
+
+  *size = info.st_size;
+  *modified_time = info.st_mtime;
+  return true;
+}
+
 }  // namespace stimulus
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <windows.h>
+#include <io.h>
 #include "Platform.h"
 #include "Screen.h"
 #include <chrono>
@@ -28,6 +29,7 @@ typedef void (_stdcall *oupfuncPtr) (short portaddr, unsigned short datum);
 HINSTANCE hLib;
 oupfuncPtr out;
 int parallelportNumber;
+int parallel_pulse_width_us;
 
 void PrintSyscallError(const char *function, const char *call) {
   char message_buffer[256];
@@ -39,8 +41,9 @@ void PrintSyscallError(const char *function, const char *call) {
 
 }  // namespace
 
-int OpenParallel(const std::string &portName) {
+int OpenParallel(const std::string &portName, int pulse_width_us) {
   sscanf (portName.c_str(), "%x", &parallelportNumber); // convert hex string to int
+  parallel_pulse_width_us = pulse_width_us;
   // load parallel port DLL
   hLib = LoadLibrary("inpout32.dll");
   if (hLib != NULL) {
@@ -58,10 +61,16 @@ int OpenParallel(const std::string &portName) {
   return 0;
 }
 
-void WriteParallel(int datum) {
+int64_t WriteParallel(int datum) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
   out(parallelportNumber, datum);   //send code to data port pin
-  std::this_thread::sleep_for(std::chrono::milliseconds(2)); // pulse duration
+  int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  std::this_thread::sleep_for(
+      std::chrono::microseconds(parallel_pulse_width_us)); // pulse duration
   out(parallelportNumber, 0);   //set all pins low
+  return latency_us;
 }
 
 int OpenSerial(const std::string &name, int baud_rate) {
@@ -145,6 +154,16 @@ int WriteSerial(const void *buf, int length) {
   return bytes_transferred;
 }
 
+// WriteSerial waits for the write to complete.
+bool DrainSerial() {
+  return true;
+}
+
+// The FTDI driver's latency timer is set in Device Manager.
+int GetSerialLatencyTimerMs() {
+  return -1;
+}
+
 int ReadSerial(void *buf, int length) {
   OVERLAPPED overlap;
   overlap.hEvent = read_event;
@@ -221,4 +240,61 @@ DateTime GetDateTime() {
   return retval;
 }
 
+bool SyncFile(FILE *file) {
+  return fflush(file) == 0 && _commit(_fileno(file)) == 0;
+}
+
+bool SyncFileDescriptor(int fd) {
+  return _commit(fd) == 0;
+}
+
+const void *MapFile(const std::string &path, size_t *size) {
+  HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+
+  LARGE_INTEGER file_size;
+  HANDLE mapping = NULL;
+  if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+    mapping = CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0);
+  }
+
+  // The view keeps the file and mapping open.
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return nullptr;
+  }
+
+  const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (data == nullptr) {
+    return nullptr;
+  }
+
+  *size = static_cast<size_t>(file_size.QuadPart);
+  return data;
+}
+
+bool GetFileInfo(const std::string &path, int64_t *size,
+                 int64_t *modified_time) {
+  WIN32_FILE_ATTRIBUTE_DATA info;
+  if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &info)) {
+    return false;
+  }
+
+  // File times count 100 ns intervals from 1601.
+  const int64_t kIntervalsPerSecond = 10000000;
+  const int64_t kEpochIntervals = 116444736000000000LL;
+  ULARGE_INTEGER write_time;
+  write_time.LowPart = info.ftLastWriteTime.dwLowDateTime;
+  write_time.HighPart = info.ftLastWriteTime.dwHighDateTime;
+  *size = (static_cast<int64_t>(info.nFileSizeHigh) << 32) |
+          info.nFileSizeLow;
+  *modified_time = (static_cast<int64_t>(write_time.QuadPart) -
+                    kEpochIntervals) / kIntervalsPerSecond;
+  return true;
+}
+
 }  // namespace stimulus
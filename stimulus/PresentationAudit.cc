@@ -0,0 +1,137 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PresentationAudit.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <set>
+
+namespace stimulus {
+namespace {
+
+const size_t kReservedPresentations = 16384;
+
+}  // namespace
+
+void PresentationAudit::Reset(int64_t frame_period_us) {
+  presentations_.clear();
+  presentations_.reserve(kReservedPresentations);
+  open_presentation_ = -1;
+  current_screen_visible_ = false;
+  frame_period_us_ = frame_period_us;
+  last_present_us_ = -1;
+  missed_frames_ = 0;
+}
+
+void PresentationAudit::ScreenActivated() {
+  pending_nominal_ms_ = 0;
+  current_screen_visible_ = false;
+}
+
+void PresentationAudit::SetNominalDuration(int duration_ms) {
+  if (duration_ms <= 0) {
+    return;
+  }
+
+  // The screen may set its duration before it is visible (in IsActive)
+  // or after (in IsVisible).
+  pending_nominal_ms_ = duration_ms;
+  if (current_screen_visible_ && open_presentation_ >= 0) {
+    presentations_[open_presentation_].nominal_ms = duration_ms;
+  }
+}
+
+void PresentationAudit::FramePresented(int64_t time_us) {
+  if (last_present_us_ >= 0 && frame_period_us_ > 0) {
+    int64_t interval = time_us - last_present_us_;
+    if (interval * 2 > frame_period_us_ * 3) {
+      missed_frames_ += std::llround(static_cast<double>(interval) /
+                                     frame_period_us_) - 1;
+    }
+  }
+
+  last_present_us_ = time_us;
+}
+
+void PresentationAudit::FramesSkipped(int64_t time_us) {
+  last_present_us_ = time_us;
+}
+
+int PresentationAudit::ScreenVisible(int64_t frame, int64_t time_us) {
+  Presentation presentation;
+  presentation.visible_frame = frame;
+  presentation.visible_us = time_us;
+  presentation.nominal_ms = pending_nominal_ms_;
+  presentations_.push_back(presentation);
+  open_presentation_ = static_cast<int>(presentations_.size()) - 1;
+  current_screen_visible_ = true;
+  return open_presentation_;
+}
+
+void PresentationAudit::ScreenInvisible(int64_t frame, int64_t time_us) {
+  if (open_presentation_ < 0) {
+    return;
+  }
+
+  Presentation &presentation = presentations_[open_presentation_];
+  presentation.invisible_frame = frame;
+  presentation.invisible_us = time_us;
+  open_presentation_ = -1;
+}
+
+const PresentationAudit::Presentation *PresentationAudit::GetPresentation(
+    int id) const {
+  if (id < 0 || id >= static_cast<int>(presentations_.size())) {
+    return nullptr;
+  }
+
+  return &presentations_[id];
+}
+
+int64_t PresentationAudit::NominalFrames(int duration_ms) const {
+  if (frame_period_us_ <= 0) {
+    return 0;
+  }
+
+  return std::llround(static_cast<double>(duration_ms) * 1000 /
+                      frame_period_us_);
+}
+
+PresentationAudit::Summary PresentationAudit::Summarize(
+    const std::vector<int> &onset_ids) const {
+  Summary summary;
+  summary.missed_frames = missed_frames_;
+
+  // A stimulus may have more than one onset mark.
+  std::set<int> stimuli(onset_ids.begin(), onset_ids.end());
+  for (int id : stimuli) {
+    const Presentation *presentation = GetPresentation(id);
+    if (presentation == nullptr || !presentation->IsComplete() ||
+        presentation->nominal_ms == 0) {
+      continue;
+    }
+
+    summary.timed_stimuli++;
+    int64_t error = presentation->GetDurationFrames() -
+                    NominalFrames(presentation->nominal_ms);
+    if (std::llabs(error) >= 1) {
+      summary.off_by_frame++;
+    }
+  }
+
+  return summary;
+}
+
+}  // namespace stimulus
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PRESENTATIONAUDIT_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PRESENTATIONAUDIT_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace stimulus {
+
+// Keeps track of when each screen was actually on the display, so the
+// achieved duration of every stimulus can be compared with its nominal
+// duration. This doesn't depend on SDL; the main loop feeds it the frame
+// number and time of each present.
+class PresentationAudit {
+ public:
+  struct Presentation {
+    int64_t visible_frame;
+    int64_t visible_us;
+    int64_t invisible_frame = -1;  // -1 while still on screen
+    int64_t invisible_us = -1;
+    int nominal_ms;  // 0 if this screen wasn't timed
+
+    bool IsComplete() const { return invisible_frame >= 0; }
+    int64_t GetDurationFrames() const { return invisible_frame - visible_frame; }
+    int64_t GetDurationMicros() const { return invisible_us - visible_us; }
+  };
+
+  struct Summary {
+    int timed_stimuli = 0;
+    int off_by_frame = 0;  // Achieved differs from nominal by 1+ frames
+    int64_t missed_frames = 0;
+  };
+
+  // Discards everything recorded so far. Space for a task's worth of
+  // presentations is reserved up front so recording doesn't allocate.
+  void Reset(int64_t frame_period_us);
+
+  // Called when a new screen is activated. Any nominal duration set after
+  // this applies to it.
+  void ScreenActivated();
+
+  // The nominal duration of the current screen (the delay passed to
+  // SwitchToScreen). The last non-zero value wins.
+  void SetNominalDuration(int duration_ms);
+
+  // Called after each present. Gaps of more than one and a half frame
+  // periods are counted as missed frames.
+  void FramePresented(int64_t time_us);
+
+  // Headless runs skip frames that would have shown the same image. These
+  // aren't counted as missed; time_us is when the last of them would have
+  // been presented.
+  void FramesSkipped(int64_t time_us);
+
+  // Returns the id of the new presentation.
+  int ScreenVisible(int64_t frame, int64_t time_us);
+  void ScreenInvisible(int64_t frame, int64_t time_us);
+
+  // Returns null if the id is invalid (e.g. from before the last Reset).
+  const Presentation *GetPresentation(int id) const;
+
+  int64_t NominalFrames(int duration_ms) const;
+
+  // Only presentations in onset_ids (those that had a mark sent when they
+  // became visible) are counted as stimuli.
+  Summary Summarize(const std::vector<int> &onset_ids) const;
+
+ private:
+  std::vector<Presentation> presentations_;
+  int open_presentation_ = -1;
+  bool current_screen_visible_ = false;
+  int pending_nominal_ms_ = 0;
+  int64_t frame_period_us_ = 0;
+  int64_t last_present_us_ = -1;
+  int64_t missed_frames_ = 0;
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_PRESENTATIONAUDIT_H_
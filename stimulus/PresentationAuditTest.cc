@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include "PresentationAudit.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int64_t kFramePeriodUs = 16667;
+
+// Simulates a screen that is activated, shown for the given number of
+// frames, then replaced. Returns the presentation id.
+int Present(stimulus::PresentationAudit *audit, int64_t *frame,
+            int nominal_ms, int frames_shown) {
+  audit->ScreenActivated();
+  audit->SetNominalDuration(nominal_ms);
+  int id = audit->ScreenVisible(*frame, *frame * kFramePeriodUs);
+  *frame += frames_shown;
+  audit->ScreenInvisible(*frame, *frame * kFramePeriodUs);
+  return id;
+}
+
+BOOST_AUTO_TEST_CASE(AchievedDuration) {
+  stimulus::PresentationAudit audit;
+  audit.Reset(kFramePeriodUs);
+  int64_t frame = 10;
+  std::vector<int> onsets;
+  onsets.push_back(Present(&audit, &frame, 100, 6));  // exact
+  onsets.push_back(Present(&audit, &frame, 100, 7));  // one frame late
+  onsets.push_back(Present(&audit, &frame, 200, 11));  // one frame early
+  Present(&audit, &frame, 100, 9);  // no onset mark, not a stimulus
+  onsets.push_back(Present(&audit, &frame, 0, 30));  // untimed
+
+  const stimulus::PresentationAudit::Presentation *first =
+      audit.GetPresentation(onsets[0]);
+  BOOST_REQUIRE(first != nullptr);
+  BOOST_CHECK_EQUAL(first->GetDurationFrames(), 6);
+  BOOST_CHECK_EQUAL(first->GetDurationMicros(), 6 * kFramePeriodUs);
+  BOOST_CHECK_EQUAL(first->nominal_ms, 100);
+
+  stimulus::PresentationAudit::Summary summary = audit.Summarize(onsets);
+  BOOST_CHECK_EQUAL(summary.timed_stimuli, 3);
+  BOOST_CHECK_EQUAL(summary.off_by_frame, 2);
+}
+
+// A duration set in IsActive (before the screen is visible) must not be
+// applied to the previous screen, which is still on the display.
+BOOST_AUTO_TEST_CASE(NominalDurationBeforeVisible) {
+  stimulus::PresentationAudit audit;
+  audit.Reset(kFramePeriodUs);
+  int first = audit.ScreenVisible(0, 0);
+  audit.SetNominalDuration(500);
+
+  audit.ScreenActivated();
+  audit.SetNominalDuration(100);
+  audit.ScreenInvisible(30, 30 * kFramePeriodUs);
+  int second = audit.ScreenVisible(31, 31 * kFramePeriodUs);
+
+  BOOST_CHECK_EQUAL(audit.GetPresentation(first)->nominal_ms, 500);
+  BOOST_CHECK_EQUAL(audit.GetPresentation(second)->nominal_ms, 100);
+  BOOST_CHECK(!audit.GetPresentation(second)->IsComplete());
+}
+
+BOOST_AUTO_TEST_CASE(MissedFrames) {
+  stimulus::PresentationAudit audit;
+  audit.Reset(kFramePeriodUs);
+  int64_t time = 0;
+  for (int i = 0; i < 10; i++) {
+    audit.FramePresented(time);
+    time += kFramePeriodUs;
+  }
+
+  // Skipping two vsyncs
+  time += kFramePeriodUs * 2;
+  audit.FramePresented(time);
+
+  // Jitter shouldn't count
+  time += kFramePeriodUs * 5 / 4;
+  audit.FramePresented(time);
+
+  BOOST_CHECK_EQUAL(audit.Summarize(std::vector<int>()).missed_frames, 2);
+}
+
+BOOST_AUTO_TEST_CASE(SkippedFramesAreNotMissed) {
+  stimulus::PresentationAudit audit;
+  audit.Reset(kFramePeriodUs);
+  audit.FramePresented(0);
+
+  // A headless run skipping ahead 100 frames
+  audit.FramesSkipped(kFramePeriodUs * 100);
+  audit.FramePresented(kFramePeriodUs * 101);
+
+  BOOST_CHECK_EQUAL(audit.Summarize(std::vector<int>()).missed_frames, 0);
+}
+
+}  // namespace
@@ -12,52 +12,90 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <climits>
-#include <cstdint>
-#include <cmath>
 #include "Random.h"
 
 namespace stimulus {
 namespace {
-uint32_t random_state[4] = {1,1,1,1};
-
-// https://en.wikipedia.org/wiki/Xorshift
-uint32_t Xorshift128() {
-  uint32_t t = random_state[3];
-  t ^= t << 11;
-  t ^= t >> 8;
-  for (int i = 3; i > 0; i--) {
-    random_state[i] = random_state[i - 1];
-  }
 
-  uint32_t s = random_state[0];
-  t ^= s;
-  t ^= s >> 19;
-  random_state[0] = t;
+// https://en.wikipedia.org/wiki/Xorshift#Initialization
+uint64_t SplitMix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+uint64_t HashName(const std::string &name) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+  }
 
-  return t;
+  return hash;
 }
 
 }  // namespace
 
-void InitRandom(uint32_t seed) {
-  random_state[0] = random_state[1] = random_state[2] = random_state[3] = seed;
+RandomStream::RandomStream(uint64_t seed) {
+  // Expanding the seed this way means similar seeds give unrelated
+  // streams, and the state is never all zero in practice.
+  for (int i = 0; i < 4; i += 2) {
+    uint64_t value = SplitMix64(&seed);
+    state_[i] = static_cast<uint32_t>(value);
+    state_[i + 1] = static_cast<uint32_t>(value >> 32);
+  }
+}
+
+RandomStream::RandomStream(uint64_t seed, const std::string &name)
+    : RandomStream(SplitMix64(&seed) ^ HashName(name)) {}
+
+double RandomStream::NextDouble() {
+  uint64_t high = Next();
+  uint64_t bits = ((high << 32) | Next()) >> 11;
+  return bits * (1.0 / (1ull << 53));
+}
+
+void RandomStream::Fill(uint32_t *values, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    values[i] = Next();
+  }
+}
 
-  for (int i = 0; i < 50; i++) {
-    Xorshift128();
+void RandomStream::FillInts(uint32_t *values, size_t count, uint32_t min,
+                            uint32_t max) {
+  uint32_t range = max - min;
+  for (size_t i = 0; i < count; i++) {
+    values[i] = min + NextBelow(range);
   }
 }
 
-// Generate a random integer in the range [min, max)
-uint32_t GenerateRandomInt(uint32_t min, uint32_t max) {
-  // Use floor to ensure this is unbiased
-  return floor(GenerateRandomDouble() * (max - min)) + min;
+void RandomStream::Jump() {
+  // The state 2^64 steps ahead is this combination of the next 128.
+  static const uint32_t kJump[] = {0x8764000b, 0xf542d2d3, 0x6fa035c3,
+                                   0x77f2db5b};
+  uint32_t jumped[4] = {0, 0, 0, 0};
+  for (uint32_t word : kJump) {
+    for (int bit = 0; bit < 32; bit++) {
+      if (word & (1u << bit)) {
+        for (int i = 0; i < 4; i++) {
+          jumped[i] ^= state_[i];
+        }
+      }
+
+      Next();
+    }
+  }
+
+  for (int i = 0; i < 4; i++) {
+    state_[i] = jumped[i];
+  }
 }
 
-double GenerateRandomDouble() {
-  // Note: XorShift128 will never return 0. Subtracting 1 is an easy way
-  // to ensure this function will never return 1.0.
-  return static_cast<double>(Xorshift128() - 1) / UINT_MAX;
+RandomStream RandomStream::Split() {
+  RandomStream split = *this;
+  Jump();
+  return split;
 }
 
 }  // namespace stimulus
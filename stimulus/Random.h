@@ -17,19 +17,83 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RANDOM_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RANDOM_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 namespace stimulus {
 
-// The default libc random number generator is pretty crummy.
+// The default libc random number generator is pretty crummy. This is
+// xoshiro128** (http://prng.di.unimi.it/), which is small, fast, and can
+// jump ahead, so one seed can be split into streams that never overlap.
+//
+// Each task gets its own stream, and hands separate streams to the parts
+// that draw independently (like trial order and fixation times), so an
+// extra draw in one doesn't shift every later number in the others.
+class RandomStream {
+ public:
+  explicit RandomStream(uint64_t seed);
 
-void InitRandom(uint32_t seed);
+  // Streams for the same seed with different names are unrelated.
+  RandomStream(uint64_t seed, const std::string &name);
 
-// This will return min <= value < max.
-uint32_t GenerateRandomInt(uint32_t min, uint32_t max);
+  uint32_t Next() {
+    uint32_t result = Rotate(state_[1] * 5, 7) * 9;
+    uint32_t t = state_[1] << 9;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotate(state_[3], 11);
+    return result;
+  }
 
-// This will return  0 <= value < 1.0.
-double GenerateRandomDouble();
+  // This will return min <= value < max (or min, if they are equal),
+  // without the bias of scaling or taking a remainder.
+  uint32_t NextInt(uint32_t min, uint32_t max) {
+    return min + NextBelow(max - min);
+  }
+
+  // This will return 0 <= value < 1.0, with 53 random bits.
+  double NextDouble();
+
+  void Fill(uint32_t *values, size_t count);
+
+  // The same as count calls to NextInt.
+  void FillInts(uint32_t *values, size_t count, uint32_t min, uint32_t max);
+
+  // Advances the stream by 2^64 numbers.
+  void Jump();
+
+  // Returns a stream that continues from here, and jumps this one ahead,
+  // so the two never overlap.
+  RandomStream Split();
+
+ private:
+  static uint32_t Rotate(uint32_t x, int bits) {
+    return (x << bits) | (x >> (32 - bits));
+  }
+
+  // Lemire's method (https://arxiv.org/abs/1805.10941), which only needs
+  // a division in the rare case that a number might have to be redrawn.
+  uint32_t NextBelow(uint32_t range) {
+    uint64_t product = static_cast<uint64_t>(Next()) * range;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < range) {
+      // Numbers below this would make some results more likely than others.
+      uint32_t threshold = (0u - range) % range;
+      while (low < threshold) {
+        product = static_cast<uint64_t>(Next()) * range;
+        low = static_cast<uint32_t>(product);
+      }
+    }
+
+    return static_cast<uint32_t>(product >> 32);
+  }
+
+  uint32_t state_[4];
+};
 
 }  // namespace stimulus
 
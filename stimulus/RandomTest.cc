@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <vector>
 #include "Random.h"
 
@@ -19,11 +20,11 @@
 
 namespace {
 
-BOOST_AUTO_TEST_CASE(GenerateRandomInt) {
-  stimulus::InitRandom(time(nullptr));
+BOOST_AUTO_TEST_CASE(NextInt) {
+  stimulus::RandomStream random(1);
 
   const int kHistBuckets = 10;
-  const int kNumTrials = 100000;
+  const int kNumTrials = 1000000;
   const int kTarget = kNumTrials / kHistBuckets;
 
   // Ensure these don't differ by more than 2%
@@ -33,7 +34,7 @@ BOOST_AUTO_TEST_CASE(GenerateRandomInt) {
 
   memset(histogram, 0, sizeof(histogram));
   for (int i = 0; i < kNumTrials; i++) {
-    uint32_t value = stimulus::GenerateRandomInt(0, kHistBuckets);
+    uint32_t value = random.NextInt(0, kHistBuckets);
     BOOST_CHECK(value < kHistBuckets);
     histogram[value]++;
   }
@@ -43,6 +44,81 @@ BOOST_AUTO_TEST_CASE(GenerateRandomInt) {
     BOOST_CHECK(histogram[i] > kMinHist);
     BOOST_CHECK(histogram[i] < kMaxHist);
   }
+
+  BOOST_CHECK_EQUAL(random.NextInt(5, 5), 5);
+  BOOST_CHECK_EQUAL(random.NextInt(5, 6), 5);
+}
+
+// The published xoshiro128** algorithm, seeded with SplitMix64.
+BOOST_AUTO_TEST_CASE(KnownValues) {
+  const uint32_t kExpected[] = {0x650941ba, 0x54d30301, 0x25d2f321,
+                                0x3fabdca9};
+  const uint32_t kExpectedJumped[] = {0x4a2276b1, 0xd209907d};
+
+  stimulus::RandomStream random(1);
+  for (uint32_t expected : kExpected) {
+    BOOST_CHECK_EQUAL(random.Next(), expected);
+  }
+
+  stimulus::RandomStream jumped(1);
+  jumped.Jump();
+  for (uint32_t expected : kExpectedJumped) {
+    BOOST_CHECK_EQUAL(jumped.Next(), expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NextDouble) {
+  stimulus::RandomStream random(1);
+  double total = 0;
+  for (int i = 0; i < 10000; i++) {
+    double value = random.NextDouble();
+    BOOST_CHECK(value >= 0 && value < 1);
+    total += value;
+  }
+
+  BOOST_CHECK_CLOSE(total / 10000, 0.5, 2);
+}
+
+BOOST_AUTO_TEST_CASE(FillMatchesNext) {
+  const int kCount = 100;
+  stimulus::RandomStream random(3);
+  stimulus::RandomStream copy = random;
+  std::vector<uint32_t> values(kCount);
+  random.Fill(values.data(), kCount);
+  for (uint32_t value : values) {
+    BOOST_CHECK_EQUAL(value, copy.Next());
+  }
+
+  random.FillInts(values.data(), kCount, 10, 17);
+  for (uint32_t value : values) {
+    BOOST_CHECK_EQUAL(value, copy.NextInt(10, 17));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NamedStreams) {
+  stimulus::RandomStream first(7, "SSVEP");
+  stimulus::RandomStream same(7, "SSVEP");
+  stimulus::RandomStream other_name(7, "Oddball");
+  stimulus::RandomStream other_seed(8, "SSVEP");
+  uint32_t value = first.Next();
+  BOOST_CHECK_EQUAL(same.Next(), value);
+  BOOST_CHECK_NE(other_name.Next(), value);
+  BOOST_CHECK_NE(other_seed.Next(), value);
+}
+
+// A split stream continues where the original was, and the original moves
+// on to numbers the split one won't reach.
+BOOST_AUTO_TEST_CASE(Split) {
+  stimulus::RandomStream random(9);
+  stimulus::RandomStream copy = random;
+  stimulus::RandomStream split = random.Split();
+  for (int i = 0; i < 10; i++) {
+    BOOST_CHECK_EQUAL(split.Next(), copy.Next());
+  }
+
+  stimulus::RandomStream jumped(9);
+  jumped.Jump();
+  BOOST_CHECK_EQUAL(random.Next(), jumped.Next());
 }
 
 }  // namespace
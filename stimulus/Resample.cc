@@ -0,0 +1,157 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Resample.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace stimulus {
+namespace {
+
+const double kLanczosRadius = 2;
+const int kMaxChannels = 4;
+const int kBlockSize = 16;
+const double kPi = 3.14159265358979323846;
+
+double Lanczos(double x) {
+  x = std::fabs(x);
+  if (x < 1e-8) {
+    return 1;
+  } else if (x >= kLanczosRadius) {
+    return 0;
+  }
+
+  double pi_x = kPi * x;
+  return kLanczosRadius * std::sin(pi_x) * std::sin(pi_x / kLanczosRadius) /
+         (pi_x * pi_x);
+}
+
+// The source pixels that contribute to one destination pixel, and their
+// weights (which sum to 1).
+struct Contributions {
+  int first;
+  std::vector<float> weights;
+};
+
+std::vector<Contributions> ComputeContributions(int src_size,
+                                                int dest_size) {
+  double scale = static_cast<double>(src_size) / dest_size;
+  double filter_scale = std::max(scale, 1.0);
+  double support = kLanczosRadius * filter_scale;
+  std::vector<Contributions> result(dest_size);
+  for (int i = 0; i < dest_size; i++) {
+    // Pixel centers are at half integers.
+    double center = (i + 0.5) * scale - 0.5;
+    int first = static_cast<int>(std::floor(center - support)) + 1;
+    int last = static_cast<int>(std::floor(center + support));
+
+    // Samples past the edge are clamped to it, which is the same as adding
+    // their weight to the edge pixel.
+    Contributions &contributions = result[i];
+    contributions.first = std::max(first, 0);
+    int count = std::min(last, src_size - 1) - contributions.first + 1;
+    contributions.weights.assign(count, 0);
+    double total = 0;
+    for (int j = first; j <= last; j++) {
+      double weight = Lanczos((j - center) / filter_scale);
+      int index = std::min(std::max(j, 0), src_size - 1) -
+                  contributions.first;
+      contributions.weights[index] += weight;
+      total += weight;
+    }
+
+    for (float &weight : contributions.weights) {
+      weight /= total;
+    }
+  }
+
+  return result;
+}
+
+// The horizontal pass over one row. Knowing the number of channels at
+// compile time lets the compiler keep the sums in registers.
+template <int kChannels>
+void ResampleRow(const float *in, const std::vector<Contributions> &columns,
+                 uint8_t *out, int channels = kChannels) {
+  for (const Contributions &column : columns) {
+    float sums[kChannels] = {};
+    const float *pixel = in + column.first * channels;
+    for (float weight : column.weights) {
+      for (int c = 0; c < kChannels && c < channels; c++) {
+        sums[c] += weight * pixel[c];
+      }
+
+      pixel += channels;
+    }
+
+    // Lanczos has negative lobes, so values can overshoot.
+    for (int c = 0; c < kChannels && c < channels; c++) {
+      *out++ = static_cast<uint8_t>(
+          std::min(std::max(sums[c] + 0.5f, 0.0f), 255.0f));
+    }
+  }
+}
+
+}  // namespace
+
+void ResampleImage(const uint8_t *src, int src_width, int src_height,
+                   int src_pitch, uint8_t *dest, int dest_width,
+                   int dest_height, int dest_pitch, int channels) {
+  std::vector<Contributions> rows = ComputeContributions(src_height,
+                                                         dest_height);
+  std::vector<Contributions> columns = ComputeContributions(src_width,
+                                                            dest_width);
+
+  // The vertical pass goes first, since it works on whole rows and leaves
+  // fewer rows for the horizontal pass. Rows are processed in fixed size
+  // blocks, which the compiler vectorizes even without -O3.
+  int src_row_size = src_width * channels;
+  std::vector<float> vertical(src_row_size);
+  for (int y = 0; y < dest_height; y++) {
+    const Contributions &row = rows[y];
+    std::fill(vertical.begin(), vertical.end(), 0.0f);
+    float *sums = vertical.data();
+    for (size_t k = 0; k < row.weights.size(); k++) {
+      const uint8_t *in = src + (row.first + k) * src_pitch;
+      float weight = row.weights[k];
+      int x = 0;
+      for (; x + kBlockSize <= src_row_size; x += kBlockSize) {
+        for (int i = 0; i < kBlockSize; i++) {
+          sums[x + i] += weight * in[x + i];
+        }
+      }
+
+      for (; x < src_row_size; x++) {
+        sums[x] += weight * in[x];
+      }
+    }
+
+    uint8_t *out = dest + static_cast<size_t>(y) * dest_pitch;
+    switch (channels) {
+      case 1:
+        ResampleRow<1>(vertical.data(), columns, out);
+        break;
+      case 3:
+        ResampleRow<3>(vertical.data(), columns, out);
+        break;
+      default:
+        ResampleRow<kMaxChannels>(vertical.data(), columns, out, channels);
+        break;
+    }
+  }
+}
+
+}  // namespace stimulus
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RESAMPLE_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RESAMPLE_H_
+
+#include <cstdint>
+
+namespace stimulus {
+
+// Resizes an image with interleaved 8 bit channels (e.g. 3 for RGB24, 1 for
+// a single plane) using a separable Lanczos-2 filter. When shrinking, the
+// filter is widened by the scale factor so every source pixel contributes
+// and fine detail doesn't alias. Pitches are in bytes.
+void ResampleImage(const uint8_t *src, int src_width, int src_height,
+                   int src_pitch, uint8_t *dest, int dest_width,
+                   int dest_height, int dest_pitch, int channels);
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RESAMPLE_H_
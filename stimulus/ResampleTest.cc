@@ -0,0 +1,119 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "Resample.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int kChannels = 3;
+
+// Solid colors must come through exactly, including at the edges.
+BOOST_AUTO_TEST_CASE(ResampleSolidColor) {
+  const int kSrcWidth = 101;
+  const int kSrcHeight = 77;
+  const int kDestWidth = 54;
+  const int kDestHeight = 41;
+  const uint8_t kColor[kChannels] = { 12, 200, 255 };
+
+  std::vector<uint8_t> src(kSrcWidth * kSrcHeight * kChannels);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = kColor[i % kChannels];
+  }
+
+  std::vector<uint8_t> dest(kDestWidth * kDestHeight * kChannels);
+  stimulus::ResampleImage(src.data(), kSrcWidth, kSrcHeight,
+                          kSrcWidth * kChannels, dest.data(), kDestWidth,
+                          kDestHeight, kDestWidth * kChannels, kChannels);
+  for (size_t i = 0; i < dest.size(); i++) {
+    BOOST_CHECK_EQUAL(dest[i], kColor[i % kChannels]);
+  }
+}
+
+// Resampling to the same size leaves the image unchanged.
+BOOST_AUTO_TEST_CASE(ResampleSameSize) {
+  const int kWidth = 16;
+  const int kHeight = 9;
+
+  std::vector<uint8_t> src(kWidth * kHeight);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = static_cast<uint8_t>(i * 37);
+  }
+
+  std::vector<uint8_t> dest(src.size());
+  stimulus::ResampleImage(src.data(), kWidth, kHeight, kWidth, dest.data(),
+                          kWidth, kHeight, kWidth, 1);
+  BOOST_CHECK(dest == src);
+}
+
+// Shrinking a one pixel checkerboard must average it to gray rather than
+// aliasing to stripes.
+BOOST_AUTO_TEST_CASE(ResampleNoAliasing) {
+  const int kSrcSize = 64;
+  const int kDestSize = 27;
+  const int kMaxError = 8;
+
+  std::vector<uint8_t> src(kSrcSize * kSrcSize);
+  for (int y = 0; y < kSrcSize; y++) {
+    for (int x = 0; x < kSrcSize; x++) {
+      src[y * kSrcSize + x] = ((x + y) % 2) ? 255 : 0;
+    }
+  }
+
+  std::vector<uint8_t> dest(kDestSize * kDestSize);
+  stimulus::ResampleImage(src.data(), kSrcSize, kSrcSize, kSrcSize,
+                          dest.data(), kDestSize, kDestSize, kDestSize, 1);
+
+  // Skip the border, where clamping makes the pattern asymmetric.
+  for (int y = 3; y < kDestSize - 3; y++) {
+    for (int x = 3; x < kDestSize - 3; x++) {
+      BOOST_CHECK_LE(std::abs(dest[y * kDestSize + x] - 128), kMaxError);
+    }
+  }
+}
+
+// Pitches may include padding, which must not be read or written.
+BOOST_AUTO_TEST_CASE(ResamplePitch) {
+  const int kSrcWidth = 10;
+  const int kSrcHeight = 10;
+  const int kSrcPitch = 40;
+  const int kDestWidth = 5;
+  const int kDestHeight = 5;
+  const int kDestPitch = 20;
+  const uint8_t kPadding = 0xaa;
+
+  std::vector<uint8_t> src(kSrcHeight * kSrcPitch, kPadding);
+  for (int y = 0; y < kSrcHeight; y++) {
+    for (int x = 0; x < kSrcWidth * kChannels; x++) {
+      src[y * kSrcPitch + x] = 10;
+    }
+  }
+
+  std::vector<uint8_t> dest(kDestHeight * kDestPitch, kPadding);
+  stimulus::ResampleImage(src.data(), kSrcWidth, kSrcHeight, kSrcPitch,
+                          dest.data(), kDestWidth, kDestHeight, kDestPitch,
+                          kChannels);
+  for (int y = 0; y < kDestHeight; y++) {
+    for (int x = 0; x < kDestPitch; x++) {
+      BOOST_CHECK_EQUAL(dest[y * kDestPitch + x],
+                        x < kDestWidth * kChannels ? 10 : kPadding);
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,161 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ResourcePack.h"
+
+#include <cstring>
+
+namespace stimulus {
+namespace {
+
+const char kMagic[] = "AMBRPACK";
+const size_t kMagicLength = sizeof(kMagic) - 1;
+const size_t kAlignment = 16;
+
+void AppendInt(std::string *out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out->push_back(static_cast<char>(value >> (i * 8)));
+  }
+}
+
+// Reads an integer at *offset and advances it. Returns false if it would
+// read past the end.
+bool ReadInt(const uint8_t *data, size_t size, size_t *offset, int bytes,
+             uint64_t *value) {
+  if (size - *offset < static_cast<size_t>(bytes)) {
+    return false;
+  }
+
+  *value = 0;
+  for (int i = 0; i < bytes; i++) {
+    *value |= static_cast<uint64_t>(data[*offset + i]) << (i * 8);
+  }
+
+  *offset += bytes;
+  return true;
+}
+
+// Drops empty path components, so "a//b" and "/a/b" both become "a/b".
+std::string NormalizeName(const std::string &name) {
+  std::string result;
+  for (char c : name) {
+    if (c == '/' || c == '\\') {
+      if (!result.empty() && result.back() != '/') {
+        result.push_back('/');
+      }
+    } else {
+      result.push_back(c);
+    }
+  }
+
+  if (!result.empty() && result.back() == '/') {
+    result.pop_back();
+  }
+
+  return result;
+}
+
+}  // namespace
+
+std::string ResourcePack::Build(
+    const std::vector<std::pair<std::string, std::string>> &files) {
+  std::string index(kMagic, kMagicLength);
+  AppendInt(&index, files.size(), 4);
+  size_t index_size = index.size();
+  for (const auto &file : files) {
+    index_size += 4 + NormalizeName(file.first).size() + 8 + 8;
+  }
+
+  std::string data;
+  for (const auto &file : files) {
+    size_t offset = index_size + data.size();
+    size_t padding = (kAlignment - offset % kAlignment) % kAlignment;
+    data.append(padding, '\0');
+    std::string name = NormalizeName(file.first);
+    AppendInt(&index, name.size(), 4);
+    index += name;
+    AppendInt(&index, offset + padding, 8);
+    AppendInt(&index, file.second.size(), 8);
+    data += file.second;
+  }
+
+  return index + data;
+}
+
+bool ResourcePack::Parse(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  resources_.clear();
+  if (size < kMagicLength || memcmp(bytes, kMagic, kMagicLength) != 0) {
+    return false;
+  }
+
+  size_t offset = kMagicLength;
+  uint64_t count;
+  if (!ReadInt(bytes, size, &offset, 4, &count)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t name_length;
+    uint64_t file_offset;
+    uint64_t file_size;
+    if (!ReadInt(bytes, size, &offset, 4, &name_length) ||
+        size - offset < name_length) {
+      resources_.clear();
+      return false;
+    }
+
+    std::string name(reinterpret_cast<const char *>(bytes + offset),
+                     name_length);
+    offset += name_length;
+    if (!ReadInt(bytes, size, &offset, 8, &file_offset) ||
+        !ReadInt(bytes, size, &offset, 8, &file_size) ||
+        file_offset > size || size - file_offset < file_size) {
+      resources_.clear();
+      return false;
+    }
+
+    resources_[name] = std::make_pair(bytes + file_offset, file_size);
+  }
+
+  return true;
+}
+
+bool ResourcePack::Find(const std::string &name, const uint8_t **data,
+                        size_t *size) const {
+  auto it = resources_.find(NormalizeName(name));
+  if (it == resources_.end()) {
+    return false;
+  }
+
+  *data = it->second.first;
+  *size = it->second.second;
+  return true;
+}
+
+std::vector<std::string> ResourcePack::GetNames() const {
+  std::vector<std::string> names;
+  names.reserve(resources_.size());
+  for (const auto &resource : resources_) {
+    names.push_back(resource.first);
+  }
+
+  return names;
+}
+
+void ResourcePack::Remove(const std::string &name) {
+  resources_.erase(NormalizeName(name));
+}
+
+}  // namespace stimulus
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RESOURCEPACK_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RESOURCEPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stimulus {
+
+// The resources directory packed into a single file, so it can be mapped
+// once at startup instead of opening hundreds of files one at a time.
+// The layout is (with integers little endian):
+//
+//   "AMBRPACK"
+//   uint32 count
+//   count entries of: uint32 name_length, name, uint64 offset, uint64 size
+//   the file contents, each starting on a 16 byte boundary
+//
+// Names are relative to the resources directory, with '/' separators.
+class ResourcePack {
+ public:
+  // Returns the pack file contents for (name, contents) pairs.
+  static std::string Build(
+      const std::vector<std::pair<std::string, std::string>> &files);
+
+  // Indexes a pack in memory, which must outlive this object. Returns
+  // false if it isn't a valid pack.
+  bool Parse(const void *data, size_t size);
+
+  // Returns false if the pack doesn't contain name. Redundant separators
+  // in name are ignored, so paths can be built by concatenation.
+  bool Find(const std::string &name, const uint8_t **data,
+            size_t *size) const;
+
+  size_t GetNumResources() const {
+    return resources_.size();
+  }
+
+  // The names of everything in the pack, with redundant separators removed.
+  std::vector<std::string> GetNames() const;
+
+  // Leaves name out of later lookups, so it's loaded from the directory.
+  void Remove(const std::string &name);
+
+ private:
+  std::unordered_map<std::string, std::pair<const uint8_t *, size_t>>
+      resources_;
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_RESOURCEPACK_H_
@@ -0,0 +1,98 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ResourcePack.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+std::string ToString(const uint8_t *data, size_t size) {
+  return std::string(reinterpret_cast<const char *>(data), size);
+}
+
+BOOST_AUTO_TEST_CASE(PackFindsFiles) {
+  std::string pack = stimulus::ResourcePack::Build({
+      {"font.svg", "<svg/>"},
+      {"ssvep/pleasant/1_pleasant.jpg", std::string("\xff\xd8\0\xff", 4)},
+      {"empty.txt", ""}});
+  stimulus::ResourcePack resources;
+  BOOST_REQUIRE(resources.Parse(pack.data(), pack.size()));
+  BOOST_CHECK_EQUAL(resources.GetNumResources(), 3);
+
+  const uint8_t *data;
+  size_t size;
+  BOOST_REQUIRE(resources.Find("font.svg", &data, &size));
+  BOOST_CHECK_EQUAL(ToString(data, size), "<svg/>");
+  BOOST_REQUIRE(resources.Find("ssvep/pleasant/1_pleasant.jpg", &data,
+                               &size));
+  BOOST_CHECK_EQUAL(ToString(data, size), std::string("\xff\xd8\0\xff", 4));
+  BOOST_CHECK_EQUAL((data - reinterpret_cast<const uint8_t *>(pack.data()))
+                    % 16, 0);
+  BOOST_REQUIRE(resources.Find("empty.txt", &data, &size));
+  BOOST_CHECK_EQUAL(size, 0);
+  BOOST_CHECK(!resources.Find("missing.svg", &data, &size));
+}
+
+// Callers build paths like GetResourceDir() + "/emotional_images/".
+BOOST_AUTO_TEST_CASE(PackIgnoresExtraSeparators) {
+  std::string pack = stimulus::ResourcePack::Build({
+      {"emotional_images/neutral_people/1_neutppl.jpg", "jpeg"}});
+  stimulus::ResourcePack resources;
+  BOOST_REQUIRE(resources.Parse(pack.data(), pack.size()));
+
+  const uint8_t *data;
+  size_t size;
+  BOOST_CHECK(resources.Find("/emotional_images//neutral_people/1_neutppl.jpg",
+                             &data, &size));
+  BOOST_CHECK(resources.Find("emotional_images\\neutral_people\\1_neutppl.jpg",
+                             &data, &size));
+}
+
+// Files edited since the pack was built are removed, so they're loaded from
+// the directory.
+BOOST_AUTO_TEST_CASE(PackRemovesFiles) {
+  std::string pack = stimulus::ResourcePack::Build({
+      {"dot.bmp", "dot"}, {"/ssvep//1.jpg", "jpeg"}});
+  stimulus::ResourcePack resources;
+  BOOST_REQUIRE(resources.Parse(pack.data(), pack.size()));
+  std::vector<std::string> names = resources.GetNames();
+  std::sort(names.begin(), names.end());
+  BOOST_CHECK(names == std::vector<std::string>({"dot.bmp", "ssvep/1.jpg"}));
+
+  resources.Remove("ssvep/1.jpg");
+  const uint8_t *data;
+  size_t size;
+  BOOST_CHECK(!resources.Find("ssvep/1.jpg", &data, &size));
+  BOOST_CHECK(resources.Find("dot.bmp", &data, &size));
+  BOOST_CHECK_EQUAL(resources.GetNumResources(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(PackRejectsBadData) {
+  std::string pack = stimulus::ResourcePack::Build({{"a.bmp", "bitmap"}});
+  stimulus::ResourcePack resources;
+  BOOST_CHECK(!resources.Parse("not a pack", 10));
+
+  // Every truncation cuts off either the index or a file's contents.
+  for (size_t size = 0; size < pack.size(); size++) {
+    BOOST_CHECK(!resources.Parse(pack.data(), size));
+    BOOST_CHECK_EQUAL(resources.GetNumResources(), 0);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,227 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Schedule.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace stimulus {
+namespace {
+
+const char kMagic[] = "AMBRPLAN";
+const size_t kMagicLength = sizeof(kMagic) - 1;
+const uint32_t kVersion = 1;
+
+void AppendInt(std::string *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out->push_back(static_cast<char>(value >> (i * 8)));
+  }
+}
+
+void AppendInts(std::string *out, const std::vector<int> &values) {
+  AppendInt(out, values.size());
+  for (int value : values) {
+    AppendInt(out, static_cast<uint32_t>(value));
+  }
+}
+
+// Reads an integer at *offset and advances it. Returns false if it would
+// read past the end.
+bool ReadInt(const uint8_t *data, size_t size, size_t *offset,
+             uint32_t *value) {
+  if (size - *offset < 4) {
+    return false;
+  }
+
+  *value = 0;
+  for (int i = 0; i < 4; i++) {
+    *value |= static_cast<uint32_t>(data[*offset + i]) << (i * 8);
+  }
+
+  *offset += 4;
+  return true;
+}
+
+bool ReadInt(const uint8_t *data, size_t size, size_t *offset, int *value) {
+  uint32_t unsigned_value;
+  if (!ReadInt(data, size, offset, &unsigned_value)) {
+    return false;
+  }
+
+  *value = static_cast<int32_t>(unsigned_value);
+  return true;
+}
+
+bool ReadInts(const uint8_t *data, size_t size, size_t *offset,
+              std::vector<int> *values) {
+  uint32_t count;
+  if (!ReadInt(data, size, offset, &count) || (size - *offset) / 4 < count) {
+    return false;
+  }
+
+  values->resize(count);
+  for (int &value : *values) {
+    ReadInt(data, size, offset, &value);
+  }
+
+  return true;
+}
+
+void WriteJsonInts(std::ostream &out, const std::vector<int> &values) {
+  out << "[";
+  for (size_t i = 0; i < values.size(); i++) {
+    out << (i == 0 ? "" : ", ") << values[i];
+  }
+
+  out << "]";
+}
+
+}  // namespace
+
+const TaskSchedule *Schedule::FindTask(const std::string &name) const {
+  for (const TaskSchedule &task : tasks) {
+    if (task.task == name) {
+      return &task;
+    }
+  }
+
+  return nullptr;
+}
+
+std::string SerializeSchedule(const Schedule &schedule) {
+  std::string out(kMagic, kMagicLength);
+  AppendInt(&out, kVersion);
+  AppendInt(&out, schedule.seed);
+  AppendInt(&out, schedule.tasks.size());
+  for (const TaskSchedule &task : schedule.tasks) {
+    AppendInt(&out, task.task.size());
+    out += task.task;
+    AppendInt(&out, task.trials.size());
+    for (const ScheduledTrial &trial : task.trials) {
+      AppendInt(&out, static_cast<uint32_t>(trial.condition));
+      AppendInt(&out, static_cast<uint32_t>(trial.fixation_ms));
+      AppendInts(&out, trial.stimuli);
+      AppendInts(&out, trial.marks);
+    }
+  }
+
+  return out;
+}
+
+bool ParseSchedule(const void *data, size_t size, Schedule *schedule) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  Schedule result;
+  *schedule = Schedule();
+  if (size < kMagicLength || memcmp(bytes, kMagic, kMagicLength) != 0) {
+    return false;
+  }
+
+  size_t offset = kMagicLength;
+  uint32_t version;
+  uint32_t task_count;
+  if (!ReadInt(bytes, size, &offset, &version) || version != kVersion ||
+      !ReadInt(bytes, size, &offset, &result.seed) ||
+      !ReadInt(bytes, size, &offset, &task_count)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < task_count; i++) {
+    TaskSchedule task;
+    uint32_t name_length;
+    uint32_t trial_count;
+    if (!ReadInt(bytes, size, &offset, &name_length) ||
+        size - offset < name_length) {
+      return false;
+    }
+
+    task.task.assign(reinterpret_cast<const char *>(bytes + offset),
+                     name_length);
+    offset += name_length;
+    if (!ReadInt(bytes, size, &offset, &trial_count)) {
+      return false;
+    }
+
+    for (uint32_t j = 0; j < trial_count; j++) {
+      ScheduledTrial trial;
+      if (!ReadInt(bytes, size, &offset, &trial.condition) ||
+          !ReadInt(bytes, size, &offset, &trial.fixation_ms) ||
+          !ReadInts(bytes, size, &offset, &trial.stimuli) ||
+          !ReadInts(bytes, size, &offset, &trial.marks)) {
+        return false;
+      }
+
+      task.trials.push_back(std::move(trial));
+    }
+
+    result.tasks.push_back(std::move(task));
+  }
+
+  if (offset != size) {
+    return false;
+  }
+
+  *schedule = std::move(result);
+  return true;
+}
+
+bool LoadSchedule(const std::string &path, Schedule *schedule,
+                  std::string *error) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    *error = "Could not open schedule " + path;
+    return false;
+  }
+
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  if (!ParseSchedule(data.data(), data.size(), schedule)) {
+    *error = path + " is not a valid schedule";
+    return false;
+  }
+
+  return true;
+}
+
+std::string ScheduleToJson(const Schedule &schedule) {
+  std::ostringstream out;
+  out << "{\n";
+  out << "  \"file_type\": \"schedule\",\n";
+  out << "  \"seed\": " << schedule.seed << ",\n";
+  out << "  \"tasks\": [";
+  for (size_t i = 0; i < schedule.tasks.size(); i++) {
+    const TaskSchedule &task = schedule.tasks[i];
+    out << (i == 0 ? "\n" : ",\n") << "    {\"task\": \"" << task.task
+        << "\", \"trials\": [";
+    for (size_t j = 0; j < task.trials.size(); j++) {
+      const ScheduledTrial &trial = task.trials[j];
+      out << (j == 0 ? "\n" : ",\n") << "      {\"condition\": "
+          << trial.condition << ", \"fixation_ms\": " << trial.fixation_ms
+          << ", \"stimuli\": ";
+      WriteJsonInts(out, trial.stimuli);
+      out << ", \"marks\": ";
+      WriteJsonInts(out, trial.marks);
+      out << "}";
+    }
+
+    out << "\n    ]}";
+  }
+
+  out << "\n  ]\n}\n";
+  return out.str();
+}
+
+}  // namespace stimulus
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SCHEDULE_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SCHEDULE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stimulus {
+
+struct ScheduledTrial {
+  // What the task shows, usually the condition's mark.
+  int condition = 0;
+
+  // How long the fixation before the trial is shown.
+  int fixation_ms = 0;
+
+  // Stimulus IDs (their marks), in the order they are shown.
+  std::vector<int> stimuli;
+
+  // The marks the trial should send, in order.
+  std::vector<int> marks;
+};
+
+struct TaskSchedule {
+  std::string task;
+  std::vector<ScheduledTrial> trials;
+};
+
+// Every trial of a session, drawn ahead of time from one seed, so that a
+// task steps through a list instead of shuffling while it runs. Schedules
+// are saved as (with integers little endian):
+//
+//   "AMBRPLAN"
+//   uint32 version, uint32 seed, uint32 task_count
+//   task_count tasks of: uint32 name_length, name, uint32 trial_count
+//     trial_count trials of: int32 condition, int32 fixation_ms,
+//       uint32 stimulus_count, stimulus_count int32 stimuli,
+//       uint32 mark_count, mark_count int32 marks
+struct Schedule {
+  uint32_t seed = 0;
+  std::vector<TaskSchedule> tasks;
+
+  // Returns nullptr if the schedule doesn't include the task.
+  const TaskSchedule *FindTask(const std::string &name) const;
+};
+
+std::string SerializeSchedule(const Schedule &schedule);
+
+// Returns false if data isn't a valid schedule.
+bool ParseSchedule(const void *data, size_t size, Schedule *schedule);
+
+// Returns false, with a message in error, if the file can't be read.
+bool LoadSchedule(const std::string &path, Schedule *schedule,
+                  std::string *error);
+
+// The same schedule in a form that is easier to read.
+std::string ScheduleToJson(const Schedule &schedule);
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SCHEDULE_H_
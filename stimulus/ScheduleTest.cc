@@ -0,0 +1,97 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include "Schedule.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+stimulus::Schedule MakeSchedule() {
+  stimulus::Schedule schedule;
+  schedule.seed = 1234;
+
+  stimulus::TaskSchedule ssvep;
+  ssvep.task = "SSVEP";
+  stimulus::ScheduledTrial trial;
+  trial.condition = 3;
+  trial.fixation_ms = 2734;
+  trial.stimuli = {1004, 2017};
+  trial.marks = {3, 1004, 2017, 888};
+  ssvep.trials.push_back(trial);
+  schedule.tasks.push_back(ssvep);
+
+  stimulus::TaskSchedule oddball;
+  oddball.task = "Oddball";
+  trial = stimulus::ScheduledTrial();
+  trial.condition = 2;
+  trial.fixation_ms = 712;
+  trial.marks = {999, 2, 777};
+  oddball.trials.push_back(trial);
+  schedule.tasks.push_back(oddball);
+  return schedule;
+}
+
+BOOST_AUTO_TEST_CASE(ScheduleRoundTrips) {
+  std::string data = stimulus::SerializeSchedule(MakeSchedule());
+  stimulus::Schedule schedule;
+  BOOST_REQUIRE(stimulus::ParseSchedule(data.data(), data.size(), &schedule));
+  BOOST_CHECK_EQUAL(schedule.seed, 1234);
+  BOOST_REQUIRE_EQUAL(schedule.tasks.size(), 2);
+  BOOST_CHECK(schedule.FindTask("Flankers") == nullptr);
+
+  const stimulus::TaskSchedule *ssvep = schedule.FindTask("SSVEP");
+  BOOST_REQUIRE(ssvep != nullptr);
+  BOOST_REQUIRE_EQUAL(ssvep->trials.size(), 1);
+  const stimulus::ScheduledTrial &trial = ssvep->trials[0];
+  BOOST_CHECK_EQUAL(trial.condition, 3);
+  BOOST_CHECK_EQUAL(trial.fixation_ms, 2734);
+  BOOST_CHECK(trial.stimuli == std::vector<int>({1004, 2017}));
+  BOOST_CHECK(trial.marks == std::vector<int>({3, 1004, 2017, 888}));
+
+  const stimulus::TaskSchedule *oddball = schedule.FindTask("Oddball");
+  BOOST_REQUIRE(oddball != nullptr);
+  BOOST_REQUIRE_EQUAL(oddball->trials.size(), 1);
+  BOOST_CHECK(oddball->trials[0].stimuli.empty());
+  BOOST_CHECK(oddball->trials[0].marks == std::vector<int>({999, 2, 777}));
+}
+
+BOOST_AUTO_TEST_CASE(ScheduleRejectsBadData) {
+  std::string data = stimulus::SerializeSchedule(MakeSchedule());
+  stimulus::Schedule schedule;
+  BOOST_CHECK(!stimulus::ParseSchedule("not a schedule", 14, &schedule));
+
+  for (size_t size = 0; size < data.size(); size++) {
+    BOOST_CHECK(!stimulus::ParseSchedule(data.data(), size, &schedule));
+    BOOST_CHECK(schedule.tasks.empty());
+  }
+
+  // Trailing data means the lengths are wrong.
+  std::string extra = data + '\0';
+  BOOST_CHECK(!stimulus::ParseSchedule(extra.data(), extra.size(),
+                                       &schedule));
+}
+
+BOOST_AUTO_TEST_CASE(ScheduleJson) {
+  std::string json = stimulus::ScheduleToJson(MakeSchedule());
+  BOOST_CHECK(json.find("\"seed\": 1234") != std::string::npos);
+  BOOST_CHECK(json.find("{\"condition\": 3, \"fixation_ms\": 2734, "
+                        "\"stimuli\": [1004, 2017], "
+                        "\"marks\": [3, 1004, 2017, 888]}") !=
+              std::string::npos);
+}
+
+}  // namespace
@@ -14,14 +14,27 @@
 
 #include "Screen.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <vector>
 
+#include "Clock.h"
 #include "Image.h"
+#include "InputScript.h"
 #include "Platform.h"
-#include "Util.h"
+#include "StartupProfile.h"
+#include "Trace.h"
 
 namespace stimulus {
 namespace {
+const std::type_info *GetScreenType(Screen *screen) {
+  return screen != nullptr ? &typeid(*screen) : nullptr;
+}
+
 void ReportSdlError(const std::string &call) {
   Screen::FatalError(call + " error: " + SDL_GetError());
 }
@@ -30,14 +43,119 @@ const int kGlyphWidth = 60;
 const char kLowestGlyph = '!';
 const char kHighestGlyph = '~';
 
+// Number of frames presented when measuring the refresh period. The first
+// few are discarded, since the swap chain may still be filling.
+const int kRefreshMeasureFrames = 300;
+const int kRefreshWarmupFrames = 10;
+const int64_t kDefaultFramePeriodUs = kMicrosPerSecond / 60;
+
+const int64_t kNever = std::numeric_limits<int64_t>::max();
+
+// Swap depth assumed when the display can't be calibrated. This matches the
+// double buffering of most drivers.
+const int kDefaultSwapDepth = 2;
+const int kMaxSwapDepth = 4;
+const int kSwapDepthTrials = 7;
+
+// Frames waited before each swap depth trial so the queue is empty. The
+// extra half frame starts the burst between vsyncs, so a present that blocks
+// isn't mistaken for a queued one.
+const double kSwapDepthDrainFrames = 4.5;
+
+// A present that returns within this fraction of a frame didn't wait for
+// vsync, so the frame went into a free slot in the queue.
+const int64_t kQueuedPresentFraction = 4;
+
+// Present a burst of frames after letting the queue drain, and count how
+// many are accepted before the renderer blocks.
+int MeasureSwapDepth(SDL_Renderer *renderer, int64_t frame_period_us) {
+  SDL_Delay(static_cast<Uint32>(kSwapDepthDrainFrames * frame_period_us /
+                                kMicrosPerMs));
+  int64_t last_present = GetTimeMicros();
+  int queued = 0;
+  while (queued < kMaxSwapDepth - 1) {
+    SDL_RenderClear(renderer);
+    SDL_RenderPresent(renderer);
+    int64_t now = GetTimeMicros();
+    if (now - last_present > frame_period_us / kQueuedPresentFraction) {
+      break;
+    }
+
+    queued += 1;
+    last_present = now;
+  }
+
+  // Let the frames finish so the next trial starts from an empty queue.
+  for (int i = 0; i < kMaxSwapDepth; i++) {
+    SDL_RenderClear(renderer);
+    SDL_RenderPresent(renderer);
+  }
+
+  return queued + 1;
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+// Glyph quads for a string at one position and scale, built the first time
+// the string is drawn so that later frames draw it with a single call.
+struct TextMesh {
+  std::string str;
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices;
+};
+
+struct TextKey {
+  int left;
+  int top;
+  float font_scale;
+  size_t str_hash;
+
+  bool operator==(const TextKey &other) const {
+    return left == other.left && top == other.top &&
+           font_scale == other.font_scale && str_hash == other.str_hash;
+  }
+};
+
+struct TextKeyHash {
+  size_t operator()(const TextKey &key) const {
+    size_t hash = key.str_hash;
+    hash = hash * 31 + std::hash<int>()(key.left);
+    hash = hash * 31 + std::hash<int>()(key.top);
+    return hash * 31 + std::hash<float>()(key.font_scale);
+  }
+};
+
+// Screens draw a fixed set of strings, so this stays small. The limit is
+// in case a screen draws an ever-changing string (e.g. a timer).
+const size_t kMaxTextMeshes = 4096;
+
+std::unordered_map<TextKey, TextMesh, TextKeyHash> text_meshes;
+#endif
+
+// A duration within this fraction of a frame of a whole number of frames is
+// considered to be a multiple of the frame period.
+const double kFrameMultipleTolerance = 0.05;
+
 }  // namespace
 
 Screen *Screen::previous_screen_;
 Screen *Screen::current_screen_;
 Screen *Screen::next_screen_;
 SDL_Renderer *Screen::renderer_;
-int Screen::next_screen_presentation_time_;
+int64_t Screen::next_screen_presentation_time_;
+int64_t Screen::next_screen_presentation_frame_;
+int64_t Screen::frame_count_;
+int64_t Screen::frame_period_us_ = kDefaultFramePeriodUs;
+bool Screen::frame_scheduling_;
 int Screen::presentation_countdown_;
+int64_t Screen::activation_present_time_ = -1;
+int64_t Screen::flip_time_ = -1;
+bool Screen::photon_timing_ = true;
+Screen::DisplayCalibration Screen::display_calibration_ = {
+    false, kDefaultFramePeriodUs, 0, 0, kDefaultSwapDepth, 0.0f};
+InputScript *Screen::input_script_;
+int64_t Screen::render_wakeup_time_ = kNever;
+PresentationAudit Screen::presentation_audit_;
+int Screen::onset_presentation_ = -1;
 int Screen::display_width_px_;
 int Screen::display_height_px_;
 float Screen::pixel_ratio_;
@@ -45,6 +163,10 @@ SDL_Window *Screen::window_;
 float Screen::horz_pixels_per_cm_;
 float Screen::vert_pixels_per_cm_;
 SDL_Texture *Screen::font_atlas_;
+int Screen::font_atlas_width_;
+int Screen::draw_calls_;
+SDL_Texture *Screen::static_cache_;
+Screen *Screen::static_cache_owner_;
 float Screen::font_scale_;
 int Screen::glyph_height_;
 bool Screen::enable_sdl_error_dialog_;
@@ -52,15 +174,151 @@ bool Screen::enable_sdl_error_dialog_;
 SDL_Renderer *Screen::GetRenderer() { return renderer_; }
 
 void Screen::FatalError(const std::string &error) {
-  SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Error", error.c_str(),
-                           nullptr);
+  if (IsHeadless()) {
+    SDL_Log("Fatal error: %s\n", error.c_str());
+  } else {
+    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Error",
+                             error.c_str(), nullptr);
+  }
+
   exit(1);
 }
 
+void Screen::SetHeadless(InputScript *script) {
+  input_script_ = script;
+  UseVirtualClock();
+}
+
+void Screen::ScheduleRender(int64_t time_us) {
+  render_wakeup_time_ = std::min(render_wakeup_time_, time_us);
+}
+
 void Screen::SwitchToScreen(int successor_num, int delay_ms) {
   assert((unsigned int)successor_num < successors_.size());
   next_screen_ = successors_[successor_num];
-  next_screen_presentation_time_ = SDL_GetTicks() + delay_ms - 1;
+  next_screen_presentation_time_ = GetTimeMicros() + MsToMicros(delay_ms - 1);
+
+  // The delay counts from this screen's onset if it isn't visible yet. The
+  // successor becomes visible a few presents after it is activated, so it
+  // is activated that much early for the onsets to be delay_ms apart.
+  next_screen_presentation_frame_ = frame_count_ + presentation_countdown_ +
+      DurationToFrames(delay_ms) - GetPresentsUntilVisible();
+  presentation_audit_.SetNominalDuration(delay_ms);
+}
+
+int Screen::GetPresentsUntilVisible() {
+  return IsPhotonTimingEnabled() ? display_calibration_.swap_depth
+                                 : kDefaultSwapDepth;
+}
+
+int Screen::DurationToFrames(int duration_ms) {
+  return static_cast<int>(std::lround(static_cast<double>(
+      MsToMicros(duration_ms)) / frame_period_us_));
+}
+
+void Screen::WarnIfNotFrameMultiple(const std::string &name, int duration_ms) {
+  double frames = static_cast<double>(MsToMicros(duration_ms)) /
+                  frame_period_us_;
+  if (std::fabs(frames - std::round(frames)) > kFrameMultipleTolerance) {
+    SDL_Log("Warning: %s (%d ms) is not a multiple of the frame period "
+            "(%.3f ms). It will be shown for %d frames (%.3f ms)\n",
+            name.c_str(), duration_ms,
+            static_cast<double>(frame_period_us_) / kMicrosPerMs,
+            DurationToFrames(duration_ms),
+            static_cast<double>(DurationToFrames(duration_ms) *
+                                frame_period_us_) / kMicrosPerMs);
+  }
+}
+
+void Screen::CalibrateDisplay() {
+  SDL_DisplayMode mode;
+  if (SDL_GetWindowDisplayMode(window_, &mode) == 0 && mode.refresh_rate > 0) {
+    frame_period_us_ = kMicrosPerSecond / mode.refresh_rate;
+  }
+
+  // The reported mode is only an integer number of Hz (and is sometimes
+  // wrong), so time some presents to find the real period.
+  SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 0xff);
+  std::vector<int64_t> intervals;
+  int64_t last_present = 0;
+  for (int i = 0; i < kRefreshMeasureFrames; i++) {
+    SDL_RenderClear(renderer_);
+    SDL_RenderPresent(renderer_);
+    int64_t now = GetTimeMicros();
+    if (i > kRefreshWarmupFrames) {
+      intervals.push_back(now - last_present);
+    }
+
+    last_present = now;
+  }
+
+  std::vector<int64_t> sorted(intervals);
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2,
+                   sorted.end());
+  int64_t median = sorted[sorted.size() / 2];
+
+  // If vsync isn't working, presents return immediately. Keep the display
+  // mode value in that case, and don't try to predict flip times.
+  DisplayCalibration &calibration = display_calibration_;
+  if (median <= kMicrosPerSecond / 1000 || median >= kMicrosPerSecond / 10) {
+    calibration.period_us = frame_period_us_;
+    SDL_Log("Frame period is %.3f ms (display mode %d Hz), vsync not "
+            "detected\n", static_cast<double>(frame_period_us_) / kMicrosPerMs,
+            mode.refresh_rate);
+    return;
+  }
+
+  frame_period_us_ = median;
+  calibration.period_us = median;
+
+  // Jitter is measured over the frames that weren't missed, so a single
+  // hiccup during startup doesn't swamp it.
+  double sum = 0;
+  double sum_squares = 0;
+  int count = 0;
+  for (int64_t interval : intervals) {
+    if (interval * 2 > median * 3) {
+      calibration.missed_frames += 1;
+    } else {
+      double deviation = static_cast<double>(interval - median);
+      sum += deviation;
+      sum_squares += deviation * deviation;
+      count += 1;
+    }
+  }
+
+  double mean = sum / count;
+  calibration.jitter_us =
+      static_cast<int64_t>(std::sqrt(sum_squares / count - mean * mean));
+
+  // A present that happens to be issued just before vsync also returns
+  // quickly, so take the most common result of several trials.
+  std::vector<int> depths;
+  for (int i = 0; i < kSwapDepthTrials; i++) {
+    depths.push_back(MeasureSwapDepth(renderer_, frame_period_us_));
+  }
+
+  int best_votes = 0;
+  for (int depth = 1; depth <= kMaxSwapDepth; depth++) {
+    int votes = static_cast<int>(std::count(depths.begin(), depths.end(),
+                                            depth));
+    if (votes > best_votes) {
+      best_votes = votes;
+      calibration.swap_depth = depth;
+    }
+  }
+
+  calibration.swap_depth_confidence =
+      static_cast<float>(best_votes) / kSwapDepthTrials;
+  calibration.valid = true;
+
+  SDL_Log("Frame period is %.3f ms (display mode %d Hz), jitter %.3f ms, "
+          "%d missed\n", static_cast<double>(frame_period_us_) / kMicrosPerMs,
+          mode.refresh_rate,
+          static_cast<double>(calibration.jitter_us) / kMicrosPerMs,
+          calibration.missed_frames);
+  SDL_Log("Swap depth is %d frames (%d of %d trials agreed)\n",
+          calibration.swap_depth, best_votes, kSwapDepthTrials);
 }
 
 void Screen::Blit(SDL_Texture *texture) {
@@ -81,6 +339,7 @@ void Screen::Blit(SDL_Texture *texture, int x, int y) {
 
 void Screen::Blit(SDL_Texture *texture, const SDL_Rect &dest_rect) {
   SDL_RenderCopy(renderer_, texture, nullptr, &dest_rect);
+  draw_calls_ += 1;
 }
 
 void Screen::DrawRect(const SDL_Rect &rect, const SDL_Color &line_color,
@@ -88,6 +347,7 @@ void Screen::DrawRect(const SDL_Rect &rect, const SDL_Color &line_color,
   SDL_SetRenderDrawColor(renderer_, line_color.r, line_color.g, line_color.b,
                          line_color.a);
   SDL_RenderDrawRect(renderer_, &rect);
+  draw_calls_ += 1;
   SDL_SetRenderDrawColor(renderer_, bg_color.r, bg_color.g, bg_color.b,
                          bg_color.a);
 }
@@ -97,31 +357,82 @@ void Screen::FillRect(const SDL_Rect &rect, const SDL_Color &fill_color,
   SDL_SetRenderDrawColor(renderer_, fill_color.r, fill_color.g, fill_color.b,
                          fill_color.a);
   SDL_RenderFillRect(renderer_, &rect);
+  draw_calls_ += 1;
   SDL_SetRenderDrawColor(renderer_, bg_color.r, bg_color.g, bg_color.b,
                          bg_color.a);
 }
 
 void Screen::DrawString(int left, int top, const std::string &str,
                         float font_scale) {
-  SDL_Rect source_rect;
-  source_rect.y = 0;
-  source_rect.w = kGlyphWidth;
-  source_rect.h = glyph_height_;
-
+  // Glyph positions are rounded the same way on both paths, so text looks
+  // the same with either.
   SDL_Rect dest_rect;
   dest_rect.x = left;
   dest_rect.y = top;
   dest_rect.w = kGlyphWidth * font_scale_ * font_scale;
   dest_rect.h = glyph_height_ * font_scale_ * font_scale;
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  TextKey key = {left, top, font_scale, std::hash<std::string>()(str)};
+  auto it = text_meshes.find(key);
+  if (it == text_meshes.end() || it->second.str != str) {
+    if (text_meshes.size() >= kMaxTextMeshes) {
+      text_meshes.clear();
+    }
+
+    TextMesh &mesh = text_meshes[key];
+    mesh.str = str;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    const SDL_Color white = {0xff, 0xff, 0xff, 0xff};
+    float atlas_width = static_cast<float>(font_atlas_width_);
+    for (auto ch : str) {
+      if (ch >= kLowestGlyph && ch <= kHighestGlyph) {
+        float u0 = (ch - kLowestGlyph) * kGlyphWidth / atlas_width;
+        float u1 = u0 + kGlyphWidth / atlas_width;
+        float x0 = static_cast<float>(dest_rect.x);
+        float x1 = static_cast<float>(dest_rect.x + dest_rect.w);
+        float y0 = static_cast<float>(dest_rect.y);
+        float y1 = static_cast<float>(dest_rect.y + dest_rect.h);
+        int base = static_cast<int>(mesh.vertices.size());
+        mesh.vertices.push_back({{x0, y0}, white, {u0, 0.0f}});
+        mesh.vertices.push_back({{x1, y0}, white, {u1, 0.0f}});
+        mesh.vertices.push_back({{x1, y1}, white, {u1, 1.0f}});
+        mesh.vertices.push_back({{x0, y1}, white, {u0, 1.0f}});
+        for (int index : {0, 1, 2, 0, 2, 3}) {
+          mesh.indices.push_back(base + index);
+        }
+      }
+
+      dest_rect.x += kGlyphWidth * font_scale_ * font_scale;
+    }
+
+    it = text_meshes.find(key);
+  }
+
+  const TextMesh &mesh = it->second;
+  if (!mesh.indices.empty()) {
+    SDL_RenderGeometry(renderer_, font_atlas_, mesh.vertices.data(),
+                       static_cast<int>(mesh.vertices.size()),
+                       mesh.indices.data(),
+                       static_cast<int>(mesh.indices.size()));
+    draw_calls_ += 1;
+  }
+#else
+  SDL_Rect source_rect;
+  source_rect.y = 0;
+  source_rect.w = kGlyphWidth;
+  source_rect.h = glyph_height_;
   for (auto ch : str) {
     if (ch >= kLowestGlyph && ch <= kHighestGlyph) {
       source_rect.x = (ch - kLowestGlyph) * kGlyphWidth;
       SDL_RenderCopy(renderer_, font_atlas_, &source_rect, &dest_rect);
+      draw_calls_ += 1;
     }
 
     dest_rect.x += kGlyphWidth * font_scale_ * font_scale;
   }
+#endif
 }
 
 int Screen::GetStringWidth(const std::string &str, float font_scale) {
@@ -159,6 +470,10 @@ SDL_Rect Screen::ComputeRectForPhysicalHeight(SDL_Texture *texture,
 }
 
 bool Screen::InitDisplay(float screen_width_cm, float screen_height_cm) {
+  if (IsHeadless()) {
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+  }
+
   if (SDL_Init(SDL_INIT_VIDEO) != 0) {
     ReportSdlError("SDL_GetCurrentDisplayMode");
     return false;
@@ -174,7 +489,9 @@ bool Screen::InitDisplay(float screen_width_cm, float screen_height_cm) {
   }
 
   renderer_ = SDL_CreateRenderer(
-      window_, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+      window_, -1, SDL_RENDERER_TARGETTEXTURE | (IsHeadless()
+          ? SDL_RENDERER_SOFTWARE
+          : SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
   if (renderer_ == nullptr) {
     ReportSdlError("SDL_CreateRenderer");
     SDL_Quit();
@@ -208,65 +525,165 @@ bool Screen::InitDisplay(float screen_width_cm, float screen_height_cm) {
   horz_pixels_per_cm_ = display_width_px_ / screen_width_cm;
   vert_pixels_per_cm_ = display_height_px_ / screen_height_cm;
 
-  font_atlas_ = LoadImage(GetResourceDir() + "font.svg");
+  {
+    StartupScope scope("Font");
+    font_atlas_ = LoadImage(GetResourceDir() + "font.svg");
+  }
+
   if (font_atlas_ == nullptr) {
     SDL_Quit();
     FatalError("Couldn't load font");
     return false;
   }
 
-  int glyph_width;
-  if (SDL_QueryTexture(font_atlas_, nullptr, nullptr, &glyph_width,
+  if (SDL_QueryTexture(font_atlas_, nullptr, nullptr, &font_atlas_width_,
                        &glyph_height_) < 0) {
     SDL_Quit();
     FatalError("SDL_QueryTexture failed");
     return false;
   }
 
-  SDL_Log("font %dx%d\n", glyph_width, glyph_height_);
+  SDL_Log("font %dx%d\n", font_atlas_width_, glyph_height_);
+
+  // Static screens are drawn every frame if this isn't available.
+  if (SDL_RenderTargetSupported(renderer_)) {
+    static_cache_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888,
+                                      SDL_TEXTUREACCESS_TARGET,
+                                      display_width_px_, display_height_px_);
+  }
+
+  if (static_cache_ == nullptr) {
+    SDL_Log("Render targets not supported, static screens won't be cached\n");
+  } else {
+    SDL_SetTextureBlendMode(static_cache_, SDL_BLENDMODE_NONE);
+  }
+
+  // Without vsync there's nothing to calibrate; the virtual clock runs at
+  // the default frame period.
+  if (!IsHeadless()) {
+    CalibrateDisplay();
+  }
 
   enable_sdl_error_dialog_ = true;
   return true;
 }
 
+void Screen::RenderStatic() {
+  if (static_cache_owner_ != current_screen_) {
+    SDL_SetRenderTarget(renderer_, static_cache_);
+    SDL_RenderClear(renderer_);
+    current_screen_->Render();
+    SDL_SetRenderTarget(renderer_, nullptr);
+    static_cache_owner_ = current_screen_;
+  }
+
+  SDL_RenderCopy(renderer_, static_cache_, nullptr, nullptr);
+  draw_calls_ += 1;
+}
+
+// Headless runs stand in for vsync by moving the virtual clock on by one
+// frame period. When the screen is settled, frames before the next thing
+// that could change it are skipped, as if they had been presented. Returns
+// false when nothing is left to happen.
+bool Screen::AdvanceVirtualFrame() {
+  int64_t now = GetTimeMicros();
+  int64_t skip_frames = 0;
+  if (presentation_countdown_ == 0) {
+    // Frames that can be skipped while staying before the deadline.
+    int64_t deadline = render_wakeup_time_;
+    int64_t input_time = input_script_->GetNextEventTime();
+    if (input_time >= 0) {
+      deadline = std::min(deadline, input_time);
+    }
+
+    bool switch_pending = next_screen_ != current_screen_;
+    if (switch_pending && !frame_scheduling_) {
+      deadline = std::min(deadline, next_screen_presentation_time_);
+    }
+
+    skip_frames = kNever;
+    if (deadline != kNever) {
+      skip_frames = std::max<int64_t>(0, (deadline - now - 1) /
+                                              frame_period_us_);
+    }
+
+    if (switch_pending && frame_scheduling_) {
+      skip_frames = std::min<int64_t>(
+          skip_frames,
+          std::max<int64_t>(0, next_screen_presentation_frame_ - frame_count_));
+    }
+
+    if (skip_frames == kNever) {
+      return false;
+    }
+  }
+
+  if (skip_frames > 0) {
+    frame_count_ += skip_frames;
+    presentation_audit_.FramesSkipped(now + skip_frames * frame_period_us_);
+  }
+
+  SetVirtualTime(now + (skip_frames + 1) * frame_period_us_);
+  return true;
+}
+
 void Screen::MainLoop(Screen *initial_screen) {
   next_screen_ = initial_screen;
-  next_screen_presentation_time_ = SDL_GetTicks();
+  next_screen_presentation_time_ = GetTimeMicros();
+  next_screen_presentation_frame_ = frame_count_;
+  SetTraceThreadName("main");
 
   bool running = true;
   while (running) {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-      switch (event.type) {
-        case SDL_QUIT:
-          running = false;
-          break;
-
-        case SDL_MOUSEBUTTONDOWN:
-          if (current_screen_ != nullptr) {
-            current_screen_->MouseClicked(event.button.button, event.button.x,
-                                          event.button.y);
-          }
-          break;
-
-        case SDL_KEYDOWN:
-          if ((event.key.keysym.mod & KMOD_LCTRL) != 0 &&
-              event.key.keysym.scancode == SDL_SCANCODE_C) {
-            // CTRL-C will exit the application
+    BeginTraceFrame();
+    {
+      TraceScope trace("PollEvents", GetScreenType(current_screen_));
+      if (input_script_ != nullptr) {
+        input_script_->PushDueEvents(GetTimeMicros());
+      }
+
+      SDL_Event event;
+      while (SDL_PollEvent(&event)) {
+        switch (event.type) {
+          case SDL_QUIT:
             running = false;
-          } else if (current_screen_ != nullptr) {
-            // Ignore repeated keys
-            if (event.key.repeat == 0) {
-              current_screen_->KeyPressed(event.key.keysym.scancode);
+            break;
+
+          case SDL_RENDER_TARGETS_RESET:
+          case SDL_RENDER_DEVICE_RESET:
+            // The contents of target textures have been lost.
+            static_cache_owner_ = nullptr;
+            break;
+
+          case SDL_MOUSEBUTTONDOWN:
+            if (current_screen_ != nullptr) {
+              current_screen_->MouseClicked(event.button.button,
+                                            event.button.x, event.button.y);
+            }
+            break;
+
+          case SDL_KEYDOWN:
+            if ((event.key.keysym.mod & KMOD_LCTRL) != 0 &&
+                event.key.keysym.scancode == SDL_SCANCODE_C) {
+              // CTRL-C will exit the application
+              running = false;
+            } else if (current_screen_ != nullptr) {
+              // Ignore repeated keys
+              if (event.key.repeat == 0) {
+                current_screen_->KeyPressed(event.key.keysym.scancode);
+              }
             }
-          }
-          break;
+            break;
+        }
       }
     }
 
-    if (next_screen_ != current_screen_ &&
-        WrappedGreaterEqual(SDL_GetTicks(), next_screen_presentation_time_)) {
+    bool switch_due = frame_scheduling_
+        ? frame_count_ >= next_screen_presentation_frame_
+        : GetTimeMicros() >= next_screen_presentation_time_;
+    if (next_screen_ != current_screen_ && switch_due) {
       if (current_screen_) {
+        TraceScope trace("IsInactive", GetScreenType(current_screen_));
         current_screen_->IsInactive();
       }
 
@@ -277,26 +694,96 @@ void Screen::MainLoop(Screen *initial_screen) {
       SDL_Color background = current_screen_->GetBackgroundColor();
       SDL_SetRenderDrawColor(renderer_, background.r, background.g,
                              background.b, 0xff);
-      presentation_countdown_ = 2;
+      presentation_countdown_ = GetPresentsUntilVisible();
+      activation_present_time_ = -1;
+      presentation_audit_.ScreenActivated();
+      static_cache_owner_ = nullptr;
+      TraceScope trace("IsActive", GetScreenType(current_screen_));
       current_screen_->IsActive();
     }
 
-    SDL_RenderClear(renderer_);
-    if (current_screen_) {
-      current_screen_->Render();
+    {
+      TraceScope trace("Render", GetScreenType(current_screen_));
+      render_wakeup_time_ = kNever;
+      draw_calls_ = 0;
+      SDL_RenderClear(renderer_);
+      if (current_screen_ && current_screen_->is_static_ &&
+          static_cache_ != nullptr) {
+        RenderStatic();
+      } else if (current_screen_) {
+        current_screen_->Render();
+      }
     }
 
-    SDL_RenderPresent(renderer_);
+    {
+      TraceScope trace("Present");
+      SDL_RenderPresent(renderer_);
+    }
+
+    frame_count_ += 1;
+    int64_t present_time = GetTimeMicros();
+    presentation_audit_.FramePresented(present_time);
     if (presentation_countdown_ > 0) {
+      if (activation_present_time_ < 0) {
+        activation_present_time_ = present_time;
+      }
+
       presentation_countdown_ -= 1;
-      if (presentation_countdown_ == 1) {
+
+      // With photon timing, the old screen disappears on the same vsync the
+      // new one appears. The first present after activation went into the
+      // swap queue, and reaches the display swap_depth - 1 frames after it
+      // returned.
+      int64_t flip_time = present_time;
+      int invisible_countdown = 1;
+      if (IsPhotonTimingEnabled()) {
+        flip_time = activation_present_time_ +
+            (display_calibration_.swap_depth - 1) * frame_period_us_;
+        invisible_countdown = 0;
+        if (presentation_countdown_ == 0) {
+          flip_time_ = flip_time;
+        }
+      }
+
+      if (presentation_countdown_ == invisible_countdown &&
+          previous_screen_ != nullptr) {
+        TraceScope trace("IsInvisible", GetScreenType(previous_screen_));
+        previous_screen_->IsInvisible();
+      }
+
+      if (presentation_countdown_ == 0) {
+        // The audit takes the previous screen down on the present that puts
+        // this one up, whenever the IsInvisible callback ran.
         if (previous_screen_ != nullptr) {
-          previous_screen_->IsInvisible();
+          presentation_audit_.ScreenInvisible(frame_count_, flip_time);
         }
-      } else if (presentation_countdown_ == 0) {
+
+        TraceScope trace("IsVisible", GetScreenType(current_screen_));
+        onset_presentation_ =
+            presentation_audit_.ScreenVisible(frame_count_, flip_time);
         current_screen_->IsVisible();
+        onset_presentation_ = -1;
+        flip_time_ = -1;
       }
     }
+
+    if (current_screen_ != nullptr && presentation_countdown_ == 0) {
+      TraceScope trace("Prefetch", GetScreenType(current_screen_));
+      if (next_screen_ != current_screen_) {
+        next_screen_->Prefetch();
+      } else {
+        for (Screen *successor : current_screen_->successors_) {
+          successor->Prefetch();
+        }
+      }
+    }
+
+    EndTraceFrame(frame_period_us_, draw_calls_);
+    if (IsHeadless() && !AdvanceVirtualFrame()) {
+      SDL_Log("Headless run finished at %.3f s\n",
+              static_cast<double>(GetTimeMicros()) / kMicrosPerSecond);
+      running = false;
+    }
   }
 
   SDL_DestroyRenderer(renderer_);
@@ -21,8 +21,12 @@
 #include <string>
 #include <vector>
 
+#include "PresentationAudit.h"
+
 namespace stimulus {
 
+class InputScript;
+
 namespace {
 const float kDefaultFontScale = 1.0;
 }
@@ -37,11 +41,95 @@ class Screen {
     successors_.push_back(screen);
   }
 
+  // Run without a display, for regression testing tasks. This uses SDL's
+  // dummy video driver and software renderer, and a virtual clock that
+  // skips ahead to the next thing that can change what's on screen. Input
+  // comes from the script, and the main loop exits once it has run out and
+  // nothing else is scheduled. Must be called before InitDisplay.
+  static void SetHeadless(InputScript *script);
+
+  static bool IsHeadless() {
+    return input_script_ != nullptr;
+  }
+
   static bool InitDisplay(float screen_width_cm, float screen_height_cm);
   static void MainLoop(Screen *initial_screen);
   static SDL_Renderer *GetRenderer();
   static void FatalError(const std::string &error);
 
+  // When enabled, SwitchToScreen delays are converted to a whole number of
+  // frames using the refresh period measured in InitDisplay, and the switch
+  // happens on exactly that vsync rather than on the first frame after a
+  // millisecond deadline.
+  static void SetFrameScheduling(bool enabled) {
+    frame_scheduling_ = enabled;
+  }
+
+  static int64_t GetFramePeriodMicros() {
+    return frame_period_us_;
+  }
+
+  // Measured by InitDisplay. The swap depth is how many presents it takes for
+  // a frame to reach the display, estimated by counting how many presents
+  // can be queued before the renderer blocks on vsync.
+  struct DisplayCalibration {
+    bool valid;  // False if vsync couldn't be detected.
+    int64_t period_us;
+    int64_t jitter_us;  // Standard deviation of the present interval.
+    int missed_frames;
+    int swap_depth;
+    float swap_depth_confidence;  // Fraction of trials that agreed.
+  };
+
+  static const DisplayCalibration &GetDisplayCalibration() {
+    return display_calibration_;
+  }
+
+  // When enabled (the default), IsInvisible and IsVisible are called on the
+  // present at which the calibration predicts the frame reaches the display,
+  // and marks sent from them are timestamped with that predicted time. When
+  // disabled, they are called on the first and second presents after a
+  // switch, and marks are timestamped when they are sent.
+  static void SetPhotonTiming(bool enabled) {
+    photon_timing_ = enabled;
+  }
+
+  static bool IsPhotonTimingEnabled() {
+    return photon_timing_ && display_calibration_.valid;
+  }
+
+  // While IsInvisible or IsVisible is running with photon timing enabled,
+  // the predicted time the new frame reached the display. Otherwise -1.
+  static int64_t GetFlipTime() {
+    return flip_time_;
+  }
+
+  // Round a duration to the nearest number of frames.
+  static int DurationToFrames(int duration_ms);
+
+  // Log a warning if a nominal stimulus duration can't be shown exactly on
+  // this display. Intended to be called when a task is initialized.
+  static void WarnIfNotFrameMultiple(const std::string &name, int duration_ms);
+
+  // Flip times of each screen, for checking stimulus durations.
+  static PresentationAudit &GetPresentationAudit() {
+    return presentation_audit_;
+  }
+
+  // While a screen's IsVisible is running, this is the id of its
+  // presentation in the audit. Otherwise -1.
+  static int GetOnsetPresentation() {
+    return onset_presentation_;
+  }
+
+  static int HorzSizeToPixels(float width_cm) {
+    return width_cm * horz_pixels_per_cm_;
+  }
+
+  static int VertSizeToPixels(float height_cm) {
+    return height_cm * vert_pixels_per_cm_;
+  }
+
  protected:
   void SwitchToScreen(int successor_num, int delay_ms = 0);
 
@@ -65,9 +153,36 @@ class Screen {
   // next screen's IsActive(), but before the current screen's IsInvisible()
   virtual void IsInactive() {}
 
+  // Called once per frame on the screen this one will switch to (or, until
+  // that is known, on each of its successors) while this screen is showing.
+  // A screen can use it to load what it needs before it is switched to,
+  // e.g. by starting a DecodeImageAsync and uploading the result once it's
+  // ready. It is called after the frame is presented, but must still
+  // return quickly.
+  virtual void Prefetch() {}
+
   virtual void KeyPressed(SDL_Scancode) {}
   virtual void MouseClicked(int button, int x, int y) {}
 
+  // A static screen draws the same thing every frame, so it is rendered
+  // once into a texture which is then copied to the display. It's redrawn
+  // each time the screen is switched to, so content set up in IsActive is
+  // fine; anything that changes it after that must call MarkDirty.
+  void SetStatic(bool is_static) {
+    is_static_ = is_static;
+  }
+
+  void MarkDirty() {
+    if (static_cache_owner_ == this) {
+      static_cache_owner_ = nullptr;
+    }
+  }
+
+  // A Render that depends on the time should call this with the next time
+  // its output (or any mark it sends) will change. Headless runs otherwise
+  // skip the frames until the next switch or input.
+  static void ScheduleRender(int64_t time_us);
+
   // Blit the texture in the center of the screen.
   static void Blit(SDL_Texture *texture);
 
@@ -104,14 +219,6 @@ class Screen {
 
   virtual SDL_Color GetLineColor() { return SDL_Color{0xff, 0xff, 0xff, 0xff}; }
 
-  static int HorzSizeToPixels(float width_cm) {
-    return width_cm * horz_pixels_per_cm_;
-  }
-
-  static int VertSizeToPixels(float height_cm) {
-    return height_cm * vert_pixels_per_cm_;
-  }
-
   // Compute a rect that will center this texture on the screen and
   // make the width be a fixed physical width on the screen.
   static SDL_Rect ComputeRectForPhysicalWidth(SDL_Texture *texture,
@@ -192,8 +299,14 @@ class Screen {
   }
 
  private:
+  static void CalibrateDisplay();
+  static bool AdvanceVirtualFrame();
+  static void RenderStatic();
+  static int GetPresentsUntilVisible();
+
   std::vector<Screen*> successors_;
   bool cursor_visible_ = false;
+  bool is_static_ = false;
 
   static float horz_pixels_per_cm_;
   static float vert_pixels_per_cm_;
@@ -202,12 +315,28 @@ class Screen {
   static Screen *next_screen_;
   static SDL_Renderer *renderer_;
   static SDL_Window *window_;
-  static int next_screen_presentation_time_;
+  static int64_t next_screen_presentation_time_;
+  static int64_t next_screen_presentation_frame_;
+  static int64_t frame_count_;
+  static int64_t frame_period_us_;
+  static bool frame_scheduling_;
   static int presentation_countdown_;
+  static int64_t activation_present_time_;
+  static int64_t flip_time_;
+  static bool photon_timing_;
+  static DisplayCalibration display_calibration_;
+  static InputScript *input_script_;
+  static int64_t render_wakeup_time_;
+  static PresentationAudit presentation_audit_;
+  static int onset_presentation_;
   static int display_width_px_;
   static int display_height_px_;
   static float pixel_ratio_;
   static SDL_Texture *font_atlas_;
+  static int font_atlas_width_;
+  static int draw_calls_;  // In the frame being rendered
+  static SDL_Texture *static_cache_;
+  static Screen *static_cache_owner_;  // Whose Render is in static_cache_
   static float font_scale_;
   static int glyph_height_;
   static bool enable_sdl_error_dialog_;
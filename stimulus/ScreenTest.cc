@@ -0,0 +1,101 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include "InputScript.h"
+#include "Screen.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int kStimulusFrames = 6;
+
+// Switches to its successor a fixed time after it becomes visible, asking
+// either when it is activated or once it is visible.
+class TimedScreen : public stimulus::Screen {
+ public:
+  TimedScreen(int duration_ms, bool switch_when_active)
+    : duration_ms_(duration_ms), switch_when_active_(switch_when_active) {}
+
+ protected:
+  void IsActive() override {
+    if (switch_when_active_) {
+      SwitchToSuccessor();
+    }
+  }
+
+  void IsVisible() override {
+    if (!switch_when_active_) {
+      SwitchToSuccessor();
+    }
+  }
+
+ private:
+  void SwitchToSuccessor() {
+    if (GetNumSuccessors() > 0) {
+      SwitchToScreen(0, duration_ms_);
+    }
+  }
+
+  int duration_ms_;
+  bool switch_when_active_;
+};
+
+// The main loop can only run once per process, so this is the only test
+// that runs it. It runs headless, with an empty input script, and returns
+// once the last screen is showing.
+BOOST_AUTO_TEST_CASE(MainLoopSwitchesAndAuditsScheduledFrames) {
+  stimulus::InputScript script("/dev/null");
+  stimulus::Screen::SetHeadless(&script);
+  stimulus::Screen::SetFrameScheduling(true);
+  BOOST_REQUIRE(stimulus::Screen::InitDisplay(30, 20));
+
+  int64_t period_us = stimulus::Screen::GetFramePeriodMicros();
+  int duration_ms = static_cast<int>(kStimulusFrames * period_us / 1000);
+  std::vector<TimedScreen> screens{TimedScreen(duration_ms, false),
+                                   TimedScreen(duration_ms, true),
+                                   TimedScreen(0, false)};
+  screens[0].AddSuccessor(&screens[1]);
+  screens[1].AddSuccessor(&screens[2]);
+
+  stimulus::PresentationAudit &audit =
+      stimulus::Screen::GetPresentationAudit();
+  audit.Reset(period_us);
+  stimulus::Screen::MainLoop(&screens[0]);
+
+  // Each screen comes up exactly its duration in frames after the one
+  // before it, whether that switched when activated or once visible.
+  for (int id = 0; id < 2; id++) {
+    const stimulus::PresentationAudit::Presentation *presentation =
+        audit.GetPresentation(id);
+    const stimulus::PresentationAudit::Presentation *next =
+        audit.GetPresentation(id + 1);
+    BOOST_REQUIRE(presentation != nullptr);
+    BOOST_REQUIRE(next != nullptr);
+    BOOST_CHECK_EQUAL(next->visible_frame - presentation->visible_frame,
+                      kStimulusFrames);
+
+    // The audit takes each screen down on the frame the next comes up.
+    BOOST_REQUIRE(presentation->IsComplete());
+    BOOST_CHECK_EQUAL(presentation->invisible_frame, next->visible_frame);
+    BOOST_CHECK_EQUAL(presentation->GetDurationFrames(), kStimulusFrames);
+    BOOST_CHECK_EQUAL(presentation->GetDurationMicros(),
+                      kStimulusFrames * period_us);
+    BOOST_CHECK_EQUAL(audit.NominalFrames(presentation->nominal_ms),
+                      kStimulusFrames);
+  }
+}
+
+}  // namespace
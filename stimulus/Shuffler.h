@@ -17,102 +17,239 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SHUFFLER_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SHUFFLER_H_
 
-#include <deque>
+#include <algorithm>
+#include <cassert>
 #include <vector>
 #include "Random.h"
 
-#include <iostream>
-
 namespace stimulus {
 
+// Orders elements randomly, with a limit on how many elements of the same
+// category can come in a row. Elements are stored once, and only their
+// indices are shuffled.
 template <typename T>
 class Shuffler {
  public:
-  void ShuffleElements() {
-    do {
-      shuffled_elements_ = TryToShuffleElements();
-    } while (shuffled_elements_.empty());
+  // The result has the same distribution as drawing the elements one at a
+  // time, skipping any that would make a run too long, and starting over if
+  // the end of the sequence forces one (which is how this used to work, and
+  // which could take many attempts). Instead, draws that would leave no
+  // valid way to finish are never made, and each sequence is accepted with
+  // a probability that corrects for that. For the tasks' settings that is
+  // nearly always more than 90%. After kMaxShuffleAttempts the last sequence
+  // (which is valid) is used, so this always finishes.
+  //
+  // If the categories can't be ordered within their limits at all, they are
+  // ignored. Without limits, the order is the same as before for the same
+  // random numbers.
+  void ShuffleElements(RandomStream *random) {
+    std::vector<int> counts;
+    for (const Category &category : categories_) {
+      counts.push_back(category.size);
+    }
+
+    bool limit_runs = CanFinish(counts, values_.size(), -1, 0);
+    for (int attempt = 1; ; attempt++) {
+      double acceptance = TryToShuffleElements(random, limit_runs);
+      if (acceptance >= 1 || attempt == kMaxShuffleAttempts ||
+          random->NextDouble() < acceptance) {
+        break;
+      }
+    }
+
+    next_item_ = 0;
   }
 
   bool IsDone() const {
-    return shuffled_elements_.empty();
+    return next_item_ == order_.size();
   }
 
   T GetNextItem() {
-    T retval = shuffled_elements_.front();
-    shuffled_elements_.pop_front();
-    return retval;
+    return values_[order_[next_item_++]];
   }
 
-  void AddCategoryElements(const std::vector<T> &category_elements,
-                           int max_run_length) {
-    int category = category_counts_.size();
-    for (auto element : category_elements) {
-      Element dest_element = {category, max_run_length, element};
-      source_elements_.push_back(dest_element);
+  // Returns the items the next calls to GetNextItem will return, up to
+  // count of them, without removing them.
+  std::vector<T> PeekNextItems(size_t count) const {
+    size_t end = std::min(order_.size(), next_item_ + count);
+    std::vector<T> items;
+    for (size_t i = next_item_; i < end; i++) {
+      items.push_back(values_[order_[i]]);
     }
 
-    category_counts_.push_back(category_elements.size());
-    if (!category_elements.empty()) {
-      num_non_empty_categories_++;
-    }
+    return items;
+  }
+
+  // A max_run_length of 0 means there is no limit.
+  void AddCategoryElements(const std::vector<T> &category_elements,
+                           int max_run_length) {
+    Category category = {static_cast<int>(category_elements.size()),
+                         max_run_length};
+    categories_.push_back(category);
+    values_.insert(values_.end(), category_elements.begin(),
+                   category_elements.end());
   }
 
  private:
-  struct Element {
-    int category;
+  static const int kMaxShuffleAttempts = 100;
+
+  // A category's elements are contiguous in values_, in the order the
+  // categories were added.
+  struct Category {
+    int size;
     int max_run_length;
-    T value;
   };
 
-  std::deque<T> TryToShuffleElements() {
-    std::vector<Element> source = source_elements_;
-    std::vector<int> category_counts = category_counts_;
-    int num_non_empty_categories = num_non_empty_categories_;
+  // Returns the probability of accepting the new order_.
+  double TryToShuffleElements(RandomStream *random, bool limit_runs) {
+    int num_categories = categories_.size();
+    std::vector<int> counts(num_categories);
+    int num_non_empty = 0;
+    for (int c = 0; c < num_categories; c++) {
+      counts[c] = categories_[c].size;
+      num_non_empty += counts[c] > 0;
+    }
+
+    int total = values_.size();
+    ResetRemaining();
+    order_.clear();
     int last_category = -1;
-    int run_length = 1;
-    std::deque<T> result;
-
-    while (!source.empty()) {
-      int draw_index;
-      do {
-        draw_index = GenerateRandomInt(0, source.size());
-      } while (num_non_empty_categories > 1 &&
-               source[draw_index].max_run_length > 0 &&
-               run_length == source[draw_index].max_run_length &&
-               source[draw_index].category == last_category);
-
-      int category = source[draw_index].category;
-      if (category == last_category) {
-        if (source[draw_index].max_run_length > 0 &&
-            ++run_length > source[draw_index].max_run_length) {
-          // Failed to generate correct sequence because there is a run at the end.
-          // Return an empty vector to indicate this.
-          return std::deque<T>();
+    int run_length = 0;
+    double acceptance = 1;
+    std::vector<bool> is_candidate(num_categories);
+    while (total > 0) {
+      // num_allowed is the number of elements the plain draw described
+      // above picks from: a run that's too long is only drawn (and then
+      // started over) when no other category is left. Candidates also leave
+      // a valid way to finish.
+      int num_allowed = 0;
+      int num_candidates = 0;
+      for (int c = 0; c < num_categories; c++) {
+        is_candidate[c] = false;
+        if (counts[c] == 0) {
+          continue;
+        }
+
+        int run = c == last_category ? run_length + 1 : 1;
+        int max_run = categories_[c].max_run_length;
+        bool too_long = limit_runs && max_run > 0 && run > max_run;
+        if (!too_long || num_non_empty == 1) {
+          num_allowed += counts[c];
+        }
+
+        if (!too_long) {
+          counts[c]--;
+          is_candidate[c] =
+              !limit_runs || CanFinish(counts, total - 1, c, run);
+          counts[c]++;
+          if (is_candidate[c]) {
+            num_candidates += counts[c];
+          }
+        }
+      }
+
+      assert(num_candidates > 0);
+      acceptance *= static_cast<double>(num_candidates) / num_allowed;
+
+      // Find the index'th remaining element of the candidate categories.
+      int index = random->NextInt(0, num_candidates);
+      int rank = 0;
+      int category = 0;
+      for (; category < num_categories; category++) {
+        if (is_candidate[category]) {
+          if (index < counts[category]) {
+            break;
+          }
+
+          index -= counts[category];
         }
+
+        rank += counts[category];
+      }
+
+      int position = FindRemaining(rank + index);
+      RemovePosition(position);
+      order_.push_back(position);
+      if (--counts[category] == 0) {
+        num_non_empty--;
+      }
+
+      total--;
+      if (category == last_category) {
+        run_length++;
       } else {
         last_category = category;
         run_length = 1;
       }
+    }
+
+    return acceptance;
+  }
 
-      // We'd get into an infinite loop if we tried to avoid a run with only
-      // one category left. Detect that here.
-      if (--category_counts[category] == 0) {
-        num_non_empty_categories--;
+  // Whether the elements in counts can still be ordered within the limits,
+  // after a run of run_length from last_category. The runs of a category fit
+  // before, between and after the other elements, so this only has to check
+  // each category on its own.
+  bool CanFinish(const std::vector<int> &counts, int total, int last_category,
+                 int run_length) const {
+    for (size_t c = 0; c < categories_.size(); c++) {
+      int max_run = categories_[c].max_run_length;
+      if (max_run > 0 && counts[c] > 0) {
+        int capacity = max_run * (total - counts[c] + 1);
+        if (static_cast<int>(c) == last_category) {
+          capacity -= run_length;
+        }
+
+        if (counts[c] > capacity) {
+          return false;
+        }
       }
+    }
+
+    return true;
+  }
+
+  // remaining_ is a Fenwick tree over the positions in values_, counting the
+  // elements that haven't been drawn yet.
+  void ResetRemaining() {
+    int size = values_.size();
+    remaining_.resize(size + 1);
+    for (int i = 1; i <= size; i++) {
+      remaining_[i] = i & -i;
+    }
+  }
 
-      result.push_back(source[draw_index].value);
-      source.erase(source.begin() + draw_index);
+  void RemovePosition(int position) {
+    int size = values_.size();
+    for (int i = position + 1; i <= size; i += i & -i) {
+      remaining_[i]--;
+    }
+  }
+
+  // Returns the position of the rank'th (from 0) remaining element.
+  int FindRemaining(int rank) const {
+    int size = values_.size();
+    int step = 1;
+    while (step * 2 <= size) {
+      step *= 2;
+    }
+
+    int position = 0;
+    for (; step > 0; step /= 2) {
+      if (position + step <= size && remaining_[position + step] <= rank) {
+        position += step;
+        rank -= remaining_[position];
+      }
     }
 
-    return result;
+    return position;
   }
 
-  std::vector<Element> source_elements_;
-  std::deque<T> shuffled_elements_;
-  std::vector<int> category_counts_;
-  int num_non_empty_categories_ = 0;
-  bool shuffled_ = false;
+  std::vector<T> values_;
+  std::vector<Category> categories_;
+  std::vector<int> order_;
+  size_t next_item_ = 0;
+  std::vector<int> remaining_;
 };
 
 }  // namespace stimulus
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <map>
 #include <vector>
 #include "Shuffler.h"
 
@@ -25,7 +27,7 @@ const int kMaxRunLength = 3;
 
 // Each category should have no more than a run of 3
 BOOST_AUTO_TEST_CASE(Shuffle) {
-  stimulus::InitRandom(time(nullptr));
+  stimulus::RandomStream random(time(nullptr));
 
   stimulus::Shuffler<int> shuffler;
   for (int i = 0; i < kNumCategories; i++) {
@@ -37,7 +39,7 @@ BOOST_AUTO_TEST_CASE(Shuffle) {
     shuffler.AddCategoryElements(values, kMaxRunLength);
   }
 
-  shuffler.ShuffleElements();
+  shuffler.ShuffleElements(&random);
 
   bool seen_flags[kElementsPerCategory * kNumCategories];
   memset(seen_flags, 0, sizeof(seen_flags));
@@ -65,7 +67,7 @@ BOOST_AUTO_TEST_CASE(Shuffle) {
 
 // Only the first category has a max run restriction
 BOOST_AUTO_TEST_CASE(Shuffle2) {
-  stimulus::InitRandom(time(nullptr));
+  stimulus::RandomStream random(time(nullptr));
 
   stimulus::Shuffler<int> shuffler;
   for (int i = 0; i < kNumCategories; i++) {
@@ -77,7 +79,7 @@ BOOST_AUTO_TEST_CASE(Shuffle2) {
     shuffler.AddCategoryElements(values, i == 0 ? kMaxRunLength : 0);
   }
 
-  shuffler.ShuffleElements();
+  shuffler.ShuffleElements(&random);
 
   bool seen_flags[kElementsPerCategory * kNumCategories];
   memset(seen_flags, 0, sizeof(seen_flags));
@@ -105,6 +107,29 @@ BOOST_AUTO_TEST_CASE(Shuffle2) {
   BOOST_CHECK(shuffler.IsDone());
 }
 
+// Peeking returns the upcoming items in order without consuming them.
+BOOST_AUTO_TEST_CASE(PeekNextItems) {
+  const std::vector<int> kElements { 0,1,2,3,4,5,6,7 };
+  const size_t kPeekCount = 3;
+
+  stimulus::RandomStream random(1);
+  stimulus::Shuffler<int> shuffler;
+  shuffler.AddCategoryElements(kElements, 0);
+  shuffler.ShuffleElements(&random);
+  size_t remaining = kElements.size();
+  while (!shuffler.IsDone()) {
+    std::vector<int> upcoming = shuffler.PeekNextItems(kPeekCount);
+    BOOST_CHECK_EQUAL(upcoming.size(), std::min(kPeekCount, remaining));
+    for (int item : upcoming) {
+      BOOST_CHECK_EQUAL(item, shuffler.GetNextItem());
+      remaining--;
+    }
+  }
+
+  BOOST_CHECK_EQUAL(remaining, 0);
+  BOOST_CHECK(shuffler.PeekNextItems(kPeekCount).empty());
+}
+
 // Compute the distribution of elements in each list position. These should all
 // be relatively even.
 BOOST_AUTO_TEST_CASE(BucketDistribution) {
@@ -121,11 +146,12 @@ BOOST_AUTO_TEST_CASE(BucketDistribution) {
 
   memset(position_distribution, 0, sizeof(position_distribution));
 
+  stimulus::RandomStream random(time(nullptr));
   for (int rep = 0; rep < kNumTrials; rep++) {
     stimulus::Shuffler<int> shuffler;
     shuffler.AddCategoryElements(kElements1, kMaxRunLength);
     shuffler.AddCategoryElements(kElements2, kMaxRunLength);
-    shuffler.ShuffleElements();
+    shuffler.ShuffleElements(&random);
     for (int i = 0; i < kNumElements; i++) {
       int item = shuffler.GetNextItem();
       position_distribution[i][item]++;
@@ -141,4 +167,132 @@ BOOST_AUTO_TEST_CASE(BucketDistribution) {
   }
 }
 
+// The previous implementation: draw one element at a time, redrawing any
+// that would make a run too long, and start over if the end of the sequence
+// forces one. Returns the categories in the order drawn.
+std::vector<int> RejectionShuffle(const std::vector<int> &category_sizes,
+                                  const std::vector<int> &max_runs,
+                                  stimulus::RandomStream *random) {
+  for (;;) {
+    std::vector<int> source;
+    for (size_t c = 0; c < category_sizes.size(); c++) {
+      source.insert(source.end(), category_sizes[c], c);
+    }
+
+    std::vector<int> counts = category_sizes;
+    int num_non_empty = counts.size();
+    int last_category = -1;
+    int run_length = 1;
+    std::vector<int> result;
+    while (!source.empty()) {
+      int index;
+      int category;
+      do {
+        index = random->NextInt(0, source.size());
+        category = source[index];
+      } while (num_non_empty > 1 && max_runs[category] > 0 &&
+               category == last_category &&
+               run_length == max_runs[category]);
+
+      if (category != last_category) {
+        last_category = category;
+        run_length = 1;
+      } else if (max_runs[category] > 0 &&
+                 ++run_length > max_runs[category]) {
+        break;
+      }
+
+      if (--counts[category] == 0) {
+        num_non_empty--;
+      }
+
+      result.push_back(category);
+      source.erase(source.begin() + index);
+    }
+
+    if (source.empty()) {
+      return result;
+    }
+  }
+}
+
+// The sequences of categories should be as likely as they were with the
+// previous implementation. These sizes are where skipping the draws that
+// can't finish (without correcting for it) would be off by up to 40%.
+BOOST_AUTO_TEST_CASE(MatchesRejectionSampling) {
+  const int kNumTrials = 100000;
+  const std::vector<int> kCategorySizes { 2, 4 };
+  const std::vector<int> kMaxRuns { 1, 0 };
+  const double kTolerance = 0.1;
+
+  stimulus::RandomStream random(1);
+  std::map<std::vector<int>, int> expected;
+  std::map<std::vector<int>, int> actual;
+  for (int rep = 0; rep < kNumTrials; rep++) {
+    expected[RejectionShuffle(kCategorySizes, kMaxRuns, &random)]++;
+
+    stimulus::Shuffler<int> shuffler;
+    for (size_t c = 0; c < kCategorySizes.size(); c++) {
+      shuffler.AddCategoryElements(
+          std::vector<int>(kCategorySizes[c], c), kMaxRuns[c]);
+    }
+
+    shuffler.ShuffleElements(&random);
+    std::vector<int> categories;
+    while (!shuffler.IsDone()) {
+      categories.push_back(shuffler.GetNextItem());
+    }
+
+    actual[categories]++;
+  }
+
+  BOOST_CHECK_EQUAL(actual.size(), expected.size());
+  for (const auto &sequence : expected) {
+    int count = actual[sequence.first];
+    BOOST_CHECK_GT(count, sequence.second * (1 - kTolerance));
+    BOOST_CHECK_LT(count, sequence.second * (1 + kTolerance));
+  }
+}
+
+// SRET alternates between two categories of the same size.
+BOOST_AUTO_TEST_CASE(Alternate) {
+  const int kCategorySize = 40;
+
+  stimulus::RandomStream random(time(nullptr));
+  stimulus::Shuffler<int> shuffler;
+  shuffler.AddCategoryElements(std::vector<int>(kCategorySize, 0), 1);
+  shuffler.AddCategoryElements(std::vector<int>(kCategorySize, 1), 1);
+  shuffler.ShuffleElements(&random);
+  int last_category = shuffler.GetNextItem();
+  for (int i = 1; i < kCategorySize * 2; i++) {
+    int category = shuffler.GetNextItem();
+    BOOST_CHECK_NE(category, last_category);
+    last_category = category;
+  }
+
+  BOOST_CHECK(shuffler.IsDone());
+}
+
+// Limits that can't be met are ignored, rather than looping forever.
+BOOST_AUTO_TEST_CASE(ImpossibleLimits) {
+  const std::vector<int> kElements1 { 0,1,2,3,4 };
+  const std::vector<int> kElements2 { 5 };
+
+  stimulus::RandomStream random(1);
+  stimulus::Shuffler<int> shuffler;
+  shuffler.AddCategoryElements(kElements1, 1);
+  shuffler.AddCategoryElements(kElements2, 1);
+  shuffler.ShuffleElements(&random);
+  std::vector<int> items;
+  while (!shuffler.IsDone()) {
+    items.push_back(shuffler.GetNextItem());
+  }
+
+  std::sort(items.begin(), items.end());
+  BOOST_CHECK_EQUAL(items.size(), 6);
+  for (size_t i = 0; i < items.size(); i++) {
+    BOOST_CHECK_EQUAL(items[i], i);
+  }
+}
+
 }  // namespace
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SPSCRING_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SPSCRING_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace stimulus {
+
+// Fixed size lock-free queue with a single producer thread and a single
+// consumer thread. Neither Push nor Pop will block or allocate.
+template <typename T, size_t Capacity>
+class SpscRing {
+ public:
+  // Returns false if the queue is full.
+  bool Push(const T &value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = Next(tail);
+    if (next == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    slots_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false if the queue is empty.
+  bool Pop(T *value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    *value = slots_[head];
+    head_.store(Next(head), std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // This is only a snapshot if the other thread is active.
+  size_t GetSize() const {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return (tail + kNumSlots - head) % kNumSlots;
+  }
+
+  static size_t GetCapacity() {
+    return Capacity;
+  }
+
+ private:
+  // One slot is always left empty to distinguish full from empty.
+  static const size_t kNumSlots = Capacity + 1;
+
+  static size_t Next(size_t index) {
+    return index + 1 == kNumSlots ? 0 : index + 1;
+  }
+
+  T slots_[kNumSlots];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SPSCRING_H_
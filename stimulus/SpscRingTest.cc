@@ -0,0 +1,73 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include "SpscRing.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int kRingCapacity = 8;
+const int kNumTransfers = 100000;
+
+BOOST_AUTO_TEST_CASE(RingFullAndEmpty) {
+  stimulus::SpscRing<int, kRingCapacity> ring;
+  int value;
+  BOOST_CHECK(ring.IsEmpty());
+  BOOST_CHECK(!ring.Pop(&value));
+
+  for (int i = 0; i < kRingCapacity; i++) {
+    BOOST_CHECK(ring.Push(i));
+  }
+
+  BOOST_CHECK_EQUAL(ring.GetSize(), kRingCapacity);
+  BOOST_CHECK(!ring.Push(kRingCapacity));
+
+  for (int i = 0; i < kRingCapacity; i++) {
+    BOOST_CHECK(ring.Pop(&value));
+    BOOST_CHECK_EQUAL(value, i);
+  }
+
+  BOOST_CHECK(ring.IsEmpty());
+}
+
+// Values must come out in order, with none lost or duplicated, when the
+// producer and consumer run on different threads.
+BOOST_AUTO_TEST_CASE(RingThreaded) {
+  stimulus::SpscRing<int, kRingCapacity> ring;
+  std::thread producer([&ring] {
+    for (int i = 0; i < kNumTransfers; i++) {
+      while (!ring.Push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  while (expected < kNumTransfers) {
+    int value;
+    if (ring.Pop(&value)) {
+      BOOST_REQUIRE_EQUAL(value, expected);
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  BOOST_CHECK(ring.IsEmpty());
+}
+
+}  // namespace
@@ -21,6 +21,8 @@
 #include "Util.h"
 
 #include <cassert>
+#include <map>
+#include <memory>
 
 namespace stimulus {
 namespace {
@@ -36,6 +38,10 @@ const int kResponseFixationMs = 1800;
 const int kWordTimeMs = 400;
 const int kResponseTimeoutMs = 5000;
 
+// Conditions (in the schedule only, they aren't marked)
+const int kConditionPositive = 1;
+const int kConditionNegative = 2;
+
 // Marks
 const int kMarkNo = 100;
 const int kMarkYes = 200;
@@ -43,6 +49,12 @@ const int kMarkNoResponse = 255;
 const int kMarkStartStop = 999;
 const int kMarkOffset = 777;
 
+const MarkEventId kEventTaskStartStop = InternMarkEvent("TaskStartStop");
+const MarkEventId kEventWordOffset = InternMarkEvent("WordOffset");
+const MarkEventId kEventResponseNone = InternMarkEvent("ResponseNone");
+const MarkEventId kEventResponseYes = InternMarkEvent("ResponseYes");
+const MarkEventId kEventResponseNo = InternMarkEvent("ResponseNo");
+
 // Keys
 const SDL_Scancode kScancodeNo = SDL_SCANCODE_S;
 const SDL_Scancode kScancodeYes = SDL_SCANCODE_L;
@@ -50,11 +62,46 @@ const SDL_Scancode kScancodeYes = SDL_SCANCODE_L;
 struct SretWord {
   std::string word;
   int mark;
+  MarkEventId event;
+};
+
+struct SretState {
+  TaskSchedule schedule;
+  std::map<int, SretWord> words;
+  size_t trial_count = 0;
 };
 
 // State
 bool Done = false;
 
+// Words are identified by their marks: positive words followed by negative
+// words, 1-based.
+std::vector<SretWord> BuildWordList(const std::vector<std::string> &words,
+                                    int first_mark) {
+  std::vector<SretWord> result;
+  for (int i = 0; i < static_cast<int>(words.size()); i++) {
+    SretWord word = {words.at(i), first_mark + i, InternMarkEvent(words.at(i))};
+    result.push_back(word);
+  }
+
+  return result;
+}
+
+std::vector<ScheduledTrial> BuildTrials(const std::vector<SretWord> &words,
+                                        int condition) {
+  std::vector<ScheduledTrial> trials;
+  for (const SretWord &word : words) {
+    ScheduledTrial trial;
+    trial.condition = condition;
+    trial.stimuli.push_back(word.mark);
+    trial.marks.push_back(word.mark);
+    trial.marks.push_back(kMarkOffset);
+    trials.push_back(trial);
+  }
+
+  return trials;
+}
+
 class SretInstructionScreen : public InstructionExamplesScreen {
  public:
   SretInstructionScreen() : InstructionExamplesScreen("Rate each word") {
@@ -82,7 +129,7 @@ class SretInstructionScreen : public InstructionExamplesScreen {
   }
 
   void IsVisible() override {
-    SendMark(kMarkStartStop, "TaskStartStop");
+    SendMark(kMarkStartStop, kEventTaskStartStop);
   }
 
  private:
@@ -97,49 +144,48 @@ class SretInstructionScreen : public InstructionExamplesScreen {
   SDL_Point right2_location_;
 };
 
-class SretWordScreen : public Screen {
+class SretFixationScreen : public FixationDotScreen {
  public:
-  SretWordScreen(const std::vector<std::string> negative_words,
-                 const std::vector<std::string> positive_words)
-      : trial_count_(0) {
-    // marks are positive words followed by negative words, 1-based
-    int count = positive_words.size();
-    std::vector<SretWord> positive;
-    for (int i = 0; i < count; i++) {
-      SretWord word = {positive_words.at(i), i + 1};
-      positive.push_back(word);
-    }
-    shuffler_.AddCategoryElements(positive, kMaxRun);
+  // The delay comes from the schedule.
+  explicit SretFixationScreen(std::shared_ptr<SretState> state)
+      : FixationDotScreen(0), state_(state) {}
+
+ protected:
+  int GetDelayMs() override {
+    assert(state_->trial_count < state_->schedule.trials.size());
+    return state_->schedule.trials[state_->trial_count].fixation_ms;
+  }
 
-    std::vector<SretWord> negative;
-    for (int i = 0; i < static_cast<int>(negative_words.size()); i++) {
-      SretWord word = {negative_words.at(i), i + 1 + count};
-      negative.push_back(word);
-    }
-    shuffler_.AddCategoryElements(negative, kMaxRun);
+ private:
+  std::shared_ptr<SretState> state_;
+};
 
-    shuffler_.ShuffleElements();
-  }
+class SretWordScreen : public Screen {
+ public:
+  explicit SretWordScreen(std::shared_ptr<SretState> state) : state_(state) {}
 
   void IsActive() override {
-    trial_count_ += 1;
-    assert(!shuffler_.IsDone());
+    assert(state_->trial_count < state_->schedule.trials.size());
+    const ScheduledTrial &trial =
+        state_->schedule.trials[state_->trial_count];
+    state_->trial_count += 1;
 
-    SretWord word = shuffler_.GetNextItem();
+    const SretWord &word = state_->words[trial.stimuli.front()];
     next_word_ = word.word;
     next_mark_ = word.mark;
+    next_event_ = word.event;
     word_location_ = CenterString(next_word_, 1.0);
 
-    if (trial_count_ == kTotalTrials) {
+    // Running the task again repeats the schedule.
+    if (state_->trial_count == state_->schedule.trials.size()) {
       Done = true;
-      shuffler_.ShuffleElements();
-      trial_count_ = 0;
+      state_->trial_count = 0;
     }
     SwitchToScreen(0, kWordTimeMs);
   }
 
   void IsInvisible() override {
-    SendMark(kMarkOffset, "WordOffset");
+    SendMark(kMarkOffset, kEventWordOffset);
   }
 
   void Render() override {
@@ -147,15 +193,15 @@ class SretWordScreen : public Screen {
   }
 
   void IsVisible() override {
-    SendMark(next_mark_, next_word_);
+    SendMark(next_mark_, next_event_);
   }
 
  private:
-  int trial_count_;
+  std::shared_ptr<SretState> state_;
   std::string next_word_;
   int next_mark_;
+  MarkEventId next_event_;
   SDL_Point word_location_;
-  Shuffler<SretWord> shuffler_;
 };
 
 class SretResponseScreen : public Screen {
@@ -178,10 +224,10 @@ class SretResponseScreen : public Screen {
 
   void IsInactive() override {
     if (!keypressed_) {
-      SendMark(kMarkNoResponse, "ResponseNone");
+      SendMark(kMarkNoResponse, kEventResponseNone);
     }
     if (Done) {
-      SendMark(kMarkStartStop, "TaskStartStop");
+      SendMark(kMarkStartStop, kEventTaskStartStop);
     }
   }
 
@@ -194,11 +240,11 @@ class SretResponseScreen : public Screen {
     switch (scode) {
       case kScancodeYes:
         keypressed_ = true;
-        SendMark(kMarkYes, "ResponseYes");
+        SendMark(kMarkYes, kEventResponseYes);
         break;
       case kScancodeNo:
         keypressed_ = true;
-        SendMark(kMarkNo, "ResponseNo");
+        SendMark(kMarkNo, kEventResponseNo);
         break;
       default:
         break;
@@ -222,14 +268,60 @@ class SretResponseScreen : public Screen {
 
 }  // namespace
 
-Screen *InitSret(Screen *main_screen, const Settings &settings) {
+TaskSchedule CompileSretSchedule(RandomStream *random) {
+  // The fixation stream is split off first, as it was when the task
+  // shuffled while it ran, so a seed gives the same trials it did then.
+  RandomStream fixation_random = random->Split();
+  RandomStream word_random = random->Split();
+
+  std::vector<SretWord> positive = BuildWordList(SretPositiveWords, 1);
+  std::vector<SretWord> negative =
+      BuildWordList(SretNegativeWords, positive.size() + 1);
+  Shuffler<ScheduledTrial> words;
+  words.AddCategoryElements(BuildTrials(positive, kConditionPositive),
+                            kMaxRun);
+  words.AddCategoryElements(BuildTrials(negative, kConditionNegative),
+                            kMaxRun);
+  words.ShuffleElements(&word_random);
+
+  TaskSchedule schedule;
+  for (int trial_count = 0; trial_count < kTotalTrials; trial_count++) {
+    ScheduledTrial trial = words.GetNextItem();
+    trial.fixation_ms =
+        fixation_random.NextInt(kMinFixationTimeMs, kMaxFixationTimeMs);
+    if (trial_count == 0) {
+      trial.marks.insert(trial.marks.begin(), kMarkStartStop);
+    }
+
+    if (trial_count == kTotalTrials - 1) {
+      trial.marks.push_back(kMarkStartStop);
+    }
+
+    schedule.trials.push_back(trial);
+  }
+
+  return schedule;
+}
+
+Screen *InitSret(Screen *main_screen, const Settings &settings,
+                 const TaskSchedule &schedule) {
+  Screen::WarnIfNotFrameMultiple("SRET word time", kWordTimeMs);
+
   Screen *version = new VersionScreen();
   Screen *instructions = new SretInstructionScreen();
-  Screen *fixation =
-      new FixationDotScreen(kMinFixationTimeMs, kMaxFixationTimeMs);
-  Screen *word = new SretWordScreen(SretNegativeWords, SretPositiveWords);
-  Screen *response_fixation =
-      new FixationDotScreen(kResponseFixationMs, kResponseFixationMs);
+  std::shared_ptr<SretState> state(new SretState());
+  state->schedule = schedule;
+  std::vector<SretWord> words = BuildWordList(SretPositiveWords, 1);
+  std::vector<SretWord> negative =
+      BuildWordList(SretNegativeWords, words.size() + 1);
+  words.insert(words.end(), negative.begin(), negative.end());
+  for (const SretWord &word : words) {
+    state->words[word.mark] = word;
+  }
+
+  Screen *fixation = new SretFixationScreen(state);
+  Screen *word = new SretWordScreen(state);
+  Screen *response_fixation = new FixationDotScreen(kResponseFixationMs);
   Screen *response = new SretResponseScreen();
 
   version->AddSuccessor(instructions);
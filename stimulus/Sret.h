@@ -17,12 +17,19 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SRET_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SRET_H_
 
+#include "Random.h"
+#include "Schedule.h"
 #include "Screen.h"
 #include "Settings.h"
 
 namespace stimulus {
 
-Screen *InitSret(Screen *main_screen, const Settings &settings);
+// Draws every trial's word and fixation time. Responses aren't in the
+// schedule's marks, since they depend on the participant.
+TaskSchedule CompileSretSchedule(RandomStream *random);
+
+Screen *InitSret(Screen *main_screen, const Settings &settings,
+                 const TaskSchedule &schedule);
 
 }  // namespace stimulus
 
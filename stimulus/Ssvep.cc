@@ -15,8 +15,10 @@
 #include "Ssvep.h"
 
 #include <cassert>
+#include <map>
 #include <memory>
 
+#include "Clock.h"
 #include "CommonScreens.h"
 #include "Image.h"
 #include "Mark.h"
@@ -64,6 +66,11 @@ const int kNumNeutralImages = 27;
 const int kNumPleasantImages = 27;
 const int kNumUnpleasantImages = 27;
 const float kImageWidthCm = 10;
+const char *kTextureBudgetSetting = "ssvep_texture_budget_mb";
+// With a budget, this many images from the schedule, starting with the one
+// on screen, are kept loaded (1.5 seconds of images).
+const size_t kUpcomingImages = 10;
+const int64_t kBytesPerMb = 1024 * 1024;
 
 struct Condition {
   int mark;
@@ -87,19 +94,11 @@ struct Condition {
     },
 };
 
-struct Image {
-  std::string path;
-  int mark;
-};
-
 struct SsvepState {
-  TextureManager texture_manager;
-  Shuffler<int> shuffler;
-  Shuffler<Image> neutral_shuffler;
-  Shuffler<Image> pleasant_shuffler;
-  Shuffler<Image> unpleasant_shuffler;
-  int trial_count;
-  char *next_condition;
+  std::unique_ptr<TextureManager> texture_manager;
+  TaskSchedule schedule;
+  std::map<int, std::string> image_paths;
+  size_t trial_count;
   int next_condition_mark;
   bool next_condition_mark_sent;
   bool first_image_mark_sent;
@@ -107,74 +106,108 @@ struct SsvepState {
   SDL_Texture *images[kNumImagesPerCategory * kNumCategories];
   int image_marks[kNumImagesPerCategory * kNumCategories];
   SDL_Rect dest_rects[kNumImagesPerCategory * kNumCategories];
+  std::vector<std::string> neutral_paths;
+  std::vector<std::string> pleasant_paths;
+  std::vector<std::string> unpleasant_paths;
 };
 
-void BuildImageList(TextureManager &texture_manager, Shuffler<Image> &shuffler,
+Condition &FindCondition(int mark) {
+  for (Condition &condition : ConditionList) {
+    if (condition.mark == mark) {
+      return condition;
+    }
+  }
+
+  // should never happen
+  assert(false);
+  return ConditionList[0];
+}
+
+template <typename T>
+T *SelectCategory(char category, T *neutral, T *pleasant, T *unpleasant) {
+  switch (category) {
+    case kConditionNeutral:
+      return neutral;
+    case kConditionPleasant:
+      return pleasant;
+    case kConditionUnpleasant:
+      return unpleasant;
+    default:
+      // should never happen
+      assert(false);
+      return nullptr;
+  }
+}
+
+// Protects the images the schedule shows next, from this one in this
+// trial, and starts decoding any that aren't loaded.
+void SetUpcomingImages(SsvepState *state, size_t trial, int image) {
+  const std::vector<ScheduledTrial> &trials = state->schedule.trials;
+  std::vector<std::string> upcoming;
+  while (upcoming.size() < kUpcomingImages && trial < trials.size()) {
+    upcoming.push_back(state->image_paths[trials[trial].stimuli[image]]);
+    image++;
+    if (image == kNumCategories * kNumImagesPerCategory) {
+      image = 0;
+      trial++;
+    }
+  }
+
+  state->texture_manager->SetUpcoming(upcoming);
+}
+
+// Images are identified by their marks.
+std::vector<int> BuildImageIds(int image_mark_base, int image_count) {
+  std::vector<int> ids;
+  for (int i = 0; i < image_count; i++) {
+    ids.push_back(image_mark_base + i + 1);
+  }
+
+  return ids;
+}
+
+void BuildImageList(SsvepState *state, std::vector<std::string> *paths,
                     const std::string &image_folder,
                     const std::string &image_suffix, int image_mark_base,
                     int image_count) {
-  std::vector<Image> vector;
   for (int i = 0; i < image_count; i++) {
     std::string path =
         GetResourceDir() + image_folder + std::to_string(i + 1) + image_suffix;
-    Image image = {path, image_mark_base + i + 1};
-    // Pre-load images
-    texture_manager.LoadImage(path);
-    vector.push_back(image);
+    paths->push_back(path);
+    state->image_paths[image_mark_base + i + 1] = path;
   }
-  shuffler.AddCategoryElements(vector, 0);
 }
 
 class SsvepFixationScreen : public FixationDotScreen {
  public:
-  SsvepFixationScreen(std::shared_ptr<SsvepState> state, int min_delay,
-                      int max_delay)
-      : FixationDotScreen(min_delay, max_delay), state_(state) {}
+  // The delay comes from the schedule.
+  SsvepFixationScreen(std::shared_ptr<SsvepState> state)
+      : FixationDotScreen(0), state_(state) {}
 
-  void IsActive() override {
-    assert(!state_->shuffler.IsDone());
+  void Prefetch() override { state_->texture_manager->Poll(); }
 
+  void IsActive() override {
+    assert(state_->trial_count < state_->schedule.trials.size());
+    const ScheduledTrial &trial =
+        state_->schedule.trials[state_->trial_count];
     state_->trial_count += 1;
 
-    // Draw condition
-    int next = state_->shuffler.GetNextItem();
-    state_->next_condition = ConditionList[next].condition;
-    state_->next_condition_mark = ConditionList[next].mark;
+    Condition &condition = FindCondition(trial.condition);
+    state_->next_condition_mark = condition.mark;
     state_->num_images = 0;
     state_->next_condition_mark_sent = false;
     state_->first_image_mark_sent = false;
-
-    state_->neutral_shuffler.ShuffleElements();
-    state_->pleasant_shuffler.ShuffleElements();
-    state_->unpleasant_shuffler.ShuffleElements();
-
-    // Pre-load images
+    SetUpcomingImages(state_.get(), state_->trial_count - 1, 0);
     for (int i = 0; i < kNumCategories * kNumImagesPerCategory; i++) {
-      char category = state_->next_condition[i / kNumImagesPerCategory];
-      Shuffler<Image> *image_shuffler = nullptr;
-      switch (category) {
-        case kConditionNeutral:
-          image_shuffler = &state_->neutral_shuffler;
-          break;
-        case kConditionPleasant:
-          image_shuffler = &state_->pleasant_shuffler;
-          break;
-        case kConditionUnpleasant:
-          image_shuffler = &state_->unpleasant_shuffler;
-          break;
-        default:
-          // should never happen
-          assert(false);
-          break;
-      }
-      Image next_image = image_shuffler->GetNextItem();
-      state_->images[i] = state_->texture_manager.LoadImage(next_image.path);
-      state_->image_marks[i] = next_image.mark;
-      state_->dest_rects[i] =
-          ComputeRectForPhysicalWidth(state_->images[i], kImageWidthCm);
+      state_->image_marks[i] = trial.stimuli[i];
     }
   }
 
+ protected:
+  int GetDelayMs() override {
+    return state_->schedule.trials[state_->trial_count - 1].fixation_ms;
+  }
+
  private:
   std::shared_ptr<SsvepState> state_;
 };
@@ -183,10 +216,26 @@ class SsvepTrialScreen : public Screen {
  public:
   SsvepTrialScreen(std::shared_ptr<SsvepState> state) : state_(state) {}
 
+  void Prefetch() override { state_->texture_manager->Poll(); }
+
   void IsActive() override {
     state_->num_images += 1;
+
+    // Each image is loaded as it is shown, so that with a budget only the
+    // upcoming ones need to be resident. They were decoded in the
+    // background, so this is normally a cache hit.
+    int i = state_->num_images - 1;
+    state_->images[i] = state_->texture_manager->LoadImage(
+        state_->image_paths[state_->image_marks[i]]);
+    state_->dest_rects[i] =
+        ComputeRectForPhysicalWidth(state_->images[i], kImageWidthCm);
+    SetUpcomingImages(state_.get(), state_->trial_count - 1, i);
+
     if (state_->num_images == kNumCategories * kNumImagesPerCategory) {
-      if (state_->trial_count == kTotalTrials) {
+      if (state_->trial_count == state_->schedule.trials.size()) {
+        state_->texture_manager->LogStats("SSVEP");
+        // Running the task again repeats the schedule.
+        state_->trial_count = 0;
         SwitchToScreen(3, kImageTimeMs);
       } else if ((state_->trial_count % kNumTrialsBeforeBreak) == 0) {
         SwitchToScreen(2, kImageTimeMs);
@@ -202,9 +251,12 @@ class SsvepTrialScreen : public Screen {
     int i = state_->num_images - 1;
     Blit(state_->images[i], state_->dest_rects[i]);
     if (state_->next_condition_mark_sent && !state_->first_image_mark_sent &&
-        (SDL_GetTicks() - condition_mark_timestamp_) > 10) {
+        (GetTimeMicros() - condition_mark_timestamp_) > MsToMicros(10)) {
       SendMark(state_->image_marks[i]);
       state_->first_image_mark_sent = true;
+    } else if (state_->next_condition_mark_sent &&
+               !state_->first_image_mark_sent) {
+      ScheduleRender(condition_mark_timestamp_ + MsToMicros(10) + 1);
     }
   }
 
@@ -221,13 +273,14 @@ class SsvepTrialScreen : public Screen {
       // Need to timestamp this because the bioamp only caches one mark
       // at a time, so we must ensure the 2nd mark is sent out after at
       // least one sample passed (10ms for safety)
-      condition_mark_timestamp_ = SDL_GetTicks();
+      condition_mark_timestamp_ = GetTimeMicros();
+      ScheduleRender(condition_mark_timestamp_ + MsToMicros(10) + 1);
     }
   }
 
  private:
   std::shared_ptr<SsvepState> state_;
-  int condition_mark_timestamp_;
+  int64_t condition_mark_timestamp_;
 };
 
 class BreakScreen : public InstructionScreen {
@@ -239,44 +292,99 @@ class BreakScreen : public InstructionScreen {
 
 }  // namespace
 
-Screen *InitSsvep(Screen *main_screen, const Settings &settings) {
-  std::shared_ptr<SsvepState> state(new SsvepState{TextureManager(),
-                                                   Shuffler<int>(),
-                                                   Shuffler<Image>(),
-                                                   Shuffler<Image>(),
-                                                   Shuffler<Image>(),
-                                                   0,
-                                                   nullptr,
-                                                   0,
-                                                   false,
-                                                   false,
-                                                   0,
-                                                   {nullptr},
-                                                   {0},
-                                                   {{0, 0, 0, 0}}});
-
+TaskSchedule CompileSsvepSchedule(RandomStream *random) {
+  RandomStream fixation_random = random->Split();
+  Shuffler<int> conditions;
   for (int i = 0; i < kNumConditions; i++) {
     std::vector<int> t(kNumTrialsPerCondition);
-    std::fill(t.begin(), t.end(), i);
-    state->shuffler.AddCategoryElements(t, kMaxRun);
+    std::fill(t.begin(), t.end(), ConditionList[i].mark);
+    conditions.AddCategoryElements(t, kMaxRun);
+  }
+  conditions.ShuffleElements(random);
+
+  Shuffler<int> neutral;
+  Shuffler<int> pleasant;
+  Shuffler<int> unpleasant;
+  neutral.AddCategoryElements(
+      BuildImageIds(kMarkNeutralBase, kNumNeutralImages), 0);
+  pleasant.AddCategoryElements(
+      BuildImageIds(kMarkPleasantBase, kNumPleasantImages), 0);
+  unpleasant.AddCategoryElements(
+      BuildImageIds(kMarkUnpleasantBase, kNumUnpleasantImages), 0);
+
+  TaskSchedule schedule;
+  for (int trial_count = 1; trial_count <= kTotalTrials; trial_count++) {
+    ScheduledTrial trial;
+    trial.condition = conditions.GetNextItem();
+    trial.marks.push_back(trial.condition);
+
+    // Every category is reshuffled each trial, whether it is shown or not.
+    neutral.ShuffleElements(random);
+    pleasant.ShuffleElements(random);
+    unpleasant.ShuffleElements(random);
+    const char *condition = FindCondition(trial.condition).condition;
+    for (int i = 0; i < kNumCategories * kNumImagesPerCategory; i++) {
+      Shuffler<int> *images =
+          SelectCategory(condition[i / kNumImagesPerCategory], &neutral,
+                         &pleasant, &unpleasant);
+      trial.stimuli.push_back(images->GetNextItem());
+      trial.marks.push_back(trial.stimuli.back());
+    }
+
+    trial.fixation_ms = fixation_random.NextInt(kMinFixationTimeMs,
+                                                kMaxFixationTimeMs);
+    if (trial_count % kNumTrialsBeforeBreak == 0 &&
+        trial_count != kTotalTrials) {
+      trial.marks.push_back(kMarkBreak);
+    }
+
+    schedule.trials.push_back(trial);
   }
-  state->shuffler.ShuffleElements();
-
-  BuildImageList(state->texture_manager, state->neutral_shuffler,
-                 kNeutralImageFolder, kNeutralImageSuffix, kMarkNeutralBase,
-                 kNumNeutralImages);
-  BuildImageList(state->texture_manager, state->pleasant_shuffler,
-                 kPleasantImageFolder, kPleasantImageSuffix, kMarkPleasantBase,
-                 kNumPleasantImages);
-  BuildImageList(state->texture_manager, state->unpleasant_shuffler,
+
+  return schedule;
+}
+
+Screen *InitSsvep(Screen *main_screen, const Settings &settings,
+                  const TaskSchedule &schedule) {
+  Screen::WarnIfNotFrameMultiple("SSVEP image time", kImageTimeMs);
+
+  std::shared_ptr<SsvepState> state(new SsvepState());
+  state->schedule = schedule;
+  BuildImageList(state.get(), &state->neutral_paths, kNeutralImageFolder,
+                 kNeutralImageSuffix, kMarkNeutralBase, kNumNeutralImages);
+  BuildImageList(state.get(), &state->pleasant_paths, kPleasantImageFolder,
+                 kPleasantImageSuffix, kMarkPleasantBase, kNumPleasantImages);
+  BuildImageList(state.get(), &state->unpleasant_paths,
                  kUnpleasantImageFolder, kUnpleasantImageSuffix,
                  kMarkUnpleasantBase, kNumUnpleasantImages);
 
+  int64_t texture_budget_bytes = 0;
+  if (settings.HasKey(kTextureBudgetSetting)) {
+    texture_budget_bytes =
+        settings.GetIntValue(kTextureBudgetSetting) * kBytesPerMb;
+  }
+
+  state->texture_manager.reset(new TextureManager(texture_budget_bytes));
+  state->texture_manager->SetDecodeWidth(
+      Screen::HorzSizeToPixels(kImageWidthCm));
+  if (texture_budget_bytes == 0) {
+    // Pre-load images
+    std::vector<std::string> image_paths;
+    image_paths.insert(image_paths.end(), state->neutral_paths.begin(),
+                       state->neutral_paths.end());
+    image_paths.insert(image_paths.end(), state->pleasant_paths.begin(),
+                       state->pleasant_paths.end());
+    image_paths.insert(image_paths.end(), state->unpleasant_paths.begin(),
+                       state->unpleasant_paths.end());
+    state->texture_manager->LoadImages(image_paths);
+  } else {
+    SetUpcomingImages(state.get(), 0, 0);
+  }
+
   Screen *version = new VersionScreen();
   Screen *start = new MarkScreen(kMarkTaskStartStop);
   Screen *instructions = new InstructionScreen("View each image");
-  Screen *fixation =
-      new SsvepFixationScreen(state, kMinFixationTimeMs, kMaxFixationTimeMs);
+  Screen *fixation = new SsvepFixationScreen(state);
   // Need 2 instances of the trial screen so we can switch between them.
   Screen *trial1 = new SsvepTrialScreen(state);
   Screen *trial2 = new SsvepTrialScreen(state);
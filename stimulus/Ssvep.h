@@ -17,12 +17,18 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SSVEP_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SSVEP_H_
 
+#include "Random.h"
+#include "Schedule.h"
 #include "Screen.h"
 #include "Settings.h"
 
 namespace stimulus {
 
-Screen *InitSsvep(Screen *main_screen, const Settings &settings);
+// Draws every trial's condition, images and fixation time.
+TaskSchedule CompileSsvepSchedule(RandomStream *random);
+
+Screen *InitSsvep(Screen *main_screen, const Settings &settings,
+                  const TaskSchedule &schedule);
 
 }  // namespace stimulus
 
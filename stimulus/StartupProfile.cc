@@ -0,0 +1,225 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StartupProfile.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "Clock.h"
+#include "Util.h"
+#include "Version.h"
+
+namespace stimulus {
+namespace {
+
+const double kBytesPerMb = 1024 * 1024;
+
+struct Step {
+  const char *name;
+  int64_t start_us;
+  int64_t end_us;
+};
+
+struct ImageLoad {
+  std::string path;
+  int64_t decode_us = 0;
+  int64_t decoded_bytes = 0;
+  int64_t upload_us = 0;
+  int64_t texture_bytes = 0;
+  int textures = 0;
+};
+
+// Steps and image loads come from the decode threads as well.
+std::mutex profile_mutex;
+bool recording;
+std::string profile_name;
+int64_t profile_start_us;
+std::vector<Step> steps;
+std::vector<ImageLoad> images;
+std::map<std::string, size_t> image_indices;
+
+double MicrosToMs(int64_t time_us) {
+  return static_cast<double>(time_us) / kMicrosPerMs;
+}
+
+// Must be called with profile_mutex held.
+ImageLoad &GetImageLoad(const std::string &path) {
+  auto it = image_indices.find(path);
+  if (it == image_indices.end()) {
+    it = image_indices.emplace(path, images.size()).first;
+    images.emplace_back();
+    images.back().path = path;
+  }
+
+  return images[it->second];
+}
+
+std::string QuoteJson(const std::string &str) {
+  std::string quoted = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < ' ') {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+
+  return quoted + "\"";
+}
+
+// Must be called with profile_mutex held.
+void WriteProfile(const std::string &path, int64_t total_us) {
+  std::ofstream file(path);
+  file << std::fixed << std::setprecision(3);
+  file << "{\n";
+  file << "  \"file_type\": \"startup_profile\",\n";
+  file << "  \"name\": " << QuoteJson(profile_name) << ",\n";
+  file << "  \"date\": \"" << FormatDateString(GetDateTime()) << "\",\n";
+  file << "  \"version\": " << QuoteJson(kFullVersionString) << ",\n";
+  file << "  \"total_ms\": " << MicrosToMs(total_us) << ",\n";
+  file << "  \"steps\": [";
+  for (size_t i = 0; i < steps.size(); i++) {
+    const Step &step = steps[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << step.name
+         << "\", \"start_ms\": "
+         << MicrosToMs(step.start_us - profile_start_us)
+         << ", \"duration_ms\": " << MicrosToMs(step.end_us - step.start_us)
+         << "}";
+  }
+
+  file << "\n  ],\n";
+  file << "  \"images\": [";
+  for (size_t i = 0; i < images.size(); i++) {
+    const ImageLoad &image = images[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\"path\": "
+         << QuoteJson(image.path)
+         << ", \"decode_ms\": " << MicrosToMs(image.decode_us)
+         << ", \"decoded_bytes\": " << image.decoded_bytes
+         << ", \"upload_ms\": " << MicrosToMs(image.upload_us)
+         << ", \"textures\": " << image.textures
+         << ", \"texture_bytes\": " << image.texture_bytes << "}";
+  }
+
+  file << "\n  ]\n}\n";
+  if (!file) {
+    SDL_Log("Error writing startup profile %s\n", path.c_str());
+  }
+}
+
+}  // namespace
+
+void BeginStartupProfile(const std::string &name) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  recording = true;
+  profile_name = name;
+  profile_start_us = GetWallTimeMicros();
+  steps.clear();
+  images.clear();
+  image_indices.clear();
+}
+
+void EndStartupProfile(const std::string &directory) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  if (!recording) {
+    return;
+  }
+
+  recording = false;
+  int64_t total_us = GetWallTimeMicros() - profile_start_us;
+
+  // Steps are added when they end, so nested ones come first.
+  std::stable_sort(steps.begin(), steps.end(),
+                   [](const Step &a, const Step &b) {
+                     return a.start_us < b.start_us;
+                   });
+  if (!directory.empty()) {
+    WriteProfile(directory + profile_name + "_" +
+                     FormatDateString(GetDateTime()) + "_startup.json",
+                 total_us);
+  }
+
+  SDL_Log("%s took %.1f ms\n", profile_name.c_str(), MicrosToMs(total_us));
+  for (const Step &step : steps) {
+    SDL_Log("  %s: %.1f ms\n", step.name,
+            MicrosToMs(step.end_us - step.start_us));
+  }
+
+  if (!images.empty()) {
+    int64_t decoded_bytes = 0;
+    int64_t texture_bytes = 0;
+    int textures = 0;
+    const ImageLoad *slowest = &images[0];
+    for (const ImageLoad &image : images) {
+      decoded_bytes += image.decoded_bytes;
+      texture_bytes += image.texture_bytes;
+      textures += image.textures;
+      if (image.decode_us + image.upload_us >
+          slowest->decode_us + slowest->upload_us) {
+        slowest = &image;
+      }
+    }
+
+    SDL_Log("  %d images: %.1f MB decoded, %d textures (%.1f MB), "
+            "slowest %s (%.1f ms)\n", static_cast<int>(images.size()),
+            decoded_bytes / kBytesPerMb, textures, texture_bytes / kBytesPerMb,
+            slowest->path.c_str(),
+            MicrosToMs(slowest->decode_us + slowest->upload_us));
+  }
+}
+
+StartupScope::StartupScope(const char *name)
+    : name_(name), start_us_(GetWallTimeMicros()) {}
+
+StartupScope::~StartupScope() {
+  int64_t end_us = GetWallTimeMicros();
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  if (recording) {
+    steps.push_back(Step{name_, start_us_, end_us});
+  }
+}
+
+void AddProfiledDecode(const std::string &path, int64_t elapsed_us,
+                       int64_t bytes) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  if (recording) {
+    ImageLoad &image = GetImageLoad(path);
+    image.decode_us += elapsed_us;
+    image.decoded_bytes += bytes;
+  }
+}
+
+void AddProfiledUpload(const std::string &path, int64_t elapsed_us,
+                       int64_t bytes) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  if (recording) {
+    ImageLoad &image = GetImageLoad(path);
+    image.upload_us += elapsed_us;
+    image.texture_bytes += bytes;
+    image.textures++;
+  }
+}
+
+}  // namespace stimulus
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_STARTUPPROFILE_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_STARTUPPROFILE_H_
+
+#include <cstdint>
+#include <string>
+
+namespace stimulus {
+
+// Records how long each step of starting the program (or creating a task)
+// takes, and the images loaded during it, so startup regressions can be
+// tracked between versions. Unlike Trace, this is always on, but only
+// records between BeginStartupProfile and EndStartupProfile.
+//
+// Times are from the wall clock, so they are real even in a headless run.
+void BeginStartupProfile(const std::string &name);
+
+// Writes the profile to <directory>/<name>_<date>_startup.json, if there
+// is a directory, and logs a summary.
+void EndStartupProfile(const std::string &directory);
+
+// Records the enclosing block as a step of the profile. name must be a
+// string literal.
+class StartupScope {
+ public:
+  explicit StartupScope(const char *name);
+  ~StartupScope();
+
+ private:
+  const char *name_;
+  int64_t start_us_;
+};
+
+// Called by the image loader, from any thread. An image that is loaded
+// more than once has its times and sizes added together.
+void AddProfiledDecode(const std::string &path, int64_t elapsed_us,
+                       int64_t bytes);
+void AddProfiledUpload(const std::string &path, int64_t elapsed_us,
+                       int64_t bytes);
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_STARTUPPROFILE_H_
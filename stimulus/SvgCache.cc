@@ -0,0 +1,193 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SvgCache.h"
+
+#include <SDL_image.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace stimulus {
+namespace {
+
+// The header is the magic string, then the SDL pixel format, width and
+// height as little endian 32 bit integers. The rows follow, unpadded.
+const char kMagic[] = "AMBRSVG1";
+const size_t kMagicLength = sizeof(kMagic) - 1;
+const size_t kHeaderSize = kMagicLength + 12;
+const int kBytesPerPixel = 4;
+const int kMaxRasterSize = 16384;
+
+// Set at startup, before any images load.
+std::string cache_dir;
+
+// Makes temporary file names unique between decode threads.
+std::atomic<int> next_temp_file(0);
+
+void PutInt(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+uint32_t GetInt(const uint8_t *in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) |
+         (static_cast<uint32_t>(in[3]) << 24);
+}
+
+// 64 bit FNV-1a. The SDL_image version is included, since a different
+// version could draw the same source differently.
+uint64_t HashSource(const uint8_t *data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](uint8_t byte) {
+    hash = (hash ^ byte) * 1099511628211ull;
+  };
+
+  add(SDL_IMAGE_MAJOR_VERSION);
+  add(SDL_IMAGE_MINOR_VERSION);
+  add(SDL_IMAGE_PATCHLEVEL);
+  for (size_t i = 0; i < size; i++) {
+    add(data[i]);
+  }
+
+  return hash;
+}
+
+std::string GetCachePath(const uint8_t *data, size_t size, int width_px) {
+  char name[64];
+  snprintf(name, sizeof(name), "svg_%016llx_%d.raster",
+           static_cast<unsigned long long>(HashSource(data, size)), width_px);
+  return cache_dir + name;
+}
+
+// Returns null if there's no valid raster at path.
+SDL_Surface *ReadRaster(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+
+  uint8_t header[kHeaderSize];
+  SDL_Surface *surface = nullptr;
+  if (fread(header, kHeaderSize, 1, file) == 1 &&
+      memcmp(header, kMagic, kMagicLength) == 0) {
+    Uint32 format = GetInt(header + kMagicLength);
+    uint32_t width = GetInt(header + kMagicLength + 4);
+    uint32_t height = GetInt(header + kMagicLength + 8);
+    if (SDL_BYTESPERPIXEL(format) == kBytesPerPixel && width > 0 &&
+        width <= kMaxRasterSize && height > 0 && height <= kMaxRasterSize) {
+      surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, format);
+    }
+  }
+
+  for (int y = 0; surface != nullptr && y < surface->h; y++) {
+    if (fread(static_cast<uint8_t *>(surface->pixels) + y * surface->pitch,
+              surface->w * kBytesPerPixel, 1, file) != 1) {
+      // Truncated, e.g. the disk filled up.
+      SDL_FreeSurface(surface);
+      surface = nullptr;
+    }
+  }
+
+  fclose(file);
+  return surface;
+}
+
+// Writes to a temporary file first, so another thread or process never
+// reads a partial raster.
+void WriteRaster(const std::string &path, const SDL_Surface *surface) {
+  if (surface->format->BytesPerPixel != kBytesPerPixel) {
+    return;
+  }
+
+  std::string temp_path = path + "." + std::to_string(next_temp_file++) +
+                          ".tmp";
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  if (file == nullptr) {
+    return;
+  }
+
+  uint8_t header[kHeaderSize];
+  memcpy(header, kMagic, kMagicLength);
+  PutInt(header + kMagicLength, surface->format->format);
+  PutInt(header + kMagicLength + 4, surface->w);
+  PutInt(header + kMagicLength + 8, surface->h);
+  bool ok = fwrite(header, kHeaderSize, 1, file) == 1;
+  for (int y = 0; ok && y < surface->h; y++) {
+    ok = fwrite(static_cast<const uint8_t *>(surface->pixels) +
+                    y * surface->pitch,
+                surface->w * kBytesPerPixel, 1, file) == 1;
+  }
+
+  ok = fclose(file) == 0 && ok;
+
+  // On Windows, rename fails if another thread got there first.
+  if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+    remove(temp_path.c_str());
+  }
+}
+
+SDL_Surface *Rasterize(const uint8_t *data, size_t size, int width_px) {
+  SDL_RWops *source = SDL_RWFromConstMem(data, static_cast<int>(size));
+  SDL_Surface *surface;
+#ifdef SDL_IMAGE_VERSION_ATLEAST
+#if SDL_IMAGE_VERSION_ATLEAST(2, 6, 0)
+  if (width_px > 0) {
+    // A height of 0 keeps the aspect ratio.
+    surface = IMG_LoadSizedSVG_RW(source, width_px, 0);
+    SDL_RWclose(source);
+    return surface;
+  }
+#endif
+#endif
+
+  surface = IMG_LoadTyped_RW(source, 1, "SVG");
+  return surface;
+}
+
+}  // namespace
+
+void SetSvgCacheDirectory(const std::string &dir) {
+  cache_dir = dir;
+}
+
+SDL_Surface *LoadSvg(const uint8_t *data, size_t size, int width_px,
+                     bool *cached, std::string *error) {
+  *cached = false;
+  std::string path;
+  if (!cache_dir.empty()) {
+    path = GetCachePath(data, size, width_px);
+    SDL_Surface *surface = ReadRaster(path);
+    if (surface != nullptr) {
+      *cached = true;
+      return surface;
+    }
+  }
+
+  SDL_Surface *surface = Rasterize(data, size, width_px);
+  if (surface == nullptr) {
+    *error = IMG_GetError();
+    return nullptr;
+  }
+
+  if (!path.empty()) {
+    WriteRaster(path, surface);
+  }
+
+  return surface;
+}
+
+}  // namespace stimulus
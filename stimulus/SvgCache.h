@@ -0,0 +1,45 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SVGCACHE_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SVGCACHE_H_
+
+#include <SDL.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace stimulus {
+
+// Rasterizing an SVG (the font atlas is 6060x120, and each HotButton dial
+// 600x600) takes far longer than reading back the pixels, and the result
+// only depends on the source and the size it is drawn at. So rasters are
+// saved in this directory, named by a hash of the source (and the SDL_image
+// version) and the pixel width, and read back on later runs. Without a
+// directory, every SVG is rasterized.
+void SetSvgCacheDirectory(const std::string &dir);
+
+// Rasterizes the SVG in data, at width_px if that's set (and SDL_image
+// supports it), otherwise at its own size. cached is set if it came from
+// the cache. Returns null and sets error if it couldn't be rasterized.
+// Safe to call from any thread.
+SDL_Surface *LoadSvg(const uint8_t *data, size_t size, int width_px,
+                     bool *cached, std::string *error);
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_SVGCACHE_H_
@@ -0,0 +1,118 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <dirent.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "SvgCache.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const char kWhiteSvg[] =
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"8\" height=\"4\">"
+    "<rect width=\"8\" height=\"4\" fill=\"#fff\"/></svg>";
+const char kBlackSvg[] =
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"8\" height=\"4\">"
+    "<rect width=\"8\" height=\"4\" fill=\"#000\"/></svg>";
+
+// Caches rasters in a temporary directory while it exists.
+class TempCacheDirectory {
+ public:
+  TempCacheDirectory() {
+    char dir[] = "/tmp/svg_cache_testXXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+    stimulus::SetSvgCacheDirectory(dir_ + "/");
+  }
+
+  ~TempCacheDirectory() {
+    stimulus::SetSvgCacheDirectory("");
+    if (DIR *handle = opendir(dir_.c_str())) {
+      while (dirent *entry = readdir(handle)) {
+        if (entry->d_name[0] != '.') {
+          unlink((dir_ + "/" + entry->d_name).c_str());
+        }
+      }
+
+      closedir(handle);
+    }
+
+    rmdir(dir_.c_str());
+  }
+
+ private:
+  std::string dir_;
+};
+
+// Returns whether the raster came from the cache.
+bool LoadCached(const char *svg, int width_px) {
+  bool cached = true;
+  std::string error;
+  SDL_Surface *surface = stimulus::LoadSvg(
+      reinterpret_cast<const uint8_t *>(svg), strlen(svg), width_px, &cached,
+      &error);
+  BOOST_REQUIRE_MESSAGE(surface != nullptr, error);
+  SDL_FreeSurface(surface);
+  return cached;
+}
+
+// The second load reads back what the first one drew.
+BOOST_AUTO_TEST_CASE(CachedRasterMatches) {
+  TempCacheDirectory cache;
+  bool cached;
+  std::string error;
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(kWhiteSvg);
+  SDL_Surface *drawn = stimulus::LoadSvg(data, strlen(kWhiteSvg), 16,
+                                         &cached, &error);
+  BOOST_REQUIRE(drawn != nullptr);
+  SDL_Surface *read = stimulus::LoadSvg(data, strlen(kWhiteSvg), 16,
+                                        &cached, &error);
+  BOOST_REQUIRE(read != nullptr);
+  BOOST_CHECK(cached);
+  BOOST_CHECK_EQUAL(read->format->format, drawn->format->format);
+  BOOST_REQUIRE_EQUAL(read->w, drawn->w);
+  BOOST_REQUIRE_EQUAL(read->h, drawn->h);
+  for (int y = 0; y < drawn->h; y++) {
+    BOOST_CHECK(memcmp(static_cast<uint8_t *>(read->pixels) + y * read->pitch,
+                       static_cast<uint8_t *>(drawn->pixels) + y * drawn->pitch,
+                       drawn->w * 4) == 0);
+  }
+
+  SDL_FreeSurface(drawn);
+  SDL_FreeSurface(read);
+}
+
+BOOST_AUTO_TEST_CASE(ChangesMissTheCache) {
+  TempCacheDirectory cache;
+  BOOST_CHECK(!LoadCached(kWhiteSvg, 16));
+
+  // A different source or size is rasterized again, and cached itself.
+  BOOST_CHECK(!LoadCached(kBlackSvg, 16));
+  BOOST_CHECK(!LoadCached(kWhiteSvg, 32));
+  BOOST_CHECK(LoadCached(kBlackSvg, 16));
+  BOOST_CHECK(LoadCached(kWhiteSvg, 32));
+  BOOST_CHECK(LoadCached(kWhiteSvg, 16));
+}
+
+BOOST_AUTO_TEST_CASE(NoDirectoryMeansNoCache) {
+  stimulus::SetSvgCacheDirectory("");
+  BOOST_CHECK(!LoadCached(kWhiteSvg, 16));
+  BOOST_CHECK(!LoadCached(kWhiteSvg, 16));
+}
+
+}  // namespace
@@ -0,0 +1,141 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TaskSchedules.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "Calibration.h"
+#include "EmotionalImages.h"
+#include "Random.h"
+#include "Sret.h"
+#include "Ssvep.h"
+
+namespace stimulus {
+namespace {
+
+struct ScheduledTask {
+  const char *name;
+  TaskSchedule (*compile)(RandomStream *random);
+};
+
+const ScheduledTask kScheduledTasks[] = {
+    {"SSVEP", CompileSsvepSchedule},
+    {"Oddball", CompileOddballSchedule},
+    {"SRET", CompileSretSchedule},
+    {"Emotional Images", CompileEmotionalImagesSchedule},
+};
+
+std::vector<int> GetSortedConditions(const TaskSchedule &task) {
+  std::vector<int> conditions;
+  for (const ScheduledTrial &trial : task.trials) {
+    conditions.push_back(trial.condition);
+  }
+
+  std::sort(conditions.begin(), conditions.end());
+  return conditions;
+}
+
+bool CheckTaskSchedule(const TaskSchedule &task, uint32_t seed,
+                       std::string *error) {
+  TaskSchedule expected = CompileTaskSchedule(task.task, seed);
+  if (expected.trials.empty()) {
+    *error = "unknown task '" + task.task + "'";
+    return false;
+  } else if (task.trials.size() != expected.trials.size()) {
+    *error = task.task + " has " + std::to_string(task.trials.size()) +
+             " trials instead of " + std::to_string(expected.trials.size());
+    return false;
+  } else if (GetSortedConditions(task) != GetSortedConditions(expected)) {
+    *error = task.task + " has the wrong number of trials per condition";
+    return false;
+  }
+
+  // A trial may only show the stimuli of its own condition (e.g. an SSVEP
+  // "np" trial only neutral and pleasant images), which are the ones the
+  // compiled schedule shows in that condition's trials.
+  std::map<int, std::set<int>> condition_stimuli;
+  for (const ScheduledTrial &trial : expected.trials) {
+    condition_stimuli[trial.condition].insert(trial.stimuli.begin(),
+                                              trial.stimuli.end());
+  }
+
+  for (size_t i = 0; i < task.trials.size(); i++) {
+    const ScheduledTrial &trial = task.trials[i];
+    const std::set<int> &stimuli = condition_stimuli[trial.condition];
+    bool known = std::all_of(
+        trial.stimuli.begin(), trial.stimuli.end(),
+        [&stimuli](int stimulus) { return stimuli.count(stimulus) > 0; });
+    if (trial.stimuli.size() != expected.trials[i].stimuli.size() || !known ||
+        trial.fixation_ms < 0) {
+      *error = task.task + " trial " + std::to_string(i + 1) +
+               " doesn't match the task";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+const std::vector<std::string> &GetScheduledTasks() {
+  static const std::vector<std::string> names = [] {
+    std::vector<std::string> result;
+    for (const ScheduledTask &task : kScheduledTasks) {
+      result.push_back(task.name);
+    }
+
+    return result;
+  }();
+
+  return names;
+}
+
+TaskSchedule CompileTaskSchedule(const std::string &task, uint32_t seed) {
+  for (const ScheduledTask &scheduled : kScheduledTasks) {
+    if (task == scheduled.name) {
+      RandomStream random(seed, task);
+      TaskSchedule result = scheduled.compile(&random);
+      result.task = task;
+      return result;
+    }
+  }
+
+  return TaskSchedule();
+}
+
+Schedule CompileSchedule(uint32_t seed) {
+  Schedule schedule;
+  schedule.seed = seed;
+  for (const std::string &task : GetScheduledTasks()) {
+    schedule.tasks.push_back(CompileTaskSchedule(task, seed));
+  }
+
+  return schedule;
+}
+
+bool CheckSchedule(const Schedule &schedule, std::string *error) {
+  for (const TaskSchedule &task : schedule.tasks) {
+    if (!CheckTaskSchedule(task, schedule.seed, error)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace stimulus
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TASKSCHEDULES_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TASKSCHEDULES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Schedule.h"
+
+namespace stimulus {
+
+// The tasks whose trials don't depend on responses, so they can be drawn
+// before the task runs.
+const std::vector<std::string> &GetScheduledTasks();
+
+// Each task draws from its own stream, named for the task, so a task's
+// trials don't depend on which tasks ran before it, and a schedule
+// compiled ahead of time matches one compiled when the task is selected.
+TaskSchedule CompileTaskSchedule(const std::string &task, uint32_t seed);
+
+Schedule CompileSchedule(uint32_t seed);
+
+// Returns false, with a message in error, if a loaded schedule doesn't
+// have the shape of the one this build would compile (e.g. it was
+// compiled by a version with a different number of trials).
+bool CheckSchedule(const Schedule &schedule, std::string *error);
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TASKSCHEDULES_H_
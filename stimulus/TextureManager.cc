@@ -0,0 +1,214 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Clock.h"
+
+namespace stimulus {
+namespace {
+
+// Decoded surfaces waiting for upload take memory too, so only keep a few
+// in flight.
+const int kMaxDecodesInFlight = 8;
+
+const double kBytesPerMb = 1024 * 1024;
+
+int64_t GetTextureBytes(SDL_Texture *texture) {
+  Uint32 format;
+  int width;
+  int height;
+  if (SDL_QueryTexture(texture, &format, nullptr, &width, &height) != 0) {
+    return 0;
+  }
+
+  int64_t pixels = static_cast<int64_t>(width) * height;
+  if (format == SDL_PIXELFORMAT_IYUV) {
+    // A full resolution Y plane and quarter resolution U and V planes.
+    return pixels * 3 / 2;
+  }
+
+  // Drivers generally pad 24 bit formats to 32.
+  return pixels * 4;
+}
+
+}  // namespace
+
+TextureManager::~TextureManager() {
+  for (auto &n : textures_) {
+    SDL_DestroyTexture(n.second.texture);
+  }
+}
+
+SDL_Texture *TextureManager::LoadImage(const std::string &filename) {
+  auto it = textures_.find(filename);
+  if (it != textures_.end()) {
+    stats_.hits++;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return it->second.texture;
+  }
+
+  stats_.misses++;
+  int64_t start = GetWallTimeMicros();
+  SDL_Texture *texture;
+  auto decode = decodes_.find(filename);
+  if (decode != decodes_.end()) {
+    texture = UploadImage(decode->second.get());
+    decodes_.erase(decode);
+  } else {
+    texture = stimulus::LoadImage(filename, decode_width_px_);
+  }
+
+  int64_t stall = GetWallTimeMicros() - start;
+  stats_.total_stall_us += stall;
+  stats_.max_stall_us = std::max(stats_.max_stall_us, stall);
+  if (texture != nullptr) {
+    Insert(filename, texture);
+    EvictToBudget(filename);
+  }
+
+  StartDecodes();
+  return texture;
+}
+
+void TextureManager::LoadImages(const std::vector<std::string> &filenames) {
+  std::unordered_set<std::string> requested;
+  std::vector<std::future<DecodedImage>> decodes;
+  for (const std::string &filename : filenames) {
+    if (textures_.count(filename) == 0 && decodes_.count(filename) == 0 &&
+        requested.insert(filename).second) {
+      decodes.push_back(DecodeImageAsync(filename, decode_width_px_));
+    }
+  }
+
+  for (auto &decode : decodes) {
+    DecodedImage image = decode.get();
+    std::string filename = image.path;
+    SDL_Texture *texture = UploadImage(std::move(image));
+    if (texture != nullptr) {
+      Insert(filename, texture);
+    }
+  }
+
+  EvictToBudget("");
+}
+
+void TextureManager::SetUpcoming(const std::vector<std::string> &filenames) {
+  upcoming_.clear();
+  decode_queue_.clear();
+  for (const std::string &filename : filenames) {
+    if (upcoming_.insert(filename).second && textures_.count(filename) == 0 &&
+        decodes_.count(filename) == 0) {
+      decode_queue_.push_back(filename);
+    }
+  }
+
+  // Drop anything no longer needed to make room for what is.
+  EvictToBudget("");
+  StartDecodes();
+}
+
+void TextureManager::Poll() {
+  for (;;) {
+    auto it = std::find_if(decodes_.begin(), decodes_.end(),
+        [](const std::pair<const std::string, std::future<DecodedImage>> &n) {
+          return n.second.wait_for(std::chrono::seconds(0)) ==
+                 std::future_status::ready;
+        });
+    if (it == decodes_.end()) {
+      return;
+    }
+
+    std::string filename = it->first;
+    DecodedImage image = it->second.get();
+    decodes_.erase(it);
+    if (budget_bytes_ > 0 && upcoming_.count(filename) == 0) {
+      // No longer needed
+      StartDecodes();
+      continue;
+    }
+
+    SDL_Texture *texture = UploadImage(std::move(image));
+    if (texture != nullptr) {
+      Insert(filename, texture);
+      EvictToBudget("");
+    }
+
+    StartDecodes();
+    return;
+  }
+}
+
+void TextureManager::LogStats(const char *label) {
+  int lookups = stats_.hits + stats_.misses;
+  if (lookups > 0) {
+    SDL_Log("%s textures: %d hits, %d misses (%.1f%% hit rate), "
+            "%d evictions, %.1f MB resident (peak %.1f MB), stalled %.1f ms "
+            "total (max %.1f ms)\n", label, stats_.hits, stats_.misses,
+            100.0 * stats_.hits / lookups, stats_.evictions,
+            resident_bytes_ / kBytesPerMb, stats_.peak_bytes / kBytesPerMb,
+            static_cast<double>(stats_.total_stall_us) / kMicrosPerMs,
+            static_cast<double>(stats_.max_stall_us) / kMicrosPerMs);
+  }
+
+  stats_ = Stats();
+  stats_.peak_bytes = resident_bytes_;
+}
+
+void TextureManager::Insert(const std::string &filename,
+                            SDL_Texture *texture) {
+  lru_.push_front(filename);
+  int64_t bytes = GetTextureBytes(texture);
+  textures_[filename] = Entry{texture, bytes, lru_.begin()};
+  resident_bytes_ += bytes;
+  stats_.peak_bytes = std::max(stats_.peak_bytes, resident_bytes_);
+}
+
+void TextureManager::EvictToBudget(const std::string &keep) {
+  if (budget_bytes_ == 0) {
+    return;
+  }
+
+  auto it = lru_.end();
+  while (resident_bytes_ > budget_bytes_ && it != lru_.begin()) {
+    --it;
+    if (*it == keep || upcoming_.count(*it) > 0) {
+      continue;
+    }
+
+    auto entry = textures_.find(*it);
+    SDL_DestroyTexture(entry->second.texture);
+    resident_bytes_ -= entry->second.bytes;
+    textures_.erase(entry);
+    it = lru_.erase(it);
+    stats_.evictions++;
+  }
+}
+
+void TextureManager::StartDecodes() {
+  while (!decode_queue_.empty() &&
+         decodes_.size() < static_cast<size_t>(kMaxDecodesInFlight)) {
+    const std::string &filename = decode_queue_.front();
+    if (textures_.count(filename) == 0 && decodes_.count(filename) == 0) {
+      decodes_.emplace(filename, DecodeImageAsync(filename, decode_width_px_));
+    }
+
+    decode_queue_.pop_front();
+  }
+}
+
+}  // namespace stimulus
@@ -17,36 +17,95 @@
 #ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TEXTUREMANAGER_H_
 #define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TEXTUREMANAGER_H_
 
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "Image.h"
 
 namespace stimulus {
 
+// Caches image textures by filename. By default everything stays loaded.
+// With a budget, the least recently used textures are destroyed to stay
+// under it, except for the ones in the upcoming list: a texture returned by
+// LoadImage is only guaranteed to stay valid while it's upcoming.
 class TextureManager {
  public:
-  TextureManager() {}
-  ~TextureManager() {
-    for (auto &n : map_) {
-      SDL_DestroyTexture(n.second);
-    }
-    map_.clear();
+  explicit TextureManager(int64_t budget_bytes = 0)
+      : budget_bytes_(budget_bytes) {}
+  ~TextureManager();
+
+  SDL_Texture *LoadImage(const std::string &filename);
+
+  // Images loaded after this are shrunk to this width while decoding (see
+  // stimulus::LoadImage).
+  void SetDecodeWidth(int width_px) {
+    decode_width_px_ = width_px;
   }
 
-  SDL_Texture *LoadImage(const std::string &filename) {
-    if (map_.count(filename) > 0) {
-      return map_.at(filename);
-    }
-    SDL_Texture *texture = stimulus::LoadImage(filename);
-    map_.insert({filename, texture});
-    return texture;
+  // Decodes any images that aren't loaded yet in parallel, then uploads
+  // them in order.
+  void LoadImages(const std::vector<std::string> &filenames);
+
+  // The files that will be needed next, in the order they'll be used (e.g.
+  // from Shuffler::PeekNextItems). These are protected from eviction, and
+  // any that aren't loaded are decoded in the background.
+  void SetUpcoming(const std::vector<std::string> &filenames);
+
+  // Uploads at most one image that has finished decoding. This should be
+  // called every frame while images are being prefetched, e.g. from
+  // Screen::Prefetch.
+  void Poll();
+
+  // Logs the hit rate, memory use, and time spent waiting for images since
+  // the last call.
+  void LogStats(const char *label);
+
+  // Whether the texture for filename is loaded, so it would be returned
+  // without waiting.
+  bool IsLoaded(const std::string &filename) const {
+    return textures_.count(filename) > 0;
   }
 
  private:
-  std::unordered_map<std::string, SDL_Texture *> map_;
+  struct Entry {
+    SDL_Texture *texture;
+    int64_t bytes;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  struct Stats {
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+    int64_t peak_bytes = 0;
+    int64_t total_stall_us = 0;
+    int64_t max_stall_us = 0;
+  };
+
+  void Insert(const std::string &filename, SDL_Texture *texture);
+  void EvictToBudget(const std::string &keep);
+  void StartDecodes();
+
+  int64_t budget_bytes_;
+  int decode_width_px_ = 0;
+  int64_t resident_bytes_ = 0;
+  std::unordered_map<std::string, Entry> textures_;
+
+  // Most recently used first
+  std::list<std::string> lru_;
+
+  std::unordered_set<std::string> upcoming_;
+  std::deque<std::string> decode_queue_;
+  std::unordered_map<std::string, std::future<DecodedImage>> decodes_;
+  Stats stats_;
 };
 
 }  // namespace stimulus
 
-#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TEXTUREMANAGER_UTIL_H_
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TEXTUREMANAGER_H_
@@ -0,0 +1,150 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InputScript.h"
+#include "Screen.h"
+#include "TextureManager.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int kImageSizePx = 16;
+const int kNumImages = 5;
+const int kBudgetImages = 3;
+const int kDecodeTimeoutMs = 5000;
+
+// Textures are uploaded to the display's renderer, so a headless display is
+// set up the first time one is needed.
+void InitHeadlessDisplay() {
+  static stimulus::InputScript script("/dev/null");
+  static bool initialized = false;
+  if (!initialized) {
+    stimulus::Screen::SetHeadless(&script);
+    initialized = stimulus::Screen::InitDisplay(30, 20);
+  }
+
+  BOOST_REQUIRE(initialized);
+}
+
+// Images of the same size in a temporary directory.
+class TestImages {
+ public:
+  TestImages() {
+    InitHeadlessDisplay();
+    char dir[] = "/tmp/texture_manager_testXXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir) != nullptr);
+    dir_ = dir;
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, kImageSizePx, kImageSizePx, 32, SDL_PIXELFORMAT_ARGB8888);
+    BOOST_REQUIRE(surface != nullptr);
+    for (int i = 0; i < kNumImages; i++) {
+      paths_.push_back(dir_ + "/" + std::to_string(i) + ".bmp");
+      BOOST_REQUIRE(SDL_SaveBMP(surface, paths_.back().c_str()) == 0);
+    }
+
+    SDL_FreeSurface(surface);
+  }
+
+  ~TestImages() {
+    for (const std::string &path : paths_) {
+      unlink(path.c_str());
+    }
+
+    rmdir(dir_.c_str());
+  }
+
+  const std::string &GetPath(int index) const {
+    return paths_[index];
+  }
+
+  // Budget for this many of the images, as the manager counts them.
+  int64_t GetBudget(int num_images) const {
+    stimulus::TextureManager probe;
+    SDL_Texture *texture = probe.LoadImage(paths_[0]);
+    BOOST_REQUIRE(texture != nullptr);
+    int width;
+    int height;
+    BOOST_REQUIRE(SDL_QueryTexture(texture, nullptr, nullptr, &width,
+                                   &height) == 0);
+    return static_cast<int64_t>(width) * height * 4 * num_images;
+  }
+
+ private:
+  std::string dir_;
+  std::vector<std::string> paths_;
+};
+
+BOOST_AUTO_TEST_CASE(EvictsLeastRecentlyUsed) {
+  TestImages images;
+  stimulus::TextureManager textures(images.GetBudget(kBudgetImages));
+  for (int i = 0; i < kBudgetImages; i++) {
+    BOOST_REQUIRE(textures.LoadImage(images.GetPath(i)) != nullptr);
+  }
+
+  // Using the first image again leaves the second least recently used.
+  textures.LoadImage(images.GetPath(0));
+  BOOST_REQUIRE(textures.LoadImage(images.GetPath(3)) != nullptr);
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(0)));
+  BOOST_CHECK(!textures.IsLoaded(images.GetPath(1)));
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(2)));
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(3)));
+}
+
+BOOST_AUTO_TEST_CASE(KeepsUpcomingTextures) {
+  TestImages images;
+  stimulus::TextureManager textures(images.GetBudget(kBudgetImages));
+  for (int i = 0; i < kBudgetImages; i++) {
+    BOOST_REQUIRE(textures.LoadImage(images.GetPath(i)) != nullptr);
+  }
+
+  // The two least recently used images are upcoming, so going past the
+  // budget twice evicts the others.
+  textures.SetUpcoming({images.GetPath(0), images.GetPath(1)});
+  BOOST_REQUIRE(textures.LoadImage(images.GetPath(3)) != nullptr);
+  BOOST_REQUIRE(textures.LoadImage(images.GetPath(4)) != nullptr);
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(0)));
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(1)));
+  BOOST_CHECK(!textures.IsLoaded(images.GetPath(2)));
+  BOOST_CHECK(!textures.IsLoaded(images.GetPath(3)));
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(4)));
+}
+
+BOOST_AUTO_TEST_CASE(LoadsUpcomingInBackground) {
+  TestImages images;
+  stimulus::TextureManager textures(images.GetBudget(kBudgetImages));
+  textures.SetUpcoming({images.GetPath(0), images.GetPath(1)});
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(kDecodeTimeoutMs);
+  while (!(textures.IsLoaded(images.GetPath(0)) &&
+           textures.IsLoaded(images.GetPath(1))) &&
+         std::chrono::steady_clock::now() < deadline) {
+    textures.Poll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(0)));
+  BOOST_CHECK(textures.IsLoaded(images.GetPath(1)));
+  BOOST_CHECK(!textures.IsLoaded(images.GetPath(2)));
+}
+
+}  // namespace
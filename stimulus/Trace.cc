@@ -0,0 +1,340 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Trace.h"
+
+#include <SDL.h>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Clock.h"
+#include "Util.h"
+
+namespace stimulus {
+namespace {
+
+// At 60Hz the main loop records about 8 events per frame, so this holds
+// the last 9 minutes or so.
+const size_t kTraceEventsPerThread = 1 << 16;
+
+const char *kFrameEvent = "Frame";
+const char *kOverBudgetEvent = "OverBudget";
+const char *kPresentEvent = "Present";
+
+struct TraceEvent {
+  const char *name;
+  const std::type_info *object;
+  int64_t start_us;
+  int64_t end_us;  // Same as start_us for instant events
+  int64_t cpu_us;  // Only for frames
+  int draw_calls;  // Only for frames
+};
+
+struct TraceBuffer {
+  TraceBuffer(int id, const char *name)
+      : thread_id(id), thread_name(name), events(kTraceEventsPerThread) {}
+
+  TraceEvent &Append() {
+    TraceEvent &event = events[count % events.size()];
+    count++;
+    return event;
+  }
+
+  const TraceEvent &Get(size_t index) const {
+    return events[index % events.size()];
+  }
+
+  // Index of the oldest event that hasn't been overwritten.
+  size_t GetFirstIndex() const {
+    return count > events.size() ? count - events.size() : 0;
+  }
+
+  int thread_id;
+  const char *thread_name;
+  std::vector<TraceEvent> events;
+  size_t count = 0;
+
+  // Events are only added by the buffer's own thread, but WriteTrace and
+  // ResetTrace run on the main thread while others (like the mark
+  // dispatcher) may still be adding them. Uncontended except then.
+  std::mutex mutex;
+};
+
+// Read by every thread that records events.
+std::atomic<bool> tracing_enabled(false);
+std::string trace_directory;
+
+// Protects the list of buffers, not their contents.
+std::mutex trace_buffers_mutex;
+std::vector<std::unique_ptr<TraceBuffer>> trace_buffers;
+thread_local TraceBuffer *thread_trace_buffer;
+thread_local const char *thread_trace_name = "thread";
+
+// Main loop frame in progress.
+size_t frame_first_event;
+int64_t frame_start_us;
+
+TraceBuffer *GetThreadTraceBuffer() {
+  if (thread_trace_buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+    int id = static_cast<int>(trace_buffers.size()) + 1;
+    thread_trace_buffer = new TraceBuffer(id, thread_trace_name);
+    trace_buffers.emplace_back(thread_trace_buffer);
+  }
+
+  return thread_trace_buffer;
+}
+
+// Returns the unqualified class name.
+std::string GetClassName(const std::type_info *type) {
+  std::string name = type->name();
+#ifdef __GNUG__
+  int status;
+  char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr,
+                                        &status);
+  if (status == 0) {
+    name = demangled;
+  }
+
+  free(demangled);
+#endif
+
+  size_t separator = name.rfind("::");
+  if (separator != std::string::npos) {
+    name = name.substr(separator + 2);
+  }
+
+  return name;
+}
+
+}  // namespace
+
+void EnableTracing(const std::string &directory) {
+  trace_directory = directory;
+  tracing_enabled = true;
+
+  // Allocate the buffer now rather than in the first frame.
+  GetThreadTraceBuffer();
+}
+
+bool IsTracingEnabled() {
+  return tracing_enabled;
+}
+
+void SetTraceThreadName(const char *name) {
+  thread_trace_name = name;
+  if (thread_trace_buffer != nullptr) {
+    thread_trace_buffer->thread_name = name;
+  }
+}
+
+void AddTraceEvent(const char *name, const std::type_info *object,
+                   int64_t start_us, int64_t end_us) {
+  if (!tracing_enabled) {
+    return;
+  }
+
+  TraceBuffer *buffer = GetThreadTraceBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  TraceEvent &event = buffer->Append();
+  event.name = name;
+  event.object = object;
+  event.start_us = start_us;
+  event.end_us = end_us;
+  event.cpu_us = 0;
+  event.draw_calls = 0;
+}
+
+TraceScope::TraceScope(const char *name, const std::type_info *object)
+    : name_(name), object_(object),
+      start_us_(tracing_enabled ? GetTimeMicros() : 0) {}
+
+TraceScope::~TraceScope() {
+  if (tracing_enabled) {
+    AddTraceEvent(name_, object_, start_us_, GetTimeMicros());
+  }
+}
+
+void BeginTraceFrame() {
+  if (tracing_enabled) {
+    TraceBuffer *buffer = GetThreadTraceBuffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    frame_first_event = buffer->count;
+    frame_start_us = GetTimeMicros();
+  }
+}
+
+void EndTraceFrame(int64_t budget_us, int draw_calls) {
+  if (!tracing_enabled) {
+    return;
+  }
+
+  int64_t now = GetTimeMicros();
+  TraceBuffer *buffer = GetThreadTraceBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  int64_t present_us = 0;
+  int64_t slowest_us = -1;
+  const std::type_info *slowest_object = nullptr;
+  size_t first = std::max(frame_first_event, buffer->GetFirstIndex());
+  for (size_t i = first; i < buffer->count; i++) {
+    const TraceEvent &event = buffer->Get(i);
+    int64_t duration = event.end_us - event.start_us;
+    if (strcmp(event.name, kPresentEvent) == 0) {
+      present_us += duration;
+    } else if (duration > slowest_us) {
+      slowest_us = duration;
+      slowest_object = event.object;
+    }
+  }
+
+  int64_t cpu_us = now - frame_start_us - present_us;
+  TraceEvent &frame = buffer->Append();
+  frame.name = kFrameEvent;
+  frame.object = nullptr;
+  frame.start_us = frame_start_us;
+  frame.end_us = now;
+  frame.cpu_us = cpu_us;
+  frame.draw_calls = draw_calls;
+
+  if (cpu_us > budget_us) {
+    TraceEvent &over = buffer->Append();
+    over.name = kOverBudgetEvent;
+    over.object = slowest_object;
+    over.start_us = now;
+    over.end_us = now;
+    over.cpu_us = cpu_us;
+    over.draw_calls = draw_calls;
+  }
+}
+
+void ResetTrace() {
+  std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+  for (auto &buffer : trace_buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->count = 0;
+  }
+}
+
+void WriteTrace(const std::string &task) {
+  if (!tracing_enabled) {
+    return;
+  }
+
+  std::string path = trace_directory + task + "_" +
+                     FormatDateString(GetDateTime()) + "_trace.json";
+  std::ofstream trace_file(path);
+  if (!trace_file) {
+    SDL_Log("Couldn't open trace file %s\n", path.c_str());
+    ResetTrace();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+  std::map<const std::type_info *, std::string> class_names;
+  std::map<std::string, int> over_budget_counts;
+  int num_frames = 0;
+  int num_over_budget = 0;
+  int64_t total_draw_calls = 0;
+  int max_draw_calls = 0;
+  bool first_event = true;
+  trace_file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  for (auto &buffer : trace_buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    if (!first_event) {
+      trace_file << ",\n";
+    }
+
+    first_event = false;
+    trace_file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+               << "\"tid\": " << buffer->thread_id << ", \"args\": {\"name\": \""
+               << buffer->thread_name << "\"}}";
+
+    for (size_t i = buffer->GetFirstIndex(); i < buffer->count; i++) {
+      const TraceEvent &event = buffer->Get(i);
+      std::string object;
+      if (event.object != nullptr) {
+        auto it = class_names.find(event.object);
+        if (it == class_names.end()) {
+          it = class_names.emplace(event.object,
+                                   GetClassName(event.object)).first;
+        }
+
+        object = it->second;
+      }
+
+      trace_file << ",\n{\"name\": \"" << event.name << "\", \"pid\": 1, "
+                 << "\"tid\": " << buffer->thread_id << ", \"ts\": "
+                 << event.start_us;
+      if (event.name == kOverBudgetEvent) {
+        num_over_budget++;
+        over_budget_counts[object]++;
+        trace_file << ", \"ph\": \"i\", \"s\": \"t\"";
+      } else {
+        trace_file << ", \"ph\": \"X\", \"dur\": "
+                   << event.end_us - event.start_us;
+      }
+
+      if (event.name == kFrameEvent) {
+        num_frames++;
+        total_draw_calls += event.draw_calls;
+        max_draw_calls = std::max(max_draw_calls, event.draw_calls);
+      }
+
+      trace_file << ", \"args\": {";
+      if (!object.empty()) {
+        trace_file << "\"object\": \"" << object << "\"";
+      }
+
+      if (event.name == kFrameEvent || event.name == kOverBudgetEvent) {
+        trace_file << (object.empty() ? "" : ", ") << "\"cpu_us\": "
+                   << event.cpu_us << ", \"draw_calls\": " << event.draw_calls;
+      }
+
+      trace_file << "}}";
+    }
+
+    buffer->count = 0;
+  }
+
+  trace_file << "\n]}\n";
+  if (!trace_file) {
+    SDL_Log("Error writing trace file %s\n", path.c_str());
+    return;
+  }
+
+  SDL_Log("Wrote trace to %s: %d of %d frames over budget\n", path.c_str(),
+          num_over_budget, num_frames);
+  if (num_frames > 0) {
+    SDL_Log("Draw calls per frame: mean %.1f, max %d\n",
+            static_cast<double>(total_draw_calls) / num_frames,
+            max_draw_calls);
+  }
+  for (const auto &count : over_budget_counts) {
+    SDL_Log("  %s: %d\n", count.first.empty() ? "(none)" : count.first.c_str(),
+            count.second);
+  }
+}
+
+}  // namespace stimulus
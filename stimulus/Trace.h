@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TRACE_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TRACE_H_
+
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+
+namespace stimulus {
+
+// Optional tracing of where frame time goes. Each thread records events
+// into its own preallocated ring buffer (the oldest events are overwritten
+// if it fills up). WriteTrace saves them as Chrome trace-event JSON, which
+// can be opened with chrome://tracing or https://ui.perfetto.dev.
+//
+// Nothing is recorded unless EnableTracing has been called.
+void EnableTracing(const std::string &directory);
+bool IsTracingEnabled();
+
+// Names the calling thread in the trace.
+void SetTraceThreadName(const char *name);
+
+// name must be a string literal. object is the class responsible for the
+// event (e.g. the current Screen), and may be null.
+void AddTraceEvent(const char *name, const std::type_info *object,
+                   int64_t start_us, int64_t end_us);
+
+// Records the enclosing block as a trace event.
+class TraceScope {
+ public:
+  TraceScope(const char *name, const std::type_info *object = nullptr);
+  ~TraceScope();
+
+ private:
+  const char *name_;
+  const std::type_info *object_;
+  int64_t start_us_;
+};
+
+// Called by the main loop around each frame. If the CPU time spent in the
+// frame (everything except waiting in present) exceeds budget_us, the frame
+// is flagged along with the class of the slowest event in it. The number of
+// draw calls made is recorded with each frame.
+void BeginTraceFrame();
+void EndTraceFrame(int64_t budget_us, int draw_calls);
+
+// Discards everything recorded so far, e.g. at the start of a task.
+void ResetTrace();
+
+// Writes the trace to <directory>/<task>_<date>_trace.json, then resets it.
+void WriteTrace(const std::string &task);
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_TRACE_H_
@@ -15,6 +15,7 @@
 #include "Util.h"
 
 #include <cassert>
+#include <cstdio>
 
 namespace stimulus {
 namespace {
@@ -55,4 +56,13 @@ int LineBreak(std::vector<RenderString> &out_vec, std::string str,
   return count;
 }
 
+// Note: can't use colon in the date string because it isn't a valid
+// filename character on Windows.
+std::string FormatDateString(const DateTime &when) {
+  char date_string[256];
+  snprintf(date_string, sizeof(date_string), "%d-%d-%d_%02d-%02d-%02d",
+    when.month, when.day, when.year, when.hour, when.minute, when.second);
+  return date_string;
+}
+
 }  // namespace stimulus
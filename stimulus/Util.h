@@ -23,13 +23,9 @@
 #include <string>
 #include <vector>
 
-namespace stimulus {
+#include "Platform.h"
 
-// Compare two integers, handling the wrap case.
-inline bool WrappedGreaterEqual(uint32_t a, uint32_t b) {
-  return (a < b && b - a > 0x7fffffff) || (a > b && a - b < 0x7fffffff) ||
-         (a == b);
-}
+namespace stimulus {
 
 inline SDL_Rect InsetRect(const SDL_Rect &src, int x, int y) {
   SDL_Rect result{src.x + x / 2, src.y + y / 2, src.w - x, src.h - y};
@@ -41,6 +37,10 @@ struct SDL_TextureDeleter {
   void operator()(SDL_Texture *p) const { SDL_DestroyTexture(p); }
 };
 
+struct SDL_SurfaceDeleter {
+  void operator()(SDL_Surface *p) const { SDL_FreeSurface(p); }
+};
+
 struct RenderString {
   std::string str;
   int x;
@@ -50,6 +50,9 @@ struct RenderString {
 int LineBreak(std::vector<RenderString> &out_vec, std::string str,
               unsigned max_chars, int y, int font_height);
 
+// Formats a date for use in an output file name.
+std::string FormatDateString(const DateTime &when);
+
 
 }  // namespace stimulus
 
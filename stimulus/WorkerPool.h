@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_WORKERPOOL_H_
+#define EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_WORKERPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace stimulus {
+
+// A fixed set of threads that run jobs in the order they were submitted,
+// for slow work (like decoding images) that shouldn't happen on the render
+// thread. The destructor finishes any queued jobs before returning.
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_threads);
+  ~WorkerPool();
+
+  // Returns a future for the job's result.
+  template <typename Job>
+  std::future<typename std::result_of<Job()>::type> Submit(Job job) {
+    typedef typename std::result_of<Job()>::type Result;
+
+    // std::function must be copyable, but packaged_task isn't.
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back([task] { (*task)(); });
+    }
+
+    condition_.notify_one();
+    return result;
+  }
+
+  int GetNumThreads() const {
+    return static_cast<int>(threads_.size());
+  }
+
+ private:
+  void ThreadMain();
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> jobs_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace stimulus
+
+#endif  // EXPERIMENTAL_GOOGLEX_AMBER_STIMULUS_V2_WORKERPOOL_H_
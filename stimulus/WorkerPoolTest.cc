@@ -0,0 +1,63 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WorkerPool.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const int kNumThreads = 4;
+const int kNumJobs = 1000;
+
+BOOST_AUTO_TEST_CASE(PoolReturnsResults) {
+  stimulus::WorkerPool pool(kNumThreads);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < kNumJobs; i++) {
+    results.push_back(pool.Submit([i] { return i * i; }));
+  }
+
+  for (int i = 0; i < kNumJobs; i++) {
+    BOOST_CHECK_EQUAL(results[i].get(), i * i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PoolMoveOnlyResult) {
+  stimulus::WorkerPool pool(1);
+  std::future<std::unique_ptr<std::string>> result = pool.Submit([] {
+    return std::unique_ptr<std::string>(new std::string("decoded"));
+  });
+
+  BOOST_CHECK_EQUAL(*result.get(), "decoded");
+}
+
+// Jobs still queued when the pool is destroyed must run.
+BOOST_AUTO_TEST_CASE(PoolDrainsOnDestruction) {
+  std::atomic<int> count(0);
+  {
+    stimulus::WorkerPool pool(kNumThreads);
+    for (int i = 0; i < kNumJobs; i++) {
+      pool.Submit([&count] { count++; });
+    }
+  }
+
+  BOOST_CHECK_EQUAL(count.load(), kNumJobs);
+}
+
+}  // namespace
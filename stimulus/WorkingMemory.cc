@@ -215,14 +215,15 @@ const std::string PracticeResultsScreen::kStartLabel = "Start Task";
 
 class MemoryScreen : public Screen {
  public:
-  MemoryScreen(std::shared_ptr<State> state) : state_(state) {
+  MemoryScreen(std::shared_ptr<State> state, RandomStream random)
+      : random_(random), state_(state) {
     cross_ = LoadImage(GetResourceDir() + "cross.bmp");
     cross_rect_ = ComputeRectForPhysicalWidth(cross_, kCrossWidthCm);
     shuffler_.AddCategoryElements(ColorList, 0);
   }
 
   void IsActive() override {
-    shuffler_.ShuffleElements();
+    shuffler_.ShuffleElements(&random_);
 
     int origin_x = GetDisplayWidthPx() / 2;
     int origin_y = GetDisplayHeightPx() / 2;
@@ -230,7 +231,7 @@ class MemoryScreen : public Screen {
     for (int i = 0; i < kNumStimuli; i++) {
       // calculate position relative to center of screen
       // must not be +/- 15 degrees of X/Y axis
-      uint32_t deg = GenerateRandomInt(15, 76) + i * 90;
+      uint32_t deg = random_.NextInt(15, 76) + i * 90;
       float rad = static_cast<float>(deg) * M_PI / 180;
       float offset_cm = kStimuliHeightCm / 2;
       float x_cm = kStimuliRadiusCm * std::cos(rad) - offset_cm;
@@ -272,13 +273,15 @@ class MemoryScreen : public Screen {
   SDL_Texture *cross_;
   SDL_Rect cross_rect_;
   Shuffler<SDL_Color> shuffler_;
+  RandomStream random_;
   std::shared_ptr<State> state_;
 };
 
 class RecallScreen : public Screen {
  public:
-  RecallScreen(std::shared_ptr<State> state, bool practice)
-      : state_(state), practice_(practice) {
+  RecallScreen(std::shared_ptr<State> state, bool practice,
+               RandomStream random)
+      : state_(state), practice_(practice), random_(random) {
     cross_ = LoadImage(GetResourceDir() + "cross.bmp");
     cross_rect_ = ComputeRectForPhysicalWidth(cross_, kCrossWidthCm);
 
@@ -286,7 +289,7 @@ class RecallScreen : public Screen {
   }
 
   void IsActive() override {
-    changed_index_ = static_cast<int>(GenerateRandomInt(0, kNumStimuli));
+    changed_index_ = static_cast<int>(random_.NextInt(0, kNumStimuli));
 
     int center_x = static_cast<int>(
         static_cast<float>(GetDisplayWidthPx() / 2) / GetPixelRatio());
@@ -363,12 +366,16 @@ class RecallScreen : public Screen {
   int changed_index_;
   std::shared_ptr<State> state_;
   bool practice_;
+  RandomStream random_;
   int mark_;
 };
 
 }  // namespace
 
-Screen *InitWorkingMemory(Screen *main_screen, const Settings &Settings) {
+Screen *InitWorkingMemory(Screen *main_screen, const Settings &Settings,
+                          RandomStream random) {
+  Screen::WarnIfNotFrameMultiple("Working memory stimulus time", kMemoryMs);
+
   std::shared_ptr<State> state(new State());
   // version
   Screen *version = new VersionScreen();
@@ -382,12 +389,10 @@ Screen *InitWorkingMemory(Screen *main_screen, const Settings &Settings) {
       {"First, we will do some practice.", "Click the mouse to continue."});
   // practice
   Screen *practice = new PracticeScreen(state);
-  Screen *p_f =
-      new FixationScreen(kTrialFixationMs, kTrialFixationMs, kCrossWidthCm);
-  Screen *p_memory = new MemoryScreen(state);
-  Screen *p_mf =
-      new FixationScreen(kMemoryFixationMs, kMemoryFixationMs, kCrossWidthCm);
-  Screen *p_recall = new RecallScreen(state, true);
+  Screen *p_f = new FixationScreen(kTrialFixationMs, kCrossWidthCm);
+  Screen *p_memory = new MemoryScreen(state, random.Split());
+  Screen *p_mf = new FixationScreen(kMemoryFixationMs, kCrossWidthCm);
+  Screen *p_recall = new RecallScreen(state, true, random.Split());
   Screen *p_results = new PracticeResultsScreen(state);
   Screen *p_finish = new MultiLineScreen(
       {"You have now completed the practice.", "Click the mouse to continue."},
@@ -396,12 +401,10 @@ Screen *InitWorkingMemory(Screen *main_screen, const Settings &Settings) {
   Screen *start = new MultiLineScreen(
       {"Starting a new block of trials...", "Click the mouse to begin."},
       kMarkBlockStart);
-  Screen *f =
-      new FixationScreen(kTrialFixationMs, kTrialFixationMs, kCrossWidthCm);
-  Screen *memory = new MemoryScreen(state);
-  Screen *mf =
-      new FixationScreen(kMemoryFixationMs, kMemoryFixationMs, kCrossWidthCm);
-  Screen *recall = new RecallScreen(state, false);
+  Screen *f = new FixationScreen(kTrialFixationMs, kCrossWidthCm);
+  Screen *memory = new MemoryScreen(state, random.Split());
+  Screen *mf = new FixationScreen(kMemoryFixationMs, kCrossWidthCm);
+  Screen *recall = new RecallScreen(state, false, random.Split());
   Screen *finish = new MultiLineScreen(
       {"This is the end of the experiment.", "Thank you!"}, kMarkTaskStartStop);
 
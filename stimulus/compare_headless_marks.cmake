@@ -0,0 +1,72 @@
+# Copyright 2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Runs an input script headless and checks that the marks it produces are
+# the expected ones:
+#   cmake -DSTIMULUS=<program> -DSCRIPT=<script> -DEXPECTED=<csv>
+#         -DOUTPUT_DIR=<dir> -P compare_headless_marks.cmake
+# Only the rows after the ---- line of each mark file are compared, so
+# EXPECTED can leave out the header, which has the date. The version and
+# revision marks (the only ones of ten digits) change with every build, so
+# they aren't compared either.
+
+file(REMOVE_RECURSE ${OUTPUT_DIR})
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+execute_process(
+  COMMAND ${STIMULUS} --headless ${SCRIPT} --seed 1 --mark_directory ${OUTPUT_DIR}/
+  RESULT_VARIABLE result
+  OUTPUT_QUIET ERROR_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "Headless run of ${SCRIPT} failed: ${result}")
+endif()
+
+file(GLOB mark_files ${OUTPUT_DIR}/*.csv)
+list(LENGTH mark_files mark_file_count)
+if(NOT mark_file_count EQUAL 1)
+  message(FATAL_ERROR "Expected one mark file, found ${mark_file_count}")
+endif()
+
+function(read_mark_rows path rows_var)
+  file(STRINGS ${path} lines)
+  set(rows)
+  set(in_rows FALSE)
+  foreach(line ${lines})
+    string(REGEX REPLACE "\r$" "" line "${line}")
+    if(line STREQUAL "----")
+      set(in_rows TRUE)
+    elseif(in_rows AND NOT line MATCHES "^[0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9],")
+      list(APPEND rows "${line}")
+    endif()
+  endforeach()
+  set(${rows_var} "${rows}" PARENT_SCOPE)
+endfunction()
+
+read_mark_rows(${mark_files} actual)
+read_mark_rows(${EXPECTED} expected)
+list(LENGTH actual actual_count)
+list(LENGTH expected expected_count)
+if(NOT actual_count EQUAL expected_count)
+  message(FATAL_ERROR
+          "${mark_files} has ${actual_count} rows, expected ${expected_count}")
+endif()
+
+math(EXPR last "${expected_count} - 1")
+foreach(i RANGE ${last})
+  list(GET actual ${i} actual_row)
+  list(GET expected ${i} expected_row)
+  if(NOT actual_row STREQUAL expected_row)
+    message(FATAL_ERROR
+            "${mark_files} row ${i} is ${actual_row}, expected ${expected_row}")
+  endif()
+endforeach()
@@ -0,0 +1,99 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compiles the schedules for a range of seeds, e.g. to counterbalance a
+// study by giving each session its own (see Schedule.h):
+//   compile_schedules <output_dir> <first_seed> <count> [--json]
+// Each is written to <output_dir>/schedule_<seed>.plan, and with --json,
+// also to schedule_<seed>.json for reading.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Schedule.h"
+#include "TaskSchedules.h"
+#include "WorkerPool.h"
+
+namespace {
+
+// Write to a temporary file, so a failed run doesn't leave a truncated
+// schedule behind.
+bool WriteFile(const std::string &path, const std::string &contents) {
+  std::string temp = path + ".tmp";
+  std::ofstream file(temp, std::ios::binary);
+  file.write(contents.data(), contents.size());
+  file.close();
+  if (!file || rename(temp.c_str(), path.c_str()) != 0) {
+    std::cerr << "Couldn't write " << path << std::endl;
+    remove(temp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool CompileAndWrite(const std::string &output_dir, uint32_t seed,
+                     bool json) {
+  stimulus::Schedule schedule = stimulus::CompileSchedule(seed);
+  std::string name = output_dir + "/schedule_" + std::to_string(seed);
+  return WriteFile(name + ".plan", stimulus::SerializeSchedule(schedule)) &&
+         (!json || WriteFile(name + ".json",
+                             stimulus::ScheduleToJson(schedule)));
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  bool json = argc == 5 && std::string(argv[4]) == "--json";
+  if (argc != 4 && !json) {
+    std::cerr << "usage: " << argv[0]
+              << " <output_dir> <first_seed> <count> [--json]" << std::endl;
+    return 1;
+  }
+
+  std::string output_dir = argv[1];
+  uint32_t first_seed = static_cast<uint32_t>(std::stoul(argv[2]));
+  int count = std::stoi(argv[3]);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::future<bool>> results;
+  {
+    stimulus::WorkerPool pool(
+        std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < count; i++) {
+      uint32_t seed = first_seed + i;
+      results.push_back(pool.Submit([output_dir, seed, json] {
+        return CompileAndWrite(output_dir, seed, json);
+      }));
+    }
+  }
+
+  int failures = 0;
+  for (auto &result : results) {
+    failures += result.get() ? 0 : 1;
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << "Compiled " << count - failures << " schedules ("
+            << stimulus::GetScheduledTasks().size() << " tasks each) into "
+            << output_dir << " in " << elapsed.count() << " ms" << std::endl;
+  return failures == 0 ? 0 : 1;
+}
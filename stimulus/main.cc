@@ -14,8 +14,14 @@
 
 #include <SDL.h>
 
+#include <cerrno>
+#include <climits>
 #include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
 #include "Calibration.h"
@@ -25,15 +31,21 @@
 #include "Flankers.h"
 #include "HotButton.h"
 #include "Image.h"
+#include "InputScript.h"
 #include "LatencyTest.h"
 #include "Mark.h"
 #include "Platform.h"
 #include "Random.h"
 #include "Revision.h"
+#include "Schedule.h"
 #include "Screen.h"
 #include "Settings.h"
 #include "Sret.h"
 #include "Ssvep.h"
+#include "StartupProfile.h"
+#include "SvgCache.h"
+#include "TaskSchedules.h"
+#include "Trace.h"
 #include "WorkingMemory.h"
 #include "Version.h"
 
@@ -43,16 +55,47 @@ namespace {
 const int kTextLeft = 200;
 const int kTextTop = 200;
 const int kDefaultBaudRate = 115200;
+const uint32_t kHeadlessRandomSeed = 1;
 const char *kMarkSerialPortNameSetting = "mark_serialportname";
 const char *kMarkParallelPortAddressSetting = "mark_parallelportaddress";
 
+// Called by whichever screen is shown first, so the startup profile runs
+// until the first frame.
+void EndStartup() {
+  EndStartupProfile(GetMarkDirectory());
+}
+
 class TaskSelectionScreen : public Screen {
  public:
-  TaskSelectionScreen() : version_string_(kFullVersionString) {}
+  // seed is recorded in each task's mark file, so the session can be
+  // repeated.
+  explicit TaskSelectionScreen(uint32_t seed)
+      : version_string_(kFullVersionString), seed_(seed) {
+    SetStatic(true);
+  }
 
   void IsActive() override {
-    // We will come back here after finishing a task.
+    // We will come back here after finishing a task. Its last screen sends
+    // offset marks as it goes, so the file is closed once this is visible.
+    finish_pending_ = true;
+  }
+
+  void IsVisible() override {
+    if (finish_pending_) {
+      FinishTask();
+    }
+
+    EndStartup();
+  }
+
+  void FinishTask() {
+    finish_pending_ = false;
     CloseMarkFile();
+    if (!current_task_.empty()) {
+      WriteTrace(current_task_);
+      LogImageLoadStats(current_task_.c_str());
+      current_task_.clear();
+    }
   }
 
   void Render() override {
@@ -61,8 +104,8 @@ class TaskSelectionScreen : public Screen {
     DrawString(kTextLeft, top, "Select Task:");
     top += GetFontHeight() * 2;
 
-    for (auto label : labels_) {
-      DrawString(kTextLeft, top, label);
+    for (const Task &task : tasks_) {
+      DrawString(kTextLeft, top, task.label);
       top += GetFontHeight();
     }
 
@@ -70,33 +113,77 @@ class TaskSelectionScreen : public Screen {
     DrawString(0, bottom, version_string_);
   }
 
-  void AddSelection(std::string name, Screen *screen) {
-    task_names_.push_back(name);
-    std::string label = std::to_string(labels_.size() + 1) + ". " + name;
-    labels_.push_back(label);
-    AddSuccessor(screen);
+  // The task isn't created until it is first selected, so that starting
+  // the program doesn't wait for every task to load its images.
+  void AddSelection(std::string name, std::function<Screen*()> create) {
+    Task task;
+    task.name = name;
+    task.label = std::to_string(tasks_.size() + 1) + ". " + name;
+    task.create = create;
+    tasks_.push_back(task);
   }
 
   void KeyPressed(SDL_Scancode scancode) override {
     if (scancode >= SDL_SCANCODE_1 && scancode <= SDL_SCANCODE_9) {
-      int screen_index = scancode - SDL_SCANCODE_1;
-      if (screen_index < GetNumSuccessors()) {
-        OpenMarkFile(task_names_[screen_index]);
-        SwitchToScreen(screen_index);
+      unsigned int task_index = scancode - SDL_SCANCODE_1;
+      if (task_index < tasks_.size()) {
+        if (finish_pending_) {
+          FinishTask();
+        }
+
+        Task &task = tasks_[task_index];
+        if (task.successor < 0) {
+          CreateTask(&task);
+        }
+
+        current_task_ = task.name;
+        OpenMarkFile(current_task_);
+        SetMarkHeaderField("seed", std::to_string(seed_));
+        ResetTrace();
+        SwitchToScreen(task.successor);
       }
     }
   }
 
  private:
-  std::vector<std::string> task_names_;
-  std::vector<std::string> labels_;
+  struct Task {
+    std::string name;
+    std::string label;
+    std::function<Screen*()> create;
+
+    // Index for SwitchToScreen, once the task has been created.
+    int successor = -1;
+  };
+
+  void CreateTask(Task *task) {
+    BeginStartupProfile(task->name);
+    {
+      StartupScope scope("Create task");
+      AddSuccessor(task->create());
+    }
+
+    task->successor = GetNumSuccessors() - 1;
+    EndStartupProfile(GetMarkDirectory());
+    LogImageLoadStats((task->name + " initialization").c_str());
+  }
+
+  std::vector<Task> tasks_;
   std::string version_string_;
+  uint32_t seed_;
+  std::string current_task_;
+  bool finish_pending_ = false;
 };
 
 class SerialSelectionScreen : public Screen {
  public:
   SerialSelectionScreen(std::vector<std::string> port_names, int baud_rate)
-      : port_names_(port_names), baud_rate_(baud_rate) {}
+      : port_names_(port_names), baud_rate_(baud_rate) {
+    SetStatic(true);
+  }
+
+  void IsVisible() override {
+    EndStartup();
+  }
 
   void Render() override {
     int top = kTextTop;
@@ -138,12 +225,124 @@ bool CheckBaudRate(int rate) {
   return kValidBaudRates.find(rate) != kValidBaudRates.end();
 }
 
+// Seeds are whole numbers that fit in 32 bits.
+bool ParseSeed(const std::string &text, uint32_t *seed) {
+  if (text.empty() || text[0] < '0' || text[0] > '9') {
+    return false;
+  }
+
+  char *end;
+  errno = 0;
+  unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+  if (*end != '\0' || errno == ERANGE || value > UINT32_MAX) {
+    return false;
+  }
+
+  *seed = static_cast<uint32_t>(value);
+  return true;
+}
+
+// Settings like thresholds are whole numbers, 0 or more.
+bool ParseNonNegativeInt(const std::string &text, int *result) {
+  if (text.empty() || text[0] < '0' || text[0] > '9') {
+    return false;
+  }
+
+  char *end;
+  errno = 0;
+  long value = std::strtol(text.c_str(), &end, 10);
+  if (*end != '\0' || errno == ERANGE || value > INT_MAX) {
+    return false;
+  }
+
+  *result = static_cast<int>(value);
+  return true;
+}
+
 }  // namespace
 }  // namespace stimulus
 
 int main(int argc, char *argv[]) {
-  stimulus::InitRandom(stimulus::GetRandomSeed());
-  stimulus::Settings settings(stimulus::GetResourceDir() + "/settings.txt");
+  stimulus::BeginStartupProfile("Startup");
+
+  // A headless run replays an input script against the tasks, with a fixed
+  // random seed, to produce mark files that can be compared between builds:
+  //   stimulus --headless <script> [--seed <n>] [--mark_directory <dir>]
+  // Any run can follow a schedule made by compile_schedules:
+  //   stimulus --schedule <file>
+  std::string headless_script;
+  std::string headless_mark_directory;
+  std::string schedule_path;
+  uint32_t seed = stimulus::GetRandomSeed();
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--headless" && i + 1 < argc) {
+      headless_script = argv[++i];
+      seed = stimulus::kHeadlessRandomSeed;
+    } else if (arg == "--seed" && i + 1 < argc) {
+      if (!stimulus::ParseSeed(argv[++i], &seed)) {
+        SDL_Log("Invalid seed %s (must be 0 to %u)\n", argv[i], UINT32_MAX);
+        return 1;
+      }
+    } else if (arg == "--mark_directory" && i + 1 < argc) {
+      headless_mark_directory = argv[++i];
+    } else if (arg == "--schedule" && i + 1 < argc) {
+      schedule_path = argv[++i];
+    } else {
+      SDL_Log("Unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::unique_ptr<stimulus::InputScript> input_script;
+  if (!headless_script.empty()) {
+    input_script.reset(new stimulus::InputScript(headless_script));
+    stimulus::Screen::SetHeadless(input_script.get());
+    std::string errors = input_script->GetErrors();
+    if (errors.length() > 0) {
+      stimulus::Screen::FatalError(
+          "There was a problem reading the input script:\n" + errors);
+      return 1;
+    }
+  }
+
+  // Tasks whose trials don't depend on responses step through a schedule.
+  // Unless one is given, it is compiled from the seed when the task is
+  // selected.
+  stimulus::Schedule schedule;
+  schedule.seed = seed;
+  if (!schedule_path.empty()) {
+    stimulus::StartupScope scope("Schedule");
+    std::string error;
+    if (!stimulus::LoadSchedule(schedule_path, &schedule, &error) ||
+        !stimulus::CheckSchedule(schedule, &error)) {
+      stimulus::Screen::FatalError(
+          "There was a problem reading the schedule:\n" + error);
+      return 1;
+    }
+
+    SDL_Log("Using schedule %s (seed %u)\n", schedule_path.c_str(),
+            schedule.seed);
+  }
+
+  // Each task draws from its own stream, so the numbers a task sees don't
+  // depend on the tasks that ran before it. A schedule's seed replaces the
+  // session's, so tasks without a schedule are repeated by it too.
+  auto get_random = [&schedule](const std::string &task) {
+    return stimulus::RandomStream(schedule.seed, task);
+  };
+
+  auto get_schedule = [&schedule](const std::string &task) {
+    const stimulus::TaskSchedule *found = schedule.FindTask(task);
+    return found != nullptr
+               ? *found
+               : stimulus::CompileTaskSchedule(task, schedule.seed);
+  };
+
+  stimulus::Settings settings = [] {
+    stimulus::StartupScope scope("Settings");
+    return stimulus::Settings(stimulus::GetResourceDir() + "/settings.txt");
+  }();
   std::string errors = settings.GetErrors();
   if (errors.length() > 0) {
     std::string message = "There was a problem reading the settings file:\n";
@@ -152,6 +351,20 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // The build packs the resources directory into one file. Without it (or
+  // for files added since), images are loaded from the directory.
+  if (stimulus::UseResourcePack(stimulus::GetResourceDir() +
+                                "resources.pack")) {
+    SDL_Log("Using resources.pack\n");
+  }
+
+  // Rasterized SVGs are kept between runs, in a per user directory.
+  char *pref_path = SDL_GetPrefPath("Google", "Stimulus");
+  if (pref_path != nullptr) {
+    stimulus::SetSvgCacheDirectory(pref_path);
+    SDL_free(pref_path);
+  }
+
   int baud_rate = stimulus::kDefaultBaudRate;
   if (settings.HasKey("baud_rate")) {
     baud_rate = settings.GetIntValue("baud_rate");
@@ -178,8 +391,83 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (settings.HasKey("mark_pulse_width_us")) {
+    int pulse_width_us = settings.GetIntValue("mark_pulse_width_us");
+    if (pulse_width_us < 0) {
+      stimulus::Screen::FatalError(
+          "Invalid mark pulse width specified in settings file");
+      return 1;
+    }
+
+    stimulus::SetMarkPulseWidth(pulse_width_us);
+  }
+
+  if (settings.HasKey("mark_latency_warning_us")) {
+    int latency_us;
+    if (!stimulus::ParseNonNegativeInt(
+            settings.GetValue("mark_latency_warning_us"), &latency_us)) {
+      stimulus::Screen::FatalError(
+          "Invalid mark latency warning specified in settings file "
+          "(must be a whole number of microseconds, 0 or more)");
+      return 1;
+    }
+
+    stimulus::SetMarkLatencyWarning(latency_us);
+  }
+
+  if (settings.HasKey("mark_time_units")) {
+    std::string units = settings.GetValue("mark_time_units");
+    if (units == "us") {
+      stimulus::SetMarkTimeUnits(stimulus::kMicroseconds);
+    } else if (units == "ms") {
+      stimulus::SetMarkTimeUnits(stimulus::kMilliseconds);
+    } else {
+      stimulus::Screen::FatalError(
+          "Invalid mark time units specified in settings file "
+          "(must be 'us' or 'ms')");
+      return 1;
+    }
+  }
+
+  if (settings.HasKey("schedule_mode")) {
+    std::string mode = settings.GetValue("schedule_mode");
+    if (mode == "ms") {
+      stimulus::Screen::SetFrameScheduling(false);
+    } else if (mode == "frames") {
+      stimulus::Screen::SetFrameScheduling(true);
+    } else {
+      stimulus::Screen::FatalError(
+          "Invalid schedule mode specified in settings file "
+          "(must be 'ms' or 'frames')");
+      return 1;
+    }
+  }
+
+  if (settings.HasKey("mark_time_reference")) {
+    std::string reference = settings.GetValue("mark_time_reference");
+    if (reference == "photon") {
+      stimulus::Screen::SetPhotonTiming(true);
+    } else if (reference == "callback") {
+      stimulus::Screen::SetPhotonTiming(false);
+    } else {
+      stimulus::Screen::FatalError(
+          "Invalid mark time reference specified in settings file "
+          "(must be 'photon' or 'callback')");
+      return 1;
+    }
+  }
+
   if (settings.HasKey("mark_directory")) {
     stimulus::SetMarkDirectory(settings.GetValue("mark_directory"));
+    stimulus::RecoverMarkJournal();
+  }
+
+  if (!headless_mark_directory.empty()) {
+    stimulus::SetMarkDirectory(headless_mark_directory);
+  }
+
+  if (settings.HasKey("trace_directory")) {
+    stimulus::EnableTracing(settings.GetValue("trace_directory"));
   }
 
   if (!settings.HasKey("monitor_width") || !settings.HasKey("monitor_height")) {
@@ -191,41 +479,54 @@ int main(int argc, char *argv[]) {
 
   float width = settings.GetFloatValue("monitor_width");
   float height = settings.GetFloatValue("monitor_height");
-  if (!stimulus::Screen::InitDisplay(width, height)) {
-    return 1;
+  {
+    stimulus::StartupScope scope("InitDisplay");
+    if (!stimulus::Screen::InitDisplay(width, height)) {
+      return 1;
+    }
   }
 
   stimulus::TaskSelectionScreen *task_selection_screen =
-      new stimulus::TaskSelectionScreen();
-  stimulus::Screen *doors =
-      stimulus::InitDoors(task_selection_screen, settings);
-  task_selection_screen->AddSelection("Doors", doors);
-  stimulus::Screen *emotional_images =
-      stimulus::InitEmotionalImages(task_selection_screen, settings);
-  task_selection_screen->AddSelection("Emotional Images", emotional_images);
-  stimulus::Screen *flankers =
-      stimulus::InitFlankers(task_selection_screen, settings);
-  task_selection_screen->AddSelection("Flankers", flankers);
-  stimulus::Screen *hb =
-      stimulus::InitHotButton(task_selection_screen, settings);
-  task_selection_screen->AddSelection("Hot Button", hb);
-  stimulus::Screen *sret = stimulus::InitSret(task_selection_screen, settings);
-  task_selection_screen->AddSelection("SRET", sret);
-  stimulus::Screen *ssvep =
-      stimulus::InitSsvep(task_selection_screen, settings);
-  task_selection_screen->AddSelection("SSVEP", ssvep);
-  stimulus::Screen *wm =
-      stimulus::InitWorkingMemory(task_selection_screen, settings);
-  task_selection_screen->AddSelection("Working Memory", wm);
-  stimulus::Screen *eyes_closed =
-      stimulus::InitEyesClosed(task_selection_screen);
-  task_selection_screen->AddSelection("Eyes Closed", eyes_closed);
-  stimulus::Screen *calibration =
-      stimulus::InitCalibration(task_selection_screen);
-  task_selection_screen->AddSelection("Oddball", calibration);
-  stimulus::Screen *latency_test =
-      stimulus::InitLatencyTest(task_selection_screen);
-  task_selection_screen->AddSelection("Latency Test", latency_test);
+      new stimulus::TaskSelectionScreen(schedule.seed);
+  task_selection_screen->AddSelection("Doors", [&] {
+    return stimulus::InitDoors(task_selection_screen, settings,
+                               get_random("Doors"));
+  });
+  task_selection_screen->AddSelection("Emotional Images", [&] {
+    return stimulus::InitEmotionalImages(task_selection_screen, settings,
+                                         get_schedule("Emotional Images"));
+  });
+  task_selection_screen->AddSelection("Flankers", [&] {
+    return stimulus::InitFlankers(task_selection_screen, settings,
+                                  get_random("Flankers"));
+  });
+  task_selection_screen->AddSelection("Hot Button", [&] {
+    return stimulus::InitHotButton(task_selection_screen, settings,
+                                   get_random("Hot Button"));
+  });
+  task_selection_screen->AddSelection("SRET", [&] {
+    return stimulus::InitSret(task_selection_screen, settings,
+                              get_schedule("SRET"));
+  });
+  task_selection_screen->AddSelection("SSVEP", [&] {
+    return stimulus::InitSsvep(task_selection_screen, settings,
+                               get_schedule("SSVEP"));
+  });
+  task_selection_screen->AddSelection("Working Memory", [&] {
+    return stimulus::InitWorkingMemory(task_selection_screen, settings,
+                                       get_random("Working Memory"));
+  });
+  task_selection_screen->AddSelection("Eyes Closed", [&] {
+    return stimulus::InitEyesClosed(task_selection_screen);
+  });
+  task_selection_screen->AddSelection("Oddball", [&] {
+    return stimulus::InitCalibration(task_selection_screen,
+                                     get_schedule("Oddball"));
+  });
+  task_selection_screen->AddSelection("Latency Test", [&] {
+    return stimulus::InitLatencyTest(task_selection_screen);
+  });
+  stimulus::LogImageLoadStats("Startup");
 
   if (settings.HasKey(stimulus::kMarkParallelPortAddressSetting) &&
       settings.HasKey(stimulus::kMarkSerialPortNameSetting)) {
@@ -235,7 +536,9 @@ int main(int argc, char *argv[]) {
   }
 
   stimulus::Screen *first_screen = task_selection_screen;
-  if (settings.HasKey(stimulus::kMarkSerialPortNameSetting)) {
+  if (stimulus::Screen::IsHeadless()) {
+    // Headless runs only write the mark file.
+  } else if (settings.HasKey(stimulus::kMarkSerialPortNameSetting)) {
     stimulus::OpenMarkPort(
         settings.GetValue(stimulus::kMarkSerialPortNameSetting), baud_rate);
   } else if (settings.HasKey(stimulus::kMarkParallelPortAddressSetting)) {
@@ -243,7 +546,12 @@ int main(int argc, char *argv[]) {
         settings.GetValue(stimulus::kMarkParallelPortAddressSetting), 0);
   } else {
     // prompt for port selection if not specified in settings
-    std::vector<std::string> ports = stimulus::GetAvailableSerialPorts();
+    std::vector<std::string> ports;
+    {
+      stimulus::StartupScope scope("Serial ports");
+      ports = stimulus::GetAvailableSerialPorts();
+    }
+
     stimulus::SerialSelectionScreen *serial_selection_screen =
         new stimulus::SerialSelectionScreen(ports, baud_rate);
     serial_selection_screen->AddSuccessor(task_selection_screen);
@@ -252,5 +560,8 @@ int main(int argc, char *argv[]) {
 
   stimulus::Screen::MainLoop(first_screen);
 
+  // Save marks if the user quit in the middle of a task.
+  task_selection_screen->FinishTask();
+
   return 0;
 }
@@ -0,0 +1,84 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of SendMark on the calling (render) thread and checks
+// that it never allocates. Exits with a nonzero status if it does.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include "Clock.h"
+#include "Mark.h"
+
+namespace {
+
+const int kNumBatches = 200;
+const int kMarksPerBatch = 100;
+
+// Only allocations made by the benchmark thread are counted; the mark
+// dispatcher thread is allowed to allocate.
+thread_local long thread_allocations = 0;
+
+}  // namespace
+
+void *operator new(size_t size) {
+  thread_allocations++;
+  void *ptr = malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+int main(int argc, char *argv[]) {
+  stimulus::MarkEventId event = stimulus::InternMarkEvent("BenchmarkEvent");
+  stimulus::OpenMarkFile("MarkBenchmark");
+
+  // Warm up, so one-time initialization isn't counted.
+  stimulus::SendMark(1, event);
+
+  long allocations_before = thread_allocations;
+  int64_t total_us = 0;
+  int64_t max_us = 0;
+  for (int batch = 0; batch < kNumBatches; batch++) {
+    for (int i = 0; i < kMarksPerBatch; i++) {
+      int64_t start = stimulus::GetTimeMicros();
+      stimulus::SendMark(i, event);
+      int64_t elapsed = stimulus::GetTimeMicros() - start;
+      total_us += elapsed;
+      if (elapsed > max_us) {
+        max_us = elapsed;
+      }
+    }
+
+    // Give the dispatcher thread a chance to drain the queue.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  long allocations = thread_allocations - allocations_before;
+  int num_marks = kNumBatches * kMarksPerBatch;
+  printf("%d marks, mean %.3f us, max %lld us, %ld allocations\n", num_marks,
+         static_cast<double>(total_us) / num_marks,
+         static_cast<long long>(max_us), allocations);
+
+  stimulus::CloseMarkFile();
+  return allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Packs the resources directory into a single file that the stimulus
+// program maps at startup (see ResourcePack.h):
+//   pack_resources <resource_dir> <output_file>
+// settings.txt is left out, since it is meant to be edited in place.
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ResourcePack.h"
+
+namespace {
+
+typedef std::vector<std::pair<std::string, std::string>> FileList;
+
+bool ShouldPack(const std::string &name) {
+  return name != "settings.txt" && name != "resources.pack";
+}
+
+// Adds the files under dir (named relative to root) to files.
+bool AddFiles(const std::string &root, const std::string &dir,
+              FileList *files) {
+  DIR *handle = opendir((root + "/" + dir).c_str());
+  if (handle == nullptr) {
+    std::cerr << "Couldn't open " << root << "/" << dir << std::endl;
+    return false;
+  }
+
+  std::vector<std::string> entries;
+  while (dirent *entry = readdir(handle)) {
+    if (entry->d_name[0] != '.') {
+      entries.push_back(entry->d_name);
+    }
+  }
+
+  closedir(handle);
+
+  // Sorted, so the pack is the same on every build.
+  std::sort(entries.begin(), entries.end());
+  for (const std::string &entry : entries) {
+    std::string name = dir.empty() ? entry : dir + "/" + entry;
+    std::string path = root + "/" + name;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+      std::cerr << "Couldn't stat " << path << std::endl;
+      return false;
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+      if (!AddFiles(root, name, files)) {
+        return false;
+      }
+    } else if (ShouldPack(name)) {
+      std::ifstream file(path, std::ios::binary);
+      std::ostringstream contents;
+      contents << file.rdbuf();
+      if (!file) {
+        std::cerr << "Couldn't read " << path << std::endl;
+        return false;
+      }
+
+      files->emplace_back(name, contents.str());
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::cerr << "usage: " << argv[0] << " <resource_dir> <output_file>"
+              << std::endl;
+    return 1;
+  }
+
+  FileList files;
+  if (!AddFiles(argv[1], "", &files)) {
+    return 1;
+  }
+
+  // Write to a temporary file, so a failed build doesn't leave a truncated
+  // pack behind.
+  std::string output = argv[2];
+  std::string temp = output + ".tmp";
+  std::string pack = stimulus::ResourcePack::Build(files);
+  std::ofstream file(temp, std::ios::binary);
+  file.write(pack.data(), pack.size());
+  file.close();
+  if (!file || rename(temp.c_str(), output.c_str()) != 0) {
+    std::cerr << "Couldn't write " << output << std::endl;
+    remove(temp.c_str());
+    return 1;
+  }
+
+  std::cout << "Packed " << files.size() << " files (" << pack.size()
+            << " bytes) into " << output << std::endl;
+  return 0;
+}
@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares RandomStream with the global xorshift128 generator it replaced,
+// which scaled a double to get bounded integers.
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "Random.h"
+
+namespace {
+
+const int kNumValues = 1 << 16;
+const int kNumRepetitions = 500;
+const uint32_t kRange = 27;  // The number of SSVEP images
+
+uint32_t random_state[4] = {1, 1, 1, 1};
+
+uint32_t Xorshift128() {
+  uint32_t t = random_state[3];
+  t ^= t << 11;
+  t ^= t >> 8;
+  for (int i = 3; i > 0; i--) {
+    random_state[i] = random_state[i - 1];
+  }
+
+  uint32_t s = random_state[0];
+  t ^= s;
+  t ^= s >> 19;
+  random_state[0] = t;
+
+  return t;
+}
+
+double LegacyRandomDouble() {
+  return static_cast<double>(Xorshift128() - 1) / UINT_MAX;
+}
+
+uint32_t LegacyRandomInt(uint32_t min, uint32_t max) {
+  return floor(LegacyRandomDouble() * (max - min)) + min;
+}
+
+// Prints the time per value. The sum keeps the compiler from dropping the
+// work.
+template <typename Function>
+void Measure(const char *name, Function function) {
+  std::vector<uint32_t> values(kNumValues);
+  uint64_t sum = 0;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int rep = 0; rep < kNumRepetitions; rep++) {
+    function(values.data());
+    sum += values[rep % kNumValues];
+  }
+
+  double elapsed = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start).count();
+  printf("%s: %.2f ns per value (%llu)\n", name,
+         elapsed / (static_cast<double>(kNumValues) * kNumRepetitions),
+         static_cast<unsigned long long>(sum % 10));
+}
+
+}  // namespace
+
+int main() {
+  stimulus::RandomStream random(1);
+  Measure("Legacy int", [](uint32_t *values) {
+    for (int i = 0; i < kNumValues; i++) {
+      values[i] = LegacyRandomInt(0, kRange);
+    }
+  });
+  Measure("NextInt", [&random](uint32_t *values) {
+    for (int i = 0; i < kNumValues; i++) {
+      values[i] = random.NextInt(0, kRange);
+    }
+  });
+  Measure("FillInts", [&random](uint32_t *values) {
+    random.FillInts(values, kNumValues, 0, kRange);
+  });
+  Measure("Legacy double", [](uint32_t *values) {
+    for (int i = 0; i < kNumValues; i++) {
+      values[i] = LegacyRandomDouble() < 0.5;
+    }
+  });
+  Measure("NextDouble", [&random](uint32_t *values) {
+    for (int i = 0; i < kNumValues; i++) {
+      values[i] = random.NextDouble() < 0.5;
+    }
+  });
+  Measure("Fill", [&random](uint32_t *values) {
+    random.Fill(values, kNumValues);
+  });
+
+  return 0;
+}
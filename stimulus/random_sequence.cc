@@ -17,7 +17,7 @@
 #include "Shuffler.h"
 
 int main() {
-  stimulus::InitRandom(1546987705);
+  stimulus::RandomStream random(1546987705);
   std::vector<int> elements {
     0,1,2,3,4,5,6,7,8,9
   };
@@ -25,7 +25,7 @@ int main() {
   for (int rep = 0; rep < 20; rep++) {
     stimulus::Shuffler<int> shuffler;
     shuffler.AddCategoryElements(elements, 0);
-    shuffler.ShuffleElements();
+    shuffler.ShuffleElements(&random);
     while (!shuffler.IsDone()) {
       std::cout << shuffler.GetNextItem() << " ";
     }
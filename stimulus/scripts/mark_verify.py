@@ -174,6 +174,9 @@ if __name__ == "__main__":
   header = json.loads(header_json)
   logging.info(header)
 
+  # Older mark files don't have time_units and are in milliseconds.
+  time_divisor = 1000 if header.get("time_units", "ms") == "us" else 1
+
   # skip column header
   csvfile.readline()
 
@@ -183,7 +186,7 @@ if __name__ == "__main__":
   line = csvfile.readline()
   while line != "":
     s = line.split(",")
-    m = {"mark": s[0], "ts": s[1]}
+    m = {"mark": s[0], "ts": int(s[1]) // time_divisor}
     all_marks.append(m)
     if m["mark"] in sorted_marks:
       sorted_marks[m["mark"]].append(m)
@@ -0,0 +1,83 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures Shuffler::ShuffleElements for the category sizes and run limits
+// the tasks use. Elements are path-sized strings, like the images and words
+// the tasks shuffle.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Random.h"
+#include "Shuffler.h"
+
+namespace {
+
+const int kNumRepetitions = 2000;
+
+struct Config {
+  const char *name;
+  std::vector<int> category_sizes;
+  int max_run_length;  // The same for every category
+  int first_max_run_length;  // Overrides max_run_length for the first
+};
+
+const Config kConfigs[] = {
+  {"Calibration (80 rare max 2, 320 standard)", {80, 320}, 0, 2},
+  {"Doors (30/30, max 3)", {30, 30}, 3, 3},
+  {"Emotional Images (60/60/60, max 3)", {60, 60, 60}, 3, 3},
+  {"Flankers (4 x 100, max 3)", {100, 100, 100, 100}, 3, 3},
+  {"SRET (40/40, max 1)", {40, 40}, 1, 1},
+  {"SSVEP images (27, no limit)", {27}, 0, 0},
+};
+
+}  // namespace
+
+int main() {
+  stimulus::RandomStream random(1);
+  for (const Config &config : kConfigs) {
+    stimulus::Shuffler<std::string> shuffler;
+    for (size_t c = 0; c < config.category_sizes.size(); c++) {
+      std::vector<std::string> elements;
+      for (int i = 0; i < config.category_sizes[c]; i++) {
+        elements.push_back("resources/category_" + std::to_string(c) +
+                           "/image_" + std::to_string(i) + ".jpg");
+      }
+
+      shuffler.AddCategoryElements(elements, c == 0
+                                   ? config.first_max_run_length
+                                   : config.max_run_length);
+    }
+
+    double total_us = 0;
+    double max_us = 0;
+    for (int rep = 0; rep < kNumRepetitions; rep++) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      shuffler.ShuffleElements(&random);
+      double elapsed = std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - start).count();
+      total_us += elapsed;
+      if (elapsed > max_us) {
+        max_us = elapsed;
+      }
+    }
+
+    printf("%s: mean %.1f us, max %.1f us\n", config.name,
+           total_us / kNumRepetitions, max_us);
+  }
+
+  return 0;
+}